@@ -48,6 +48,13 @@ PROJ_CXXFLAGS += -Isrc -Ilib/include
 PROJ_CXXFLAGS += -DIMGUI_USER_CONFIG=\"third_party_connectors/imconfig.h\"# Custom ImGui config.
 PROJ_CXXFLAGS += -DFMT_DEPRECATED_OSTREAM# See issue: https://github.com/fmtlib/fmt/issues/3088
 
+# Set to 1 to build with LZ4 and Zstd, for the faster `Archive::Codec`s. They aren't in `DIST_DEPS_ARCHIVE` yet (see below), so this is off by default.
+# Without them, the asset pack uses zlib, and the Tiled maps with Zstd compression can't be loaded.
+EXTRA_CODECS ?= 0
+ifeq ($(EXTRA_CODECS),1)
+PROJ_CXXFLAGS += -DIMP_PLATFORM_FLAG_extra_codecs=1
+endif
+
 ifeq ($(TARGET_OS),windows)
 PROJ_LDFLAGS += $(_win_subsystem)
 endif
@@ -87,6 +94,27 @@ $(foreach f,$(_codegen_list),$(eval $(call _codegen_target,$(word 1,$(subst :, ,
 
 
 
+# --- Compiled levels ---
+
+# Compiles the JSON levels (and the ship objects they use) into `assets/assets/levels/`. Release builds load those instead of JSON.
+# Rerun this after changing the levels or the objects. The next build copies the results next to the executable.
+# Each compiled level stores the hashes of its source files. `pack-assets` refuses to pack the levels that are older than their sources.
+.PHONY: compile-levels
+compile-levels: build-micromachines
+	$(call log_now,[Compiling levels])
+	@$(call proj_output_filename,micromachines) --compile-levels=$(call quote,$(proj_dir)/assets/assets/levels)
+
+
+# --- Asset pack ---
+
+# Packs all assets (including the compiled levels) into `assets/assets.pack`. Release builds read the assets from it if it exists, instead of the loose files.
+# Rerun this after changing any assets. The next build copies the pack next to the executable.
+.PHONY: pack-assets
+pack-assets: build-micromachines
+	$(call log_now,[Packing assets])
+	@$(call proj_output_filename,micromachines) --pack-assets=$(call quote,$(proj_dir)/assets/assets.pack)
+
+
 # --- Dependencies ---
 
 # Don't need anything on Windows.
@@ -231,6 +259,16 @@ override buildsystem-imgui = \
 	)\
 	$(call safe_shell_exec,$(call MAKE_STATIC_LIB,$(__install_dir)/lib/$(PREFIX_static)imgui$(EXT_static),$(__bs_sources:.cpp=.o)) >>$(call quote,$(__log_path)))\
 
+# NOTE: The `lz4` and `zstd` archives aren't in the `DIST_DEPS_ARCHIVE` above yet, since it predates them. They're only built with `EXTRA_CODECS=1`.
+# Then download them into `deps_src/` manually (keeping those names, then `make dist-deps` can repack everything):
+#   https://github.com/lz4/lz4/archive/refs/tags/v1.9.4.tar.gz -> lz4-1.9.4.tar.gz
+#   https://github.com/facebook/zstd/releases/download/v1.5.6/zstd-1.5.6.tar.gz
+ifeq ($(EXTRA_CODECS),1)
+$(call Library,lz4,lz4-1.9.4.tar.gz)
+  $(call LibrarySetting,build_system,cmake_build_subdir)
+  $(call LibrarySetting,cmake_flags,-DLZ4_BUILD_CLI=OFF -DLZ4_BUILD_LEGACY_LZ4C=OFF)
+endif
+
 $(call Library,ogg,libogg-1.3.5.tar.gz) # Only serves as a dependency for `libvorbis`.
   # When built with CMake on MinGW, ogg/vorbis can't decide whether to prefix the libraries with `lib` or not.
   # The resulting executable doesn't find libraries because of this inconsistency.
@@ -273,3 +311,13 @@ $(call Library,zlib,zlib-1.2.13.tar.gz)
   $(call LibrarySetting,build_system,configure_make)
   # Need to set `cc`, otherwise their makefile uses the executable named `cc` to link, which doesn't support `-fuse-ld=lld-N`, it seems. Last tested on 1.2.12.
   $(call LibrarySetting,configure_vars,$(_zlib_env_vars))
+
+ifeq ($(EXTRA_CODECS),1)
+$(call Library,zstd,zstd-1.5.6.tar.gz)
+  $(call LibrarySetting,build_system,cmake_build_subdir)
+  # By default Zstd builds both a static and a shared library. We only need one, and the shared one matches LZ4 (which only builds a shared one by default).
+  $(call LibrarySetting,cmake_flags,-DZSTD_BUILD_PROGRAMS=OFF -DZSTD_BUILD_TESTS=OFF -DZSTD_BUILD_STATIC=OFF)
+endif
+
+# LZ4 and Zstd keep their CMake files in `build/cmake`, and have only a plain makefile at the top level.
+override buildsystem-cmake_build_subdir = $(call var,__source_dir := $(__source_dir)/build/cmake)$(buildsystem-cmake)
@@ -5,6 +5,7 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "audio/buffer.h"
 #include "audio/sound.h"
@@ -70,34 +71,66 @@ namespace Audio::GlobalData
         return Sound<Name>();
     }
 
-    // Loads (or reloads) all files requested with `Audio::GlobalData::Sound()`. Consider using the simplified overload, defined below.
-    // The number of channels and the file format can be overridden by the `Sound()` calls.
-    // `get_stream` is called repeatedly for all needed files.
-    inline void Load(std::optional<Channels> channels, Format format, std::function<Stream::Input(const std::string &name, std::optional<Channels> channels, Format format)> get_stream)
+    using GetStreamFunc = std::function<Stream::Input(const std::string &name, std::optional<Channels> channels, Format format)>;
+
+    namespace impl
     {
-        for (auto &[name, data] : impl::GetAutoLoadedBuffers())
+        inline void LoadBuffer(const std::string &name, AutoLoadedBuffer &data, std::optional<Channels> channels, Format format, const GetStreamFunc &get_stream)
         {
             std::optional<Channels> file_channels = data.channels_override ? data.channels_override : channels;
             Format file_format = data.format_override.value_or(format);
             data.buffer = Audio::Sound(file_format, file_channels, get_stream(name, file_channels, file_format));
         }
+
+        // Returns a `GetStreamFunc` that loads files named `prefix + name + ext`, where `ext` is determined from the format.
+        [[nodiscard]] inline GetStreamFunc LoadFileFromPrefix(std::string prefix)
+        {
+            return [prefix = std::move(prefix)](const std::string &name, std::optional<Channels> channels, Format format) -> Stream::Input
+            {
+                (void)channels;
+                const char *ext = "";
+                switch (format)
+                {
+                    case wav: ext = ".wav"; break;
+                    case ogg: ext = ".ogg"; break;
+                }
+                return prefix + name + ext;
+            };
+        }
+    }
+
+    // Loads (or reloads) all files requested with `Audio::GlobalData::Sound()`. Consider using the simplified overload, defined below.
+    // The number of channels and the file format can be overridden by the `Sound()` calls.
+    // `get_stream` is called repeatedly for all needed files.
+    inline void Load(std::optional<Channels> channels, Format format, const GetStreamFunc &get_stream)
+    {
+        for (auto &[name, data] : impl::GetAutoLoadedBuffers())
+            impl::LoadBuffer(name, data, channels, format, get_stream);
     }
 
     // Same, but the sounds are loaded from files named `prefix + name + ext`,
     // where `name` comes from the `Sound()` call, and `ext` is determined from the format (`.wav` or `.ogg`).
     inline void Load(std::optional<Channels> channels, Format format, const std::string &prefix)
     {
-        Load(channels, format, [&prefix](const std::string &name, std::optional<Channels> channels, Format format) -> Stream::Input
+        Load(channels, format, impl::LoadFileFromPrefix(prefix));
+    }
+
+    // Reloads only the specified sounds, e.g. when their files change. Unknown names are ignored.
+    // The buffers must not be attached to any sources at this point, stop them first (e.g. with `SourceManager::StopAll()`).
+    inline void Reload(std::optional<Channels> channels, Format format, const GetStreamFunc &get_stream, const std::vector<std::string> &names)
+    {
+        for (const std::string &name : names)
         {
-            (void)channels;
-            const char *ext = "";
-            switch (format)
-            {
-                case wav: ext = ".wav"; break;
-                case ogg: ext = ".ogg"; break;
-            }
-            return prefix + name + ext;
-        });
+            auto it = impl::GetAutoLoadedBuffers().find(name);
+            if (it != impl::GetAutoLoadedBuffers().end())
+                impl::LoadBuffer(name, it->second, channels, format, get_stream);
+        }
+    }
+
+    // Same, but the sounds are loaded from files named `prefix + name + ext`, like in `Load()`.
+    inline void Reload(std::optional<Channels> channels, Format format, const std::string &prefix, const std::vector<std::string> &names)
+    {
+        Reload(channels, format, impl::LoadFileFromPrefix(prefix), names);
     }
 }
 
@@ -61,6 +61,15 @@ namespace Audio
             std::erase_if(sources, [](const std::shared_ptr<Source> &ptr){return !ptr->IsPlaying();});
         }
 
+        // Stops and releases all sources.
+        // Call this before replacing the buffers they use, since OpenAL can't delete buffers attached to sources.
+        void StopAll()
+        {
+            for (const std::shared_ptr<Source> &source : sources)
+                source->stop();
+            sources.clear();
+        }
+
         [[nodiscard]] std::size_t ActiveSources() const
         {
             return sources.size();
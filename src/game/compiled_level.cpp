@@ -0,0 +1,322 @@
+#include "compiled_level.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "game/goal_controller.h"
+#include "game/ship.h"
+#include "stream/asset_pack.h"
+#include "utils/filesystem.h"
+
+// "MMLV" in little endian.
+static constexpr std::uint32_t compiled_level_magic = 0x564c4d4d;
+
+std::string LevelIndexToFilename(int index)
+{
+    return FMT("{}assets/maps/{}.json", Program::ExeDir(), index);
+}
+
+std::string LevelIndexToCompiledFilename(int index)
+{
+    return FMT("{}assets/levels/{}.bin", Program::ExeDir(), index);
+}
+
+template <typename Grid>
+[[nodiscard]] static CompiledLevel::Tiles MapToTiles(const Map<Grid> &map)
+{
+    static_assert(std::to_underlying(Grid::Tile::_count) <= 256, "The tiles don't fit into bytes.");
+
+    CompiledLevel::Tiles ret;
+    ret.size = map.Cells().size();
+    ret.tiles.reserve(map.Cells().element_count());
+    for (ivec2 pos : vector_range(ret.size))
+        ret.tiles.push_back(std::uint8_t(map.Cells().safe_nonthrowing_at(pos).tile));
+    return ret;
+}
+
+template <typename Grid>
+[[nodiscard]] static Map<Grid> TilesToMap(const CompiledLevel::Tiles &tiles)
+{
+    if (tiles.size(any) < 0 || tiles.tiles.size() != std::size_t(tiles.size.prod()))
+        throw std::runtime_error(FMT("Compiled level: Expected a map of size {} to have {} tiles, but got {}.", tiles.size, tiles.size.prod(), tiles.tiles.size()));
+
+    Map<Grid> ret;
+    auto &cells = ret.ModifyCells();
+    cells.resize(tiles.size);
+
+    std::size_t index = 0;
+    for (ivec2 pos : vector_range(tiles.size))
+    {
+        std::uint8_t tile = tiles.tiles[index++];
+        if (tile >= std::to_underlying(Grid::Tile::_count))
+            throw std::runtime_error(FMT("Compiled level: Bad tile {} at {}.", tile, pos));
+
+        auto &cell = cells.safe_nonthrowing_at(pos);
+        cell.tile = typename Grid::Tile(tile);
+        cell.RegenerateNoise();
+    }
+
+    return ret;
+}
+
+CompiledLevel CompiledLevel::FromGame()
+{
+    CompiledLevel ret;
+
+    ret.bg_map = MapToTiles(game.get<MapObject>()->bg_map);
+    ret.map = MapToTiles(game.get<MapObject>()->map);
+
+    // Maps blocks entities to their indices in `ship_parts`.
+    phmap::flat_hash_map<Game::Id, std::uint32_t> blocks_indices;
+
+    for (auto &e : game.get<Game::Category<Ent::OrderedList, BasicShipPart>>())
+    {
+        if (auto blocks = e.get_opt<ShipPartBlocks>())
+        {
+            blocks_indices.try_emplace(e.id(), std::uint32_t(ret.ship_parts.size()));
+
+            Blocks &elem = ret.ship_parts.emplace_back().emplace<Blocks>();
+            elem.pos = blocks->pos;
+            elem.map = MapToTiles(blocks->map);
+            elem.gravity_enabled = blocks->gravity.enabled;
+            elem.can_move = blocks->can_move;
+            elem.goal = game.get<GoalController>()->goal_blocks.contains(e.id());
+            elem.grav = game.get<GoalController>()->grav_blocks.contains(e.id());
+        }
+        else
+        {
+            // The pistons are always created after the blocks they connect.
+            auto &piston = e.get<ShipPartPiston>();
+            Piston &elem = ret.ship_parts.emplace_back().emplace<Piston>();
+            elem.a = blocks_indices.at(game.get_link<"a">(piston).id());
+            elem.b = blocks_indices.at(game.get_link<"b">(piston).id());
+            elem.is_vertical = piston.is_vertical;
+            elem.pos_relative_to_a = piston.pos_relative_to_a;
+            elem.pos_relative_to_b = piston.pos_relative_to_b;
+        }
+    }
+
+    for (auto &e : game.get<Game::Category<Ent::OrderedList, Tooltip>>())
+    {
+        const auto &tooltip = e.get<Tooltip>();
+        ret.tooltips.push_back(adjust(TooltipData{}, .pos = tooltip.pos, .kind = tooltip.kind));
+    }
+
+    if (auto con = game.get<ShipEditorController>().get_opt())
+        ret.editor = adjust(Editor{}, .world_pos = con->world_pos, .box_size = con->cells.size(), .tutorial_mode = con->tutorial_mode);
+
+    return ret;
+}
+
+[[nodiscard]] static Meta::hash_t HashFile(const std::string &file_name)
+{
+    Stream::ReadOnlyData data = Stream::ReadOnlyData::file(file_name);
+    return Meta::cexpr_hash(data.data_char(), data.size());
+}
+
+std::vector<CompiledLevel::SourceFile> CompiledLevel::FindSources(const std::string &json_file_name)
+{
+    std::vector<std::string> file_names = {json_file_name};
+
+    // Same as in the constructor of `MapObject`: the object name is the part before the first comma.
+    game.get<MapObject>()->map.points.ForEachPointWithNamePrefix("=", [&](std::string_view suffix, fvec2 pos)
+    {
+        (void)pos;
+        std::string file_name = ShipObjectCache::NameToFilename(suffix.substr(0, suffix.find_first_of(',')));
+        if (std::find(file_names.begin(), file_names.end(), file_name) == file_names.end())
+            file_names.push_back(std::move(file_name));
+    });
+
+    const std::string &exe_dir = Program::ExeDir();
+
+    std::vector<SourceFile> ret;
+    for (const std::string &file_name : file_names)
+    {
+        if (!file_name.starts_with(exe_dir))
+            throw std::runtime_error(FMT("Compiled level: The source file `{}` is not in the executable directory.", file_name));
+        ret.push_back(adjust(SourceFile{}, .name = file_name.substr(exe_dir.size()), .hash = HashFile(file_name)));
+    }
+    return ret;
+}
+
+bool CompiledLevel::IsUpToDate() const
+{
+    for (const SourceFile &source : sources)
+    {
+        std::string file_name = Program::ExeDir() + source.name;
+        if (!Stream::AssetPack::FileExists(file_name) || HashFile(file_name) != source.hash)
+            return false;
+    }
+    return true;
+}
+
+void CompiledLevel::CreateEntities() const
+{
+    auto &map_object = game.create<MapObject>();
+    map_object.bg_map = TilesToMap<WorldGrid>(bg_map);
+    map_object.map = TilesToMap<WorldGrid>(map);
+
+    // Same indices as in `ship_parts`. Null for pistons.
+    std::vector<ShipPartBlocks *> created_blocks(ship_parts.size());
+
+    for (std::size_t i = 0; i < ship_parts.size(); i++)
+    {
+        std::visit(Meta::overload{
+            [&](const Blocks &elem)
+            {
+                auto &new_blocks = game.create<ShipPartBlocks>();
+                created_blocks[i] = &new_blocks;
+                new_blocks.map = TilesToMap<ShipGrid>(elem.map);
+                new_blocks.pos = elem.pos;
+                new_blocks.UpdateAabb();
+
+                new_blocks.gravity.enabled = elem.gravity_enabled;
+                new_blocks.can_move = elem.can_move;
+                if (elem.goal)
+                    game.get<GoalController>()->goal_blocks.insert(dynamic_cast<Game::Entity &>(new_blocks).id());
+                if (elem.grav)
+                    game.get<GoalController>()->grav_blocks.insert(dynamic_cast<Game::Entity &>(new_blocks).id());
+            },
+            [&](const Piston &elem)
+            {
+                if (elem.a >= i || elem.b >= i || !created_blocks[elem.a] || !created_blocks[elem.b])
+                    throw std::runtime_error(FMT("Compiled level: Piston #{} is attached to invalid blocks #{} and #{}.", i, elem.a, elem.b));
+
+                auto &new_piston = game.create<ShipPartPiston>();
+                game.link<"pistons", "a">(*created_blocks[elem.a], new_piston);
+                game.link<"pistons", "b">(*created_blocks[elem.b], new_piston);
+                new_piston.is_vertical = elem.is_vertical;
+                new_piston.pos_relative_to_a = elem.pos_relative_to_a;
+                new_piston.pos_relative_to_b = elem.pos_relative_to_b;
+                new_piston.UpdateAabb();
+            },
+        }, ship_parts[i]);
+    }
+
+    for (const TooltipData &elem : tooltips)
+    {
+        auto &tooltip = game.create<Tooltip>();
+        tooltip.pos = elem.pos;
+        tooltip.kind = elem.kind;
+    }
+
+    if (editor)
+    {
+        auto &con = game.create<ShipEditorController>();
+        con.world_pos = editor->world_pos;
+        con.cells.resize(editor->box_size);
+        con.tutorial_mode = editor->tutorial_mode;
+    }
+}
+
+void CompiledLevel::Save(const std::string &file_name) const
+{
+    Stream::Output output(file_name);
+    output.WriteLittle<std::uint32_t>(compiled_level_magic);
+    output.WriteLittle<std::uint32_t>(version);
+    Refl::ToBinary(*this, output);
+    output.Flush();
+}
+
+std::optional<CompiledLevel> CompiledLevel::Load(const std::string &file_name)
+{
+    if (!Stream::AssetPack::FileExists(file_name))
+        return {};
+
+    try
+    {
+        // Map the whole file at once (or get it from the asset pack), `Input` reads from the memory without copying.
+        Stream::Input input = Stream::ReadOnlyData::file_mapped(file_name);
+
+        if (input.ReadLittle<std::uint32_t>() != compiled_level_magic)
+            return {};
+        if (input.ReadLittle<std::uint32_t>() != version)
+            return {};
+
+        std::optional<CompiledLevel> ret(std::in_place);
+        Refl::FromBinary(*ret, input);
+        return ret;
+    }
+    catch (std::exception &)
+    {
+        return {}; // Truncated or otherwise malformed.
+    }
+}
+
+void ResetGameForLevel()
+{
+    game = nullptr;
+
+    game.create<DynamicSolidTree>();
+    game.create<PistonMouseController>();
+    game.create<GravityController>();
+    game.create<GoalController>();
+}
+
+void CompileLevels(const std::string &target_dir)
+{
+    std::filesystem::create_directories(target_dir);
+
+    // Each level is loaded several times, to measure the load time.
+    constexpr int num_reps = 20;
+
+    for (int index = 0;; index++)
+    {
+        std::string json_file_name = LevelIndexToFilename(index);
+
+        bool exists = true;
+        (void)Filesystem::GetObjectInfo(json_file_name, &exists);
+        if (!exists)
+        {
+            if (index == 0)
+                throw std::runtime_error(FMT("No levels found, expected `{}` to exist.", json_file_name));
+            break;
+        }
+
+        // The ship objects are parsed only once, see `ShipObjectCache`. The same happens in the game when the level is restarted.
+        uint64_t json_ticks = 0;
+        for (int i = 0; i < num_reps; i++)
+        {
+            ResetGameForLevel();
+            uint64_t start = Clock::Time();
+            game.create<MapObject>(json_file_name);
+            json_ticks += Clock::Time() - start;
+        }
+
+        std::string compiled_file_name = FMT("{}/{}.bin", target_dir, index);
+        CompiledLevel compiled = CompiledLevel::FromGame();
+        compiled.sources = CompiledLevel::FindSources(json_file_name);
+        compiled.Save(compiled_file_name);
+
+        uint64_t compiled_ticks = 0;
+        for (int i = 0; i < num_reps; i++)
+        {
+            ResetGameForLevel();
+            uint64_t start = Clock::Time();
+            CompiledLevel::Load(compiled_file_name)->CreateEntities();
+            compiled_ticks += Clock::Time() - start;
+        }
+
+        std::cout << FMT("Level {}: JSON {:.3f} ms, compiled {:.3f} ms, {} -> {} bytes.\n", index,
+            Clock::TicksToSeconds(json_ticks) * 1000 / num_reps, Clock::TicksToSeconds(compiled_ticks) * 1000 / num_reps,
+            std::filesystem::file_size(json_file_name), std::filesystem::file_size(compiled_file_name));
+    }
+
+    game = nullptr;
+}
+
+void CheckCompiledLevels()
+{
+    for (int index = 0; Stream::AssetPack::FileExists(LevelIndexToFilename(index)); index++)
+    {
+        std::string compiled_file_name = LevelIndexToCompiledFilename(index);
+        if (!Stream::AssetPack::FileExists(compiled_file_name))
+            continue;
+
+        std::optional<CompiledLevel> compiled = CompiledLevel::Load(compiled_file_name);
+        if (!compiled)
+            throw std::runtime_error(FMT("The compiled level `{}` is malformed or has a wrong version. Rerun `make compile-levels`.", compiled_file_name));
+        if (!compiled->IsUpToDate())
+            throw std::runtime_error(FMT("The compiled level `{}` is older than its JSON or objects. Rerun `make compile-levels`.", compiled_file_name));
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "game/map.h"
+#include "game/ui.h"
+#include "meta/constexpr_hash.h"
+
+// The JSON level files.
+[[nodiscard]] std::string LevelIndexToFilename(int index);
+// The compiled level files, produced by `CompileLevels()`. Release builds prefer those to the JSON files if they exist.
+[[nodiscard]] std::string LevelIndexToCompiledFilename(int index);
+
+// A level with the ship objects already loaded and decomposed into parts, and with all the special points parsed.
+// Loading this needs no JSON parsing and no flood fills, unlike constructing `MapObject` from a JSON file.
+struct CompiledLevel
+{
+    // Increment this when changing the format. Files with a different version are rejected.
+    static constexpr std::uint32_t version = 2;
+
+    SIMPLE_STRUCT( SourceFile
+        // Relative to `Program::ExeDir()`.
+        DECL(std::string) name
+        DECL(Meta::hash_t INIT{}) hash
+    )
+
+    SIMPLE_STRUCT( Tiles
+        DECL(ivec2 INIT{}) size
+        // Tile indices, row by row.
+        DECL(std::vector<std::uint8_t>) tiles
+    )
+
+    // Those need names, since they're used in a variant.
+    STRUCT( Blocks AT_CLASS_SCOPE TERSE
+        DECL(ivec2 INIT{}) pos
+        DECL(Tiles) map
+        DECL(bool INIT{}) gravity_enabled
+        DECL(bool INIT{}) can_move
+        // Whether this is in `GoalController::goal_blocks` and `grav_blocks` respectively.
+        DECL(bool INIT{}) goal
+        DECL(bool INIT{}) grav
+    )
+
+    STRUCT( Piston AT_CLASS_SCOPE TERSE
+        // Indices of `Blocks` in `ship_parts`.
+        DECL(std::uint32_t INIT{}) a
+        DECL(std::uint32_t INIT{}) b
+        DECL(bool INIT{}) is_vertical
+        DECL(ivec2 INIT{}) pos_relative_to_a
+        DECL(ivec2 INIT{}) pos_relative_to_b
+    )
+
+    SIMPLE_STRUCT( TooltipData
+        DECL(ivec2 INIT{}) pos
+        DECL(Tooltip::Kind INIT{}) kind
+    )
+
+    SIMPLE_STRUCT( Editor
+        DECL(ivec2 INIT{}) world_pos
+        DECL(ivec2 INIT{}) box_size
+        DECL(bool INIT{}) tutorial_mode
+    )
+
+    MEMBERS(
+        // The level JSON and the ship objects it uses, see `IsUpToDate()`.
+        DECL(std::vector<SourceFile>) sources
+        DECL(Tiles) bg_map
+        DECL(Tiles) map
+        // In the order of creation, so that the entity order matches the JSON levels.
+        DECL(std::vector<std::variant<Blocks, Piston>>) ship_parts
+        DECL(std::vector<TooltipData>) tooltips
+        DECL(std::optional<Editor>) editor
+    )
+
+    // Captures the level entities from `game`, right after it was loaded from JSON.
+    // Doesn't fill `sources`, use `FindSources()` for that.
+    [[nodiscard]] static CompiledLevel FromGame();
+
+    // Lists the files the level in `game` was loaded from: `json_file_name` and the ship objects it uses, with the hashes of their contents.
+    // Must be called right after loading the level from JSON, since the compiled levels don't keep the object names.
+    [[nodiscard]] static std::vector<SourceFile> FindSources(const std::string &json_file_name);
+
+    // Returns false if any of the `sources` changed or disappeared since the level was compiled.
+    // This reads and hashes the source files, so it's checked once when packing the assets (see `CheckCompiledLevels()`), not on every load.
+    [[nodiscard]] bool IsUpToDate() const;
+
+    // Creates `MapObject` and the other level entities, same as `game.create<MapObject>(LevelIndexToFilename(...))`.
+    void CreateEntities() const;
+
+    void Save(const std::string &file_name) const;
+    // Returns null if the file doesn't exist, is malformed, or has a wrong version. Then the caller should load the JSON level instead.
+    [[nodiscard]] static std::optional<CompiledLevel> Load(const std::string &file_name);
+};
+
+// Creates the entities that must exist before a level is loaded, removing everything else.
+void ResetGameForLevel();
+
+// Loads every JSON level and saves it in the compiled form to `target_dir`.
+// Also prints the load times of both formats.
+void CompileLevels(const std::string &target_dir);
+
+// Throws if any of the compiled levels in `LevelIndexToCompiledFilename()` can't be loaded, or is older than its sources.
+// The levels that aren't compiled are skipped, the game loads their JSON files.
+// This is called before packing the assets, so that the pack never contains stale levels.
+void CheckCompiledLevels();
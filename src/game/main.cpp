@@ -1,8 +1,18 @@
 #include "main.h"
 
+#include <filesystem>
+
+#include "game/compiled_level.h"
+#include "game/map.h"
+#include "stream/asset_pack.h"
+#include "utils/file_watcher.h"
+
 const ivec2 screen_size = ivec2(480, 270);
 const std::string_view window_name = "Micromachines";
 
+// For the startup time report. This is the first thing initialized in this file.
+static const uint64_t startup_begin_time = Clock::Time();
+
 Interface::Window window(std::string(window_name), screen_size * 2, Interface::windowed, adjust_(Interface::WindowSettings{}, .min_size = screen_size));
 static Graphics::DummyVertexArray dummy_vao = nullptr;
 
@@ -12,9 +22,14 @@ Audio::SourceManager audio;
 const Graphics::ShaderConfig shader_config = Graphics::ShaderConfig::Core();
 Interface::ImGuiController gui_controller(Poly::derived<Interface::ImGuiController::GraphicsBackend_Modern>, adjust_(Interface::ImGuiController::Config{}, .shader_header = shader_config.common_header, .store_state_in_file = {}));
 
-Graphics::FontFile Fonts::Files::main(Program::ExeDir() + "assets/Monocat_6x12.ttf", 12);
+// Release builds read the assets from `assets.pack` if it exists, see `make pack-assets`. This must happen before anything below loads the assets.
+static const bool asset_pack_mounted = IMP_PLATFORM_IS(prod) && Stream::AssetPack::MountIfExists(Program::ExeDir() + "assets/", Program::ExeDir() + "assets.pack");
+
+Graphics::FontFile Fonts::Files::main(Stream::ReadOnlyData::file_mapped(Program::ExeDir() + "assets/Monocat_6x12.ttf"), 12);
 Graphics::Font Fonts::main;
 
+Graphics::TextCache text_cache;
+
 GameUtils::AdaptiveViewport adaptive_viewport(shader_config, screen_size);
 Render r = adjust_(Render(0x2000, shader_config), .SetMatrix(adaptive_viewport.GetDetails().MatrixCentered()));
 
@@ -50,7 +65,8 @@ struct Application : Program::DefaultBasicState
     {
         fps_counter.Update();
         if (!IMP_PLATFORM_IS(prod))
-            window.SetTitle(STR((window_name), " TPS:", (fps_counter.Tps()), " FPS:", (fps_counter.Fps()), " SOUNDS:", (audio.ActiveSources())));
+            window.SetTitle(STR((window_name), " TPS:", (fps_counter.Tps()), " FPS:", (fps_counter.Fps()), " SOUNDS:", (audio.ActiveSources()), " TEXT_ALLOCS:", (text_cache.GetCounters().misses), " TEXT_HITS:", (int(text_cache.GetCounters().HitRate() * 100)), "%", " OBJECTS_PARSED:", (ShipObjectCache::GetCounters().misses), " OBJECTS_COPIED:", (ShipObjectCache::GetCounters().hits)));
+        text_cache.ResetCounters();
     }
 
     void Tick() override
@@ -66,6 +82,9 @@ struct Application : Program::DefaultBasicState
             Graphics::Viewport(window.Size());
         }
 
+        if (!IMP_PLATFORM_IS(prod))
+            ReloadChangedAssets();
+
         gui_controller.PreTick();
         state_manager.Tick();
         audio.Tick();
@@ -86,14 +105,99 @@ struct Application : Program::DefaultBasicState
     }
 
 
+    static std::string ImageDir() {return Program::ExeDir() + "assets/images/";}
+    static std::string SoundDir() {return Program::ExeDir() + "assets/sounds/";}
+    static std::string MapDir() {return Program::ExeDir() + "assets/maps/";}
+
+    // Prints how full the texture atlases are. The atlases loaded from the cache are skipped, since they have no packer.
+    static void PrintAtlasStats()
+    {
+        for (const auto &[name, atlas] : Graphics::GlobalData::GetAtlases())
+        {
+            if (!atlas.packer)
+                continue;
+            const Packing::Stats &stats = atlas.packer.GetStats();
+            std::cout << FMT("Atlas `{}`: {} image(s) in {}x{}, {:.0f}% occupied, {:.0f}% dense.\n", name, stats.num_packed, atlas.size.x, atlas.size.y, stats.Occupancy() * 100, stats.Density() * 100);
+        }
+    }
+
+    // Watches the asset directories, to reload the assets when they change. Not used in prod builds.
+    Filesystem::FileWatcher asset_watcher;
+
+    void ReloadChangedAssets()
+    {
+        std::vector<std::string> changed_files = asset_watcher.Poll();
+        if (changed_files.empty())
+            return;
+
+        uint64_t start_time = Clock::Time();
+
+        // Sort the files by the asset type, and convert them to asset names.
+        std::vector<std::string> images, sounds, maps;
+        for (const std::string &path : changed_files)
+        {
+            auto AssetName = [&](std::string_view dir, std::string_view ext) -> std::optional<std::string>
+            {
+                if (!path.starts_with(dir) || !path.ends_with(ext))
+                    return {};
+                return path.substr(dir.size(), path.size() - dir.size() - ext.size());
+            };
+
+            if (auto name = AssetName(ImageDir(), ".png"))
+                images.push_back(std::move(*name));
+            else if (auto name = AssetName(SoundDir(), ".wav"))
+                sounds.push_back(std::move(*name));
+            else if ((path.starts_with(MapDir()) || path.starts_with(ShipObjectCache::ObjectDir())) && path.ends_with(".json"))
+                maps.push_back(path);
+        }
+        if (images.empty() && sounds.empty() && maps.empty())
+            return;
+
+        try
+        {
+            if (!images.empty())
+            {
+                if (!Graphics::GlobalData::Reload(ImageLoadParams(), images))
+                {
+                    std::cout << "Hot reload: the new images don't fit, rebuilt the atlases.\n";
+                    r.SetAtlas("");
+                    // The font atlas was regenerated too, and the glyphs could've moved. The cached layouts store the old glyph positions.
+                    text_cache.Clear();
+                }
+                PrintAtlasStats();
+            }
+
+            if (!sounds.empty())
+            {
+                audio.StopAll();
+                Audio::GlobalData::Reload(Audio::mono, Audio::wav, SoundDir(), sounds);
+            }
+
+            if (!maps.empty())
+            {
+                ShipObjectCache::Invalidate(maps);
+                state_manager.Call(&StateBase::MapFilesChanged, maps);
+            }
+
+            std::cout << FMT("Hot reload: {} image(s), {} sound(s), {} map(s) in {:.1f} ms.\n", images.size(), sounds.size(), maps.size(), Clock::TicksToSeconds(Clock::Time() - start_time) * 1000);
+        }
+        catch (std::exception &e)
+        {
+            // Most likely the file is malformed or still being written. It will be reloaded again on the next change.
+            std::cout << "Hot reload failed: " << e.what() << '\n';
+        }
+    }
+
     void Init(int level_index)
     {
         // Initialize ImGui.
         ImGui::StyleColorsDark();
 
         { // Load images.
-            Graphics::GlobalData::Load(Program::ExeDir() + "assets/images/");
+            Graphics::GlobalData::Load(ImageLoadParams());
             r.SetAtlas("");
+            if (!IMP_PLATFORM_IS(prod))
+                PrintAtlasStats();
 
             // Load the font atlas.
             struct FontLoader : Graphics::GlobalData::Generator
@@ -108,9 +212,9 @@ struct Application : Program::DefaultBasicState
                     Unicode::CharSet glyph_ranges;
                     glyph_ranges.Add(Unicode::Ranges::Basic_Latin);
 
-                    Graphics::MakeFontAtlas(image, rect, {
+                    Graphics::MakeFontAtlasCached(image, rect, {
                         {Fonts::main, Fonts::Files::main, glyph_ranges, Graphics::FontFile::monochrome_with_hinting},
-                    });
+                    }, Program::ExeDir() + "font_atlas.cache");
                 }
             };
             (void)Graphics::GlobalData::Image<"font_atlas", FontLoader>();
@@ -119,18 +223,44 @@ struct Application : Program::DefaultBasicState
         // Load various small fonts
         auto monochrome_font_flags = ImGuiFreeTypeBuilderFlags_Monochrome | ImGuiFreeTypeBuilderFlags_MonoHinting;
 
-        gui_controller.LoadFont(Program::ExeDir() + "assets/Monocat_6x12.ttf", 12.0f, adjust(ImFontConfig{}, .FontBuilderFlags = monochrome_font_flags));
+        // Share the memory with `Fonts::Files::main`, so the font is read (from the asset pack, if mounted) only once. ImGui doesn't take ownership of it.
+        gui_controller.LoadFont(Fonts::Files::main.File(), 12.0f, adjust(ImFontConfig{}, .FontBuilderFlags = monochrome_font_flags));
         gui_controller.LoadDefaultFont();
 
         Graphics::Blending::Enable();
         Graphics::Blending::FuncNormalPre();
 
-        Audio::GlobalData::Load(Audio::mono, Audio::wav, Program::ExeDir() + "assets/sounds/");
+        Audio::GlobalData::Load(Audio::mono, Audio::wav, SoundDir());
+
+        if (!IMP_PLATFORM_IS(prod))
+        {
+            try
+            {
+                asset_watcher = Filesystem::FileWatcher({ImageDir(), SoundDir(), MapDir(), ShipObjectCache::ObjectDir()});
+            }
+            catch (std::exception &e)
+            {
+                std::cout << "Asset hot reload is disabled: " << e.what() << '\n';
+            }
+        }
 
         state_manager.SetState(FMT("World{{cur_level_index={}}}", level_index));
+
+        const Stream::AssetPack::Counters &file_counters = Stream::AssetPack::GetCounters();
+        std::cout << FMT("Startup took {:.1f} ms, opened {} file(s) from the disk, read {} file(s) from the asset pack{}.\n",
+            Clock::TicksToSeconds(Clock::Time() - startup_begin_time) * 1000, file_counters.disk_reads, file_counters.pack_reads, asset_pack_mounted ? "" : " (not mounted)");
     }
 };
 
+Graphics::GlobalData::LoadParams ImageLoadParams(bool textures)
+{
+    Graphics::GlobalData::LoadParams params(Application::ImageDir());
+    params.cache_file_name = [](const std::string &atlas){return FMT("{}image_atlas{}.cache", Program::ExeDir(), atlas);};
+    if (!textures)
+        params.atlas_params = [](const std::string &){return Graphics::GlobalData::AtlasParams{.flags = Graphics::GlobalData::no_texture};};
+    return params;
+}
+
 IMP_MAIN(argc, argv)
 {
     int level_index = 0;
@@ -138,10 +268,41 @@ IMP_MAIN(argc, argv)
         throw std::runtime_error("Need at most two arguments.");
     if (argc == 2)
     {
+        std::string_view arg = argv[1];
+
+        // This is used by `make compile-levels`.
+        if (std::string_view prefix = "--compile-levels="; arg.starts_with(prefix))
+        {
+            Stream::AssetPack::UnmountAll(); // Compile from the loose files, the pack could be stale.
+            CompileLevels(std::string(arg.substr(prefix.size())));
+            return 0;
+        }
+
+        // This is used by `make pack-assets`.
+        if (std::string_view prefix = "--pack-assets="; arg.starts_with(prefix))
+        {
+            std::string file_name(arg.substr(prefix.size()));
+            uint64_t start_time = Clock::Time();
+            Stream::AssetPack::UnmountAll(); // Check the loose files, the old pack could be stale.
+            CheckCompiledLevels();
+            Stream::AssetPack::Create(Program::ExeDir() + "assets", file_name);
+
+            Stream::AssetPack pack = Stream::ReadOnlyData::file(file_name);
+            std::size_t size = 0, num_compressed = 0;
+            for (const Stream::AssetPack::Entry &entry : pack.GetEntries())
+            {
+                size += entry.size;
+                num_compressed += entry.codec != Stream::AssetPack::stored_codec;
+            }
+            std::cout << FMT("Packed {} file(s) ({} compressed) in {:.1f} ms, {} -> {} bytes.\n",
+                pack.GetEntries().size(), num_compressed, Clock::TicksToSeconds(Clock::Time() - start_time) * 1000, size, std::filesystem::file_size(file_name));
+            return 0;
+        }
+
         std::string_view prefix = "--level=";
-        if (!std::string_view(argv[1]).starts_with(prefix))
-            throw std::runtime_error("The argument must be `--mode=NUM`.");
-        level_index = Refl::FromString<int>(argv[1] + prefix.size());
+        if (!arg.starts_with(prefix))
+            throw std::runtime_error("The argument must be `--level=NUM`, `--compile-levels=DIR` or `--pack-assets=FILE`.");
+        level_index = Refl::FromString<int>(arg.substr(prefix.size()));
     }
 
     Application app;
@@ -21,6 +21,9 @@ namespace Fonts
     extern Graphics::Font main;
 }
 
+// Layouts of the strings drawn every frame.
+extern Graphics::TextCache text_cache;
+
 extern GameUtils::AdaptiveViewport adaptive_viewport;
 extern Render r;
 
@@ -29,7 +32,14 @@ extern Input::Mouse mouse;
 extern Random::DefaultGenerator random_generator;
 extern Random::DefaultInterfaces<Random::DefaultGenerator> ra;
 
+// The parameters for loading the images into `Graphics::GlobalData`.
+// With `textures == false` the atlases stay in RAM and GL isn't touched. Use this with a capturing `Render`, see `Render::capture`.
+[[nodiscard]] Graphics::GlobalData::LoadParams ImageLoadParams(bool textures = true);
+
 STRUCT( StateBase EXTENDS GameUtils::State::Base POLYMORPHIC )
 {
     virtual void Render() const = 0;
+
+    // Called when the map or ship object files change on disk (in non-prod builds only).
+    virtual void MapFilesChanged(const std::vector<std::string> &paths) {(void)paths;}
 };
@@ -33,6 +33,59 @@ auto ShipGridData::GetRawTileInfoArray() -> std::array<TileInfo, std::to_underly
     return ret;
 }
 
+namespace ShipObjectCache
+{
+    static phmap::flat_hash_map<std::string, Map<ShipGrid>> prototypes;
+    static Counters counters;
+
+    std::string ObjectDir()
+    {
+        return Program::ExeDir() + "assets/objects/";
+    }
+
+    std::string NameToFilename(std::string_view name)
+    {
+        return FMT("{}{}.json", ObjectDir(), name);
+    }
+
+    const Map<ShipGrid> &Get(std::string_view name)
+    {
+        if (auto it = prototypes.find(name); it != prototypes.end())
+        {
+            counters.hits++;
+            return it->second;
+        }
+
+        counters.misses++;
+        // Parse before inserting, to not cache anything if this throws.
+        Map<ShipGrid> map(NameToFilename(name));
+        return prototypes.try_emplace(std::string(name), std::move(map)).first->second;
+    }
+
+    bool Invalidate(const std::vector<std::string> &paths)
+    {
+        std::string dir = ObjectDir();
+
+        bool ret = false;
+        for (const std::string &path : paths)
+        {
+            if (!path.starts_with(dir) || !path.ends_with(".json"))
+                continue;
+            if (prototypes.erase(std::string_view(path).substr(dir.size(), path.size() - dir.size() - 5)))
+            {
+                counters.invalidations++;
+                ret = true;
+            }
+        }
+        return ret;
+    }
+
+    Counters GetCounters()
+    {
+        return counters;
+    }
+}
+
 MapObject::MapObject(Stream::Input input)
     : map(std::move(input), &bg_map)
 {
@@ -66,7 +119,7 @@ MapObject::MapObject(Stream::Input input)
         }
 
         auto &new_blocks = game.create<ShipPartBlocks>();
-        new_blocks.map = Map<ShipGrid>(FMT("{}assets/objects/{}.json", Program::ExeDir(), name));
+        new_blocks.map = ShipObjectCache::Get(name);
         new_blocks.pos = iround(pos);
 
         DecomposeToComponentsAndDelete(new_blocks, [&](ShipPartBlocks &blocks)
@@ -63,13 +63,14 @@ struct WorldGridData
     static constexpr int tile_size = 12;
     static constexpr bool have_normal_visible_tiles = false;
 
-    enum class Tile
+    enum class Tile : std::uint8_t
     {
         air,
         wall,
         bg,
         _count [[maybe_unused]]
     };
+    ENUM_METADATA( Tile AT_CLASS_SCOPE, (air)(wall)(bg) )
 
     struct TileInfo
     {
@@ -95,7 +96,7 @@ struct ShipGridData
     static constexpr int tile_size = 4;
     static constexpr bool have_normal_visible_tiles = false;
 
-    enum class Tile
+    enum class Tile : std::uint8_t
     {
         air,
         block,
@@ -105,6 +106,7 @@ struct ShipGridData
         emerald,
         _count [[maybe_unused]]
     };
+    ENUM_METADATA( Tile AT_CLASS_SCOPE, (air)(block)(piston_h)(piston_v)(goal)(emerald) )
 
     enum class PistonRelation
     {
@@ -144,11 +146,13 @@ template <typename Grid>
 class Map
 {
   public:
+    // This has no padding, so arrays of cells are serialized with a single copy.
     struct Cell
     {
-        typename Grid::Tile tile{};
-
-        unsigned char noise = 0;
+        MEMBERS(
+            DECL(typename Grid::Tile INIT{}) tile
+            DECL(unsigned char INIT{}) noise
+        )
 
         void RegenerateNoise()
         {
@@ -156,7 +160,11 @@ class Map
         }
     };
 
+  private:
+    // Private, since changing the cells must invalidate `dual_grid_indices`. Use `ModifyCells()` or `SetCell()`.
     Array2D<Cell, int> cells;
+
+  public:
     Tiled::PointLayer points;
 
     Map() {}
@@ -182,7 +190,7 @@ class Map
 
     Map(Stream::Input source, Map *bg_map = nullptr)
     {
-        Json json(source.ReadToMemory().string(), 32);
+        Json json(source.ReadToMemory(), 32);
 
         if (auto la = Tiled::FindLayerOpt(json.GetView(), "objects"))
             points = Tiled::LoadPointLayer(la);
@@ -207,6 +215,61 @@ class Map
         }
     }
 
+    [[nodiscard]] const Array2D<Cell, int> &Cells() const
+    {
+        return cells;
+    }
+
+    // Returns the cells for arbitrary changes, including resizing. The dual grid indices are recomputed for the whole map when it's rendered next time.
+    // Don't hold on to the reference across renders. Prefer `SetCell()` for small changes.
+    [[nodiscard]] Array2D<Cell, int> &ModifyCells()
+    {
+        dual_grid_indices_dirty = true;
+        return cells;
+    }
+
+    // Changes a single cell, and updates the dual grid indices for the 2x2 tiles touching it.
+    void SetCell(ivec2 pos, const Cell &cell)
+    {
+        cells.safe_throwing_at(pos) = cell;
+        if (!dual_grid_indices_dirty)
+        {
+            UpdateDualGridIndicesInRect<TileDrawMethods::RenderMode::pre>((pos - 1).rect_size(2));
+            UpdateDualGridIndicesInRect<TileDrawMethods::RenderMode::normal>((pos - 1).rect_size(2));
+        }
+    }
+
+    // Calls `func(ivec2 pixel_pos, irect2 tex_rect, float alpha)` for every visible dual grid tile with `a <= tile_pos < b`, in all passes of this `Mode`.
+    // A dual grid tile covers the cells from `tile_pos` to `tile_pos + 1`, so the meaningful range is from -1 to `cells.size() - 1`.
+    // `pixel_pos` is relative to the map origin, and `tex_rect` is in absolute atlas coordinates.
+    template <TileDrawMethods::RenderMode Mode, typename F>
+    void ForEachDualGridTile(ivec2 a, ivec2 b, F &&func) const
+    {
+        auto passes = GetDualGridPasses<Mode>();
+        if (passes.empty())
+            return;
+
+        UpdateDirtyDualGridIndices();
+
+        const auto &image = Grid::GetImage();
+
+        for (std::size_t pass_index = 0; pass_index < passes.size(); pass_index++)
+        {
+            const auto &pass = passes[pass_index];
+            const Array2D<std::uint8_t, int> &indices = dual_grid_indices[std::to_underlying(Mode)][pass_index];
+
+            for (ivec2 tile_pos : a <= vector_range </*sic*/ b)
+            {
+                int index = indices.safe_nonthrowing_at(tile_pos + 1);
+                if (index == 0)
+                    continue;
+
+                ivec2 pixel_pos = tile_pos * Grid::tile_size + Grid::tile_size / 2;
+                func(pixel_pos, (image.a + Grid::tile_size * (pass.tex + ivec2(index - 1, 0))).rect_size(Grid::tile_size), pass.alpha);
+            }
+        }
+    }
+
     template <TileDrawMethods::RenderMode Mode>
     void Render(ivec2 camera_pos) const
     {
@@ -217,40 +280,16 @@ class Map
 
         if constexpr (Mode == TileDrawMethods::RenderMode::pre ? requires{Grid::dual_grid_pre_passes;} : requires{Grid::dual_grid_passes;})
         {
-            std::span<const TileDrawMethods::DualGridPass<typename Grid::data_t>> passes;
-            if constexpr (Mode == TileDrawMethods::RenderMode::pre)
-                passes = Grid::dual_grid_pre_passes;
-            else
-                passes = Grid::dual_grid_passes;
-
             ivec2 a = div_ex(camera_pos - screen_size / 2 - Grid::tile_size / 2, Grid::tile_size);
             ivec2 b = div_ex(camera_pos + screen_size / 2 + Grid::tile_size / 2, Grid::tile_size);
 
             clamp_var_min(a, -1);
             clamp_var_max(b, cells.size());
 
-            for (const auto &pass : passes)
+            ForEachDualGridTile<Mode>(a, b, [&](ivec2 pixel_pos, irect2 tex_rect, float alpha)
             {
-                for (ivec2 tile_pos : a <= vector_range </*sic*/ b)
-                {
-                    ivec2 pixel_pos = tile_pos * Grid::tile_size + Grid::tile_size / 2 - camera_pos;
-
-                    auto GetBit = [&](ivec2 offset) -> bool
-                    {
-                        ivec2 point = tile_pos + offset;
-                        if (cells.bounds().contains(point))
-                            return std::find(pass.tiles.begin(), pass.tiles.end(), cells.safe_nonthrowing_at(point).tile) != pass.tiles.end();
-                        else
-                            return false;
-                    };
-
-                    int index = GetBit(ivec2(1,1)) | GetBit(ivec2(0,1)) << 1 | GetBit(ivec2(0,0)) << 2 | GetBit(ivec2(1,0)) << 3;
-                    if (index == 0)
-                        continue;
-
-                    r.iquad(pixel_pos, image with(= (_.a + Grid::tile_size * (pass.tex + ivec2(index - 1, 0))).rect_size(Grid::tile_size))).alpha(pass.alpha);
-                }
-            }
+                r.iquad(pixel_pos - camera_pos, image with(= tex_rect)).alpha(alpha);
+            });
         }
 
         if constexpr (Grid::have_normal_visible_tiles && Mode == TileDrawMethods::RenderMode::normal)
@@ -306,11 +345,11 @@ class Map
         }
         else
         {
-            if (!(cells.bounds() * Grid::tile_size + self_relative_pos).touches(other.cells.bounds() * OtherGrid::tile_size))
+            if (!(cells.bounds() * Grid::tile_size + self_relative_pos).touches(other.Cells().bounds() * OtherGrid::tile_size))
                 return false;
 
             ivec2 a = div_ex(-self_relative_pos, Grid::tile_size);
-            ivec2 b = div_ex(-self_relative_pos + other.cells.size() * OtherGrid::tile_size - 1, Grid::tile_size);
+            ivec2 b = div_ex(-self_relative_pos + other.Cells().size() * OtherGrid::tile_size - 1, Grid::tile_size);
             clamp_var_min(a, 0);
             clamp_var_max(b, cells.size() - 1);
 
@@ -328,6 +367,193 @@ class Map
             return false;
         }
     }
+
+  private:
+    // For each pass, the dual grid tile index (0 = empty) for every tile, indexed by `TileDrawMethods::RenderMode`.
+    // The arrays are offset by 1, since the dual grid tiles go from -1 to `cells.size() - 1`.
+    // Those are computed lazily when rendering, since `ModifyCells()` can't know when the changes end.
+    mutable std::array<std::vector<Array2D<std::uint8_t, int>>, 2> dual_grid_indices;
+    // If true, `dual_grid_indices` are outdated.
+    mutable bool dual_grid_indices_dirty = true;
+
+    template <TileDrawMethods::RenderMode Mode>
+    [[nodiscard]] static std::span<const TileDrawMethods::DualGridPass<typename Grid::data_t>> GetDualGridPasses()
+    {
+        if constexpr (Mode == TileDrawMethods::RenderMode::pre ? requires{Grid::dual_grid_pre_passes;} : requires{Grid::dual_grid_passes;})
+        {
+            if constexpr (Mode == TileDrawMethods::RenderMode::pre)
+                return Grid::dual_grid_pre_passes;
+            else
+                return Grid::dual_grid_passes;
+        }
+        else
+        {
+            return {};
+        }
+    }
+
+    [[nodiscard]] int ComputeDualGridIndex(const TileDrawMethods::DualGridPass<typename Grid::data_t> &pass, ivec2 tile_pos) const
+    {
+        auto GetBit = [&](ivec2 offset) -> bool
+        {
+            ivec2 point = tile_pos + offset;
+            if (cells.bounds().contains(point))
+                return std::find(pass.tiles.begin(), pass.tiles.end(), cells.safe_nonthrowing_at(point).tile) != pass.tiles.end();
+            else
+                return false;
+        };
+
+        return GetBit(ivec2(1,1)) | GetBit(ivec2(0,1)) << 1 | GetBit(ivec2(0,0)) << 2 | GetBit(ivec2(1,0)) << 3;
+    }
+
+    // Recomputes the dual grid indices for the whole map, if they're outdated.
+    void UpdateDirtyDualGridIndices() const
+    {
+        if (!dual_grid_indices_dirty)
+            return;
+        ResetDualGridIndices<TileDrawMethods::RenderMode::pre>();
+        ResetDualGridIndices<TileDrawMethods::RenderMode::normal>();
+        dual_grid_indices_dirty = false;
+    }
+
+    template <TileDrawMethods::RenderMode Mode>
+    void ResetDualGridIndices() const
+    {
+        dual_grid_indices[std::to_underlying(Mode)].assign(GetDualGridPasses<Mode>().size(), Array2D<std::uint8_t, int>(cells.size() + 1));
+        UpdateDualGridIndicesInRect<Mode>(ivec2(-1).rect_to(cells.size()));
+    }
+
+    // Recomputes the dual grid indices for the tiles in `tiles`.
+    template <TileDrawMethods::RenderMode Mode>
+    void UpdateDualGridIndicesInRect(irect2 tiles) const
+    {
+        auto passes = GetDualGridPasses<Mode>();
+        tiles = tiles.intersect(ivec2(-1).rect_to(cells.size()));
+        if (!tiles.has_area())
+            return;
+
+        for (std::size_t pass_index = 0; pass_index < passes.size(); pass_index++)
+        {
+            auto &indices = dual_grid_indices[std::to_underlying(Mode)][pass_index];
+            for (ivec2 tile_pos : tiles.a <= vector_range < tiles.b)
+                indices.safe_nonthrowing_at(tile_pos + 1) = std::uint8_t(ComputeDualGridIndex(passes[pass_index], tile_pos));
+        }
+    }
+};
+
+// Caches the dual grid vertices of a `Map`, split into square chunks.
+// A chunk is generated when it's first rendered, and then reused until `InvalidateCells()` is called on it.
+template <typename Grid>
+class MapRenderCache
+{
+    static_assert(!Grid::have_normal_visible_tiles, "Non-dual-grid tiles are not supported by the cache yet.");
+
+  public:
+    // The chunk size, in dual grid tiles. Chunk `i` covers the tiles from `i * chunk_size - 1` to `(i + 1) * chunk_size - 2` inclusive.
+    static constexpr int chunk_size = 16;
+
+  private:
+    struct Chunk
+    {
+        bool dirty = true;
+        std::array<Render::VertexList, 2> vertices; // Indexed by `TileDrawMethods::RenderMode`.
+    };
+
+    mutable Array2D<Chunk, int> chunks;
+    mutable ivec2 map_size; // The map size the chunks were created for.
+
+    void UpdateSize(const Map<Grid> &map) const
+    {
+        if (map_size == map.Cells().size() && chunks.size() != ivec2(0))
+            return;
+        map_size = map.Cells().size();
+        chunks = {};
+        chunks.resize(ChunkCount(map_size));
+    }
+
+    template <TileDrawMethods::RenderMode Mode>
+    static void GenerateChunkVertices(const Map<Grid> &map, ivec2 chunk_pos, Render::VertexList &list)
+    {
+        ivec2 a = chunk_pos * chunk_size - 1;
+        ivec2 b = min(a + chunk_size, map.Cells().size());
+
+        list.Clear();
+        map.template ForEachDualGridTile<Mode>(a, b, [&](ivec2 pixel_pos, irect2 tex_rect, float alpha)
+        {
+            list.iquad(pixel_pos, tex_rect.size()).tex(tex_rect).alpha(alpha);
+        });
+    }
+
+  public:
+    MapRenderCache() {}
+
+    // Returns the number of chunks for a map of this size.
+    [[nodiscard]] static ivec2 ChunkCount(ivec2 map_size)
+    {
+        return div_ex(map_size + chunk_size, chunk_size); // The tiles go from -1 to `map_size - 1`.
+    }
+
+    // Call this after modifying cells in the `rect`.
+    // Regenerates the affected chunks the next time they're rendered.
+    void InvalidateCells(irect2 rect)
+    {
+        if (!rect.has_area())
+            return;
+
+        // A cell affects two dual grid tiles on each axis: `pos - 1` and `pos`.
+        ivec2 a = div_ex(rect.a, chunk_size);
+        ivec2 b = div_ex(rect.b, chunk_size);
+        clamp_var_min(a, 0);
+        clamp_var_max(b, chunks.size() - 1);
+
+        for (ivec2 chunk_pos : a <= vector_range <= b)
+            chunks.safe_nonthrowing_at(chunk_pos).dirty = true;
+    }
+
+    // Regenerates everything.
+    void InvalidateAll()
+    {
+        chunks = {};
+    }
+
+    // Returns the vertices of a single chunk, in map coordinates. Generates them if necessary.
+    // Doesn't need a GL context, since the vertices are generated on the CPU.
+    template <TileDrawMethods::RenderMode Mode>
+    [[nodiscard]] const std::vector<Render::Vertex> &GetChunkVertices(const Map<Grid> &map, ivec2 chunk_pos) const
+    {
+        UpdateSize(map);
+
+        Chunk &chunk = chunks.safe_throwing_at(chunk_pos);
+        if (chunk.dirty)
+        {
+            chunk.dirty = false;
+            GenerateChunkVertices<TileDrawMethods::RenderMode::pre>(map, chunk_pos, chunk.vertices[std::to_underlying(TileDrawMethods::RenderMode::pre)]);
+            GenerateChunkVertices<TileDrawMethods::RenderMode::normal>(map, chunk_pos, chunk.vertices[std::to_underlying(TileDrawMethods::RenderMode::normal)]);
+        }
+
+        return chunk.vertices[std::to_underlying(Mode)].Vertices();
+    }
+
+    // Same as `map.Render<Mode>(camera_pos)`, but only draws the visible chunks, from the cache.
+    template <TileDrawMethods::RenderMode Mode>
+    void Render(const Map<Grid> &map, ivec2 camera_pos) const
+    {
+        if (!map.Cells().bounds().has_area())
+            return;
+
+        UpdateSize(map);
+
+        // Same as in `Map::Render()`, but converted to chunks.
+        ivec2 a = div_ex(camera_pos - screen_size / 2 - Grid::tile_size / 2, Grid::tile_size);
+        ivec2 b = div_ex(camera_pos + screen_size / 2 + Grid::tile_size / 2, Grid::tile_size);
+        a = div_ex(a + 1, chunk_size);
+        b = div_ex(b, chunk_size);
+        clamp_var_min(a, 0);
+        clamp_var_max(b, chunks.size() - 1);
+
+        for (ivec2 chunk_pos : a <= vector_range <= b)
+            r.AddVertices(GetChunkVertices<Mode>(map, chunk_pos), -camera_pos);
+    }
 };
 
 struct MapObject
@@ -340,12 +566,39 @@ struct MapObject
     Map<WorldGrid> bg_map;
     Map<WorldGrid> map;
 
+    // Those maps never change after loading, so we cache their geometry.
+    MapRenderCache<WorldGrid> bg_map_render_cache;
+    MapRenderCache<WorldGrid> map_render_cache;
+
     MapObject() {}
     MapObject(Stream::Input input);
 
     void RenderMap() const
     {
-        bg_map.Render<TileDrawMethods::RenderMode::normal>(game.get<Camera>()->pos - pos);
-        map.Render<TileDrawMethods::RenderMode::normal>(game.get<Camera>()->pos - pos);
+        bg_map_render_cache.Render<TileDrawMethods::RenderMode::normal>(bg_map, game.get<Camera>()->pos - pos);
+        map_render_cache.Render<TileDrawMethods::RenderMode::normal>(map, game.get<Camera>()->pos - pos);
     }
 };
+
+// The ship objects from `assets/objects/`, parsed once per process. `MapObject` copies them instead of parsing the files for every instance.
+namespace ShipObjectCache
+{
+    struct Counters
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0; // Each miss parses a file.
+        std::size_t invalidations = 0;
+    };
+
+    [[nodiscard]] std::string ObjectDir();
+    [[nodiscard]] std::string NameToFilename(std::string_view name);
+
+    // Parses the object on the first use. The reference remains valid until the next call to any of those functions.
+    [[nodiscard]] const Map<ShipGrid> &Get(std::string_view name);
+
+    // Forgets the objects loaded from those files. `paths` are full paths, as returned by `NameToFilename()`.
+    // Returns true if at least one of them was cached.
+    bool Invalidate(const std::vector<std::string> &paths);
+
+    [[nodiscard]] Counters GetCounters();
+}
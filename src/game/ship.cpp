@@ -53,6 +53,15 @@ bool DynamicSolidTree::ShipBlocksCollisionTest(
     });
 }
 
+void DynamicSolidTree::ForEachEntityTouchingBox(irect2 box, std::function<void(Game::Entity &e)> func) const
+{
+    (void)aabb_tree.CollideAabb(box, [&](Tree::NodeIndex node_index)
+    {
+        func(game.get(aabb_tree.GetNodeUserData(node_index)));
+        return false;
+    });
+}
+
 void ShipPartBlocks::Tick()
 {
     // std::cout << (map.CollidesWithMap(game.get<MapObject>()->map, pos - game.get<MapObject>()->pos)) << '\n';
@@ -74,12 +83,12 @@ void ShipPartBlocks::PreRender() const
 void ShipPartBlocks::Render() const
 {
     // Bounding box:
-    // r.iquad(pos - game.get<Camera>()->pos, map.cells.size() * ShipGrid::tile_size).color(fvec3(0)).alpha(0.1f);
+    // r.iquad(pos - game.get<Camera>()->pos, map.Cells().size() * ShipGrid::tile_size).color(fvec3(0)).alpha(0.1f);
 
     map.Render<TileDrawMethods::RenderMode::normal>(game.get<Camera>()->pos - pos - RenderOffset());
 
     // ID:
-    // r.itext(pos - game.get<Camera>()->pos + map.cells.size() * ShipGrid::tile_size / 2, Graphics::Text(Fonts::main, FMT("{}", dynamic_cast<const Game::Entity &>(*this).id().get_value()))).align(ivec2(0)).color(fvec3(1,0,0));
+    // r.itext(pos - game.get<Camera>()->pos + map.Cells().size() * ShipGrid::tile_size / 2, Graphics::Text(Fonts::main, FMT("{}", dynamic_cast<const Game::Entity &>(*this).id().get_value()))).align(ivec2(0)).color(fvec3(1,0,0));
 }
 
 int ShipPartPiston::DistanceToPoint(ivec2 point) const
@@ -233,7 +242,7 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
         return piston == ShipGrid::PistonRelation::solid_attachable || piston == ShipGrid::PistonRelation::solid_non_attachable;
     };
 
-    Array2D<char/*bool*/, int> visited(self.map.cells.size());
+    Array2D<char/*bool*/, int> visited(self.map.Cells().size());
 
     struct QueuedPiston
     {
@@ -249,9 +258,9 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
     // Maps block position to pistons ending here.
     phmap::flat_hash_map<ivec2, std::vector<QueuedPiston>> queued_pistons;
 
-    for (ivec2 tile_pos : vector_range(self.map.cells.size()))
+    for (ivec2 tile_pos : vector_range(self.map.Cells().size()))
     {
-        if (IsRegularTile(self.map.cells.safe_nonthrowing_at(tile_pos).tile) && !visited.safe_nonthrowing_at(tile_pos))
+        if (IsRegularTile(self.map.Cells().safe_nonthrowing_at(tile_pos).tile) && !visited.safe_nonthrowing_at(tile_pos))
         {
             auto &new_part = game.create<ShipPartBlocks>();
 
@@ -259,9 +268,9 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
 
             auto lambda = [&](auto &lambda, ivec2 abs_tile_pos) -> void
             {
-                if (!self.map.cells.bounds().contains(abs_tile_pos))
+                if (!self.map.Cells().bounds().contains(abs_tile_pos))
                     return;
-                const ShipGrid::Tile this_tile = self.map.cells.safe_nonthrowing_at(abs_tile_pos).tile;
+                const ShipGrid::Tile this_tile = self.map.Cells().safe_nonthrowing_at(abs_tile_pos).tile;
                 if (!IsRegularTile(this_tile))
                     return;
                 if (auto &flag = visited.safe_nonthrowing_at(abs_tile_pos))
@@ -271,15 +280,15 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
 
                 ivec2 rel_tile_pos = abs_tile_pos - new_part_tile_offset;
 
-                if (!new_part.map.cells.bounds().contains(rel_tile_pos))
+                if (!new_part.map.Cells().bounds().contains(rel_tile_pos))
                 {
                     ivec2 delta = clamp_max(rel_tile_pos, 0);
-                    new_part.map.cells.resize(new_part.map.cells.bounds().combine(rel_tile_pos).size(), -delta);
+                    new_part.map.ModifyCells().resize(new_part.map.Cells().bounds().combine(rel_tile_pos).size(), -delta);
                     new_part_tile_offset += delta;
                     rel_tile_pos -= delta;
                 }
 
-                new_part.map.cells.safe_nonthrowing_at(rel_tile_pos) = self.map.cells.safe_nonthrowing_at(abs_tile_pos);
+                new_part.map.ModifyCells().safe_nonthrowing_at(rel_tile_pos) = self.map.Cells().safe_nonthrowing_at(abs_tile_pos);
 
                 // Handle pistons arriving here.
                 if (auto iter = queued_pistons.find(abs_tile_pos); iter != queued_pistons.end())
@@ -320,7 +329,7 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
                         while (true)
                         {
                             ivec2 new_pos = piston_tile_pos + step;
-                            if (!self.map.cells.bounds().contains(new_pos) || self.map.cells.safe_nonthrowing_at(new_pos).tile != piston_tile_type)
+                            if (!self.map.Cells().bounds().contains(new_pos) || self.map.Cells().safe_nonthrowing_at(new_pos).tile != piston_tile_type)
                                 break;
                             piston_tile_pos = new_pos;
                         }
@@ -329,8 +338,8 @@ void DecomposeToComponentsAndDelete(ShipPartBlocks &self, std::function<void(Shi
                         {
                             ivec2 end_tile_pos = piston_tile_pos + step;
                             if (
-                                self.map.cells.bounds().contains(end_tile_pos) &&
-                                ShipGrid::GetTileInfo(self.map.cells.safe_nonthrowing_at(end_tile_pos).tile).piston == ShipGrid::PistonRelation::solid_attachable &&
+                                self.map.Cells().bounds().contains(end_tile_pos) &&
+                                ShipGrid::GetTileInfo(self.map.Cells().safe_nonthrowing_at(end_tile_pos).tile).piston == ShipGrid::PistonRelation::solid_attachable &&
                                 !visited.safe_nonthrowing_at(end_tile_pos) // This likely means that the piston has the same part on both sides.
                             )
                             {
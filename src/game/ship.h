@@ -19,6 +19,10 @@ struct DynamicSolidTree
     // AABB boxes should are automatically expanded by this amount before inserting into the tree.
     static constexpr int slack_margin = 2;
 
+    // When culling entities for rendering, the screen rect is expanded by this amount,
+    // because the sprites can stick out of the AABBs a bit (dual grid tiles, piston sprites, the floating offset).
+    static constexpr int visibility_margin = ShipGrid::tile_size * 2;
+
     // Here, if `entity_filter` returns false, the entity is ignored.
     // `entity_callback` defaults to `return collide(ivec2{});`. You can return false unconditionally to ignore this entity,
     // or you can change the offset before calling `collide` to imaginarily offset that entity.
@@ -38,6 +42,10 @@ struct DynamicSolidTree
         EntityFilterFunc entity_filter = nullptr,
         EntityCallbackFunc entity_callback = nullptr
     ) const;
+
+    // Calls `func` for every entity with the AABB touching `box`, in no particular order.
+    // Unlike the collision tests above, this only looks at the AABBs.
+    void ForEachEntityTouchingBox(irect2 box, std::function<void(Game::Entity &e)> func) const;
 };
 
 struct DynamicSolid
@@ -89,6 +97,39 @@ struct DynamicSolid
     DynamicSolidTree::Tree::NodeIndex node_index = DynamicSolidTree::Tree::null_index;
 };
 
+// Matches entities that have component `C`, but aren't `DynamicSolid`, so they don't have AABBs.
+template <typename C>
+struct HasComponentWithoutAabb : Ent::PredicateBase<Game>
+{
+    bool Matches(const Ent::EntityDesc<Game> &desc) const override
+    {
+        return desc.Has<C>() && !desc.Has<DynamicSolid>();
+    }
+};
+
+// Returns the entities with component `C` that can be visible on the screen,
+// in the same order as they appear in `Game::Category<Ent::OrderedList, C>`.
+// `DynamicSolid` entities are culled using their AABBs (so they're skipped if they have none). Other entities are always returned.
+template <typename C>
+[[nodiscard]] std::vector<Game::Entity *> FindVisibleEntities()
+{
+    std::vector<Game::Entity *> ret;
+
+    irect2 view = (game.get<Camera>()->pos - screen_size / 2).rect_size(screen_size).expand(DynamicSolidTree::visibility_margin);
+    game.get<DynamicSolidTree>()->ForEachEntityTouchingBox(view, [&](Game::Entity &e)
+    {
+        if (e.has<C>())
+            ret.push_back(&e);
+    });
+
+    for (auto &e : game.get<Game::CustomCategory<Ent::OrderedList, HasComponentWithoutAabb<C>>>())
+        ret.push_back(&e);
+
+    // Restore the order of the ordered lists, since the tree returns the entities in arbitrary order.
+    std::sort(ret.begin(), ret.end(), [](const Game::Entity *a, const Game::Entity *b){return a->id() < b->id();});
+    return ret;
+}
+
 struct BasicShipPart
 {
     IMP_COMPONENT(Game)
@@ -122,7 +163,7 @@ struct ShipPartBlocks :
 
     irect2 CalculateRect() const
     {
-        return pos.rect_size(map.cells.size() * ShipGrid::tile_size);
+        return pos.rect_size(map.Cells().size() * ShipGrid::tile_size);
     }
 
     void UpdateAabb()
@@ -1,3 +1,4 @@
+#include "game/compiled_level.h"
 #include "game/draw.h"
 #include "game/entities.h"
 #include "game/goal_controller.h"
@@ -5,7 +6,7 @@
 #include "game/map.h"
 #include "game/ship.h"
 #include "game/ui.h"
-#include "utils/filesystem.h"
+#include "stream/asset_pack.h"
 
 
 namespace States
@@ -29,24 +30,24 @@ namespace States
             is_fullscreen = !is_fullscreen;
         }
 
-        static std::string LevelIndexToFilename(int index)
-        {
-            return FMT("{}assets/maps/{}.json", Program::ExeDir(), index);
-        }
-
         void LoadLevel(int index)
         {
             cur_level_index = index;
 
-            game = nullptr;
+            ResetGameForLevel();
+            game.get<GoalController>()->level_name = index == 0 ? "" : FMT("{}/{}", index, max_level_index);
 
-            game.create<DynamicSolidTree>();
-            game.create<PistonMouseController>();
-            game.create<GravityController>();
-            game.create<GoalController>().level_name = index == 0 ? "" : FMT("{}/{}", index, max_level_index);
+            // Release builds prefer the compiled levels. Development builds always load the JSON, to allow hot reloading.
+            // If the compiled level is missing or can't be loaded, the JSON is used. Its staleness is checked when packing the assets, not here.
+            std::optional<CompiledLevel> compiled_level;
+            if (IMP_PLATFORM_IS(prod))
+                compiled_level = CompiledLevel::Load(LevelIndexToCompiledFilename(index));
 
-            game.create<MapObject>(LevelIndexToFilename(index));
-            game.create<Camera>().pos = game.get<MapObject>()->map.cells.size() * WorldGrid::tile_size / 2;
+            if (compiled_level)
+                compiled_level->CreateEntities();
+            else
+                game.create<MapObject>(LevelIndexToFilename(index));
+            game.create<Camera>().pos = game.get<MapObject>()->map.Cells().size() * WorldGrid::tile_size / 2;
         }
 
         void Init() override
@@ -62,18 +63,20 @@ namespace States
             Audio::Volume(2.5f);
 
             // Count the levels.
-            while (true)
-            {
-                bool ok = true;
-                (void)Filesystem::GetObjectInfo(LevelIndexToFilename(max_level_index + 1), &ok);
-                if (!ok)
-                    break;
+            while (Stream::AssetPack::FileExists(LevelIndexToFilename(max_level_index + 1)))
                 max_level_index++;
-            }
 
             LoadLevel(cur_level_index);
         }
 
+        void MapFilesChanged(const std::vector<std::string> &paths) override
+        {
+            // The objects can be used by any level, so reload on any object change.
+            std::string level_path = LevelIndexToFilename(cur_level_index);
+            if (std::any_of(paths.begin(), paths.end(), [&](const std::string &path){return path == level_path || path.starts_with(ShipObjectCache::ObjectDir());}))
+                LoadLevel(cur_level_index);
+        }
+
         void Tick(std::string &next_state) override
         {
             (void)next_state;
@@ -126,8 +129,12 @@ namespace States
 
         void Render() const override
         {
-            Graphics::SetClearColor(fvec3(0));
-            Graphics::Clear();
+            // A capturing renderer (see `Render::capture`) is used to profile and compare frames without GL.
+            if (!r.IsCapturing())
+            {
+                Graphics::SetClearColor(fvec3(0));
+                Graphics::Clear();
+            }
 
             r.BindShader();
 
@@ -136,10 +143,10 @@ namespace States
 
             for (auto &e : game.get<Game::Category<Ent::OrderedList, MapObject>>())
                 e.get<MapObject>().RenderMap();
-            for (auto &e : game.get<AllPreRenderable>())
-                e.get<PreRenderable>().PreRender();
-            for (auto &e : game.get<AllRenderable>())
-                e.get<Renderable>().Render();
+            for (Game::Entity *e : FindVisibleEntities<PreRenderable>())
+                e->get<PreRenderable>().PreRender();
+            for (Game::Entity *e : FindVisibleEntities<Renderable>())
+                e->get<Renderable>().Render();
 
             // Vignette.
             r.iquad(ivec2(), "vignette"_image).center().color(fvec3(0.2f, 0.45f, 0.8f)).mix(0).alpha(0.2f);
@@ -0,0 +1,382 @@
+#include "game/compiled_level.h"
+#include "game/map.h"
+#include "stream/asset_pack.h"
+#include "stream/save_to_file.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+TEST_CASE("map.render_cache_matches_uncached")
+{
+    Map<WorldGrid> map;
+    map.ModifyCells().resize(ivec2(37, 23)); // Not a multiple of the chunk size on purpose.
+
+    auto FillCells = [&](irect2 rect, int seed)
+    {
+        for (ivec2 pos : rect.a <= vector_range < rect.b)
+            map.ModifyCells().safe_nonthrowing_at(pos).tile = WorldGrid::Tile((pos.x * 7 + pos.y * 13 + pos.x * pos.y + seed) % std::to_underlying(WorldGrid::Tile::_count));
+    };
+
+    // Returns the quads sorted by position and texture, since the cache emits them in a different order.
+    auto SortedQuads = [](const std::vector<Render::Vertex> &vertices)
+    {
+        REQUIRE(vertices.size() % 4 == 0);
+        std::vector<std::array<Render::Vertex, 4>> ret(vertices.size() / 4);
+        for (std::size_t i = 0; i < vertices.size(); i++)
+            ret[i / 4][i % 4] = vertices[i];
+        std::sort(ret.begin(), ret.end(), [](const auto &a, const auto &b)
+        {
+            return std::tuple(a[0].pos.y, a[0].pos.x, a[0].texcoord.y, a[0].texcoord.x) < std::tuple(b[0].pos.y, b[0].pos.x, b[0].texcoord.y, b[0].texcoord.x);
+        });
+        return ret;
+    };
+
+    MapRenderCache<WorldGrid> cache;
+
+    auto Check = [&]
+    {
+        // This is what `Map::Render()` draws each frame, if the whole map is visible.
+        Render::VertexList expected;
+        map.ForEachDualGridTile<TileDrawMethods::RenderMode::normal>(ivec2(-1), map.Cells().size(), [&](ivec2 pixel_pos, irect2 tex_rect, float alpha)
+        {
+            expected.iquad(pixel_pos, tex_rect.size()).tex(tex_rect).alpha(alpha);
+        });
+        REQUIRE(!expected.Vertices().empty());
+
+        std::vector<Render::Vertex> actual;
+        for (ivec2 chunk_pos : vector_range(cache.ChunkCount(map.Cells().size())))
+        {
+            const auto &chunk = cache.GetChunkVertices<TileDrawMethods::RenderMode::normal>(map, chunk_pos);
+            actual.insert(actual.end(), chunk.begin(), chunk.end());
+        }
+
+        REQUIRE(SortedQuads(actual) == SortedQuads(expected.Vertices()));
+    };
+
+    FillCells(map.Cells().bounds(), 0);
+    Check();
+
+    // Edit a region crossing chunk boundaries.
+    irect2 edited = ivec2(14, 3).rect_to(ivec2(19, 17));
+    FillCells(edited, 1);
+    cache.InvalidateCells(edited);
+    Check();
+
+    // Edit the corner cells.
+    FillCells(ivec2(0).rect_size(1), 2);
+    cache.InvalidateCells(ivec2(0).rect_size(1));
+    FillCells((map.Cells().size() - 1).rect_size(1), 2);
+    cache.InvalidateCells((map.Cells().size() - 1).rect_size(1));
+    Check();
+
+    // Resize the map.
+    map.ModifyCells().resize(ivec2(16, 5));
+    FillCells(map.Cells().bounds(), 3);
+    Check();
+}
+
+TEST_CASE("map.dual_grid_indices")
+{
+    Map<ShipGrid> map;
+    map.ModifyCells().resize(ivec2(11, 9));
+
+    // Compares the tiles against a copy of the map, which computes its indices from scratch.
+    auto Check = [&]
+    {
+        Map<ShipGrid> uncached;
+        uncached.ModifyCells() = map.Cells();
+
+        auto Collect = [&]<TileDrawMethods::RenderMode Mode>(const Map<ShipGrid> &m)
+        {
+            std::vector<std::tuple<ivec2, irect2, float>> ret;
+            m.ForEachDualGridTile<Mode>(ivec2(-1), m.Cells().size(), [&](ivec2 pixel_pos, irect2 tex_rect, float alpha)
+            {
+                ret.emplace_back(pixel_pos, tex_rect, alpha);
+            });
+            return ret;
+        };
+
+        REQUIRE(Collect.operator()<TileDrawMethods::RenderMode::pre>(map) == Collect.operator()<TileDrawMethods::RenderMode::pre>(uncached));
+        REQUIRE(Collect.operator()<TileDrawMethods::RenderMode::normal>(map) == Collect.operator()<TileDrawMethods::RenderMode::normal>(uncached));
+    };
+
+    Check();
+
+    const ShipGrid::Tile tiles[] = {ShipGrid::Tile::block, ShipGrid::Tile::goal, ShipGrid::Tile::emerald, ShipGrid::Tile::air};
+    int i = 0;
+    for (ivec2 pos : vector_range(map.Cells().size()))
+    {
+        if ((pos.x * 5 + pos.y * 3) % 4 == 0)
+            continue;
+        map.SetCell(pos, {.tile = tiles[i++ % std::size(tiles)]});
+    }
+    Check();
+
+    // Edit the corners and the edges.
+    map.SetCell(ivec2(0), {.tile = ShipGrid::Tile::block});
+    map.SetCell(map.Cells().size() - 1, {.tile = ShipGrid::Tile::goal});
+    map.SetCell(ivec2(0, 4), {});
+    Check();
+
+    // Direct changes are picked up on the next render.
+    map.ModifyCells().safe_nonthrowing_at(ivec2(5, 5)).tile = ShipGrid::Tile::block;
+    Check();
+    map.ModifyCells().resize(ivec2(12, 10));
+    map.SetCell(ivec2(11, 9), {.tile = ShipGrid::Tile::goal});
+    Check();
+}
+
+TEST_CASE("map.cells_binary")
+{
+    using Cell = Map<ShipGrid>::Cell;
+    static_assert(Refl::impl::BulkBinaryRepresentation<Cell>::value);
+
+    Array2D<Cell, int> cells(ivec2(5, 3));
+    for (ivec2 pos : vector_range(cells.size()))
+        cells.safe_nonthrowing_at(pos) = {.tile = ShipGrid::Tile((pos.x + pos.y) % std::to_underlying(ShipGrid::Tile::_count)), .noise = std::uint8_t(pos.x * 40 + pos.y)};
+
+    // The bulk copy must produce the same bytes as the per-element serialization.
+    std::vector<std::uint8_t> expected;
+    Stream::Output output = Stream::Output::Container(expected);
+    output.WriteLittle<std::int32_t>(5).WriteLittle<std::int32_t>(3).WriteLittle<std::uint32_t>(15);
+    for (ivec2 pos : vector_range(cells.size()))
+        output.WriteLittle<std::uint8_t>(std::to_underlying(cells.safe_nonthrowing_at(pos).tile)).WriteLittle<std::uint8_t>(cells.safe_nonthrowing_at(pos).noise);
+    output.Flush();
+
+    auto data = Refl::ToBinary<std::vector<std::uint8_t>>(cells);
+    REQUIRE(data == expected);
+
+    auto result = Refl::FromBinary<Array2D<Cell, int>>(Stream::ReadOnlyData::mem_reference(data));
+    REQUIRE(result.size() == cells.size());
+    for (ivec2 pos : vector_range(cells.size()))
+    {
+        REQUIRE(result.safe_nonthrowing_at(pos).tile == cells.safe_nonthrowing_at(pos).tile);
+        REQUIRE(result.safe_nonthrowing_at(pos).noise == cells.safe_nonthrowing_at(pos).noise);
+    }
+
+    // The enums are still validated.
+    data[12 + 2 * 7] = std::to_underlying(ShipGrid::Tile::_count);
+    REQUIRE_THROWS(Refl::FromBinary<Array2D<Cell, int>>(Stream::ReadOnlyData::mem_reference(data)));
+    std::vector<Cell> bad_cells(3);
+    bad_cells[1].tile = ShipGrid::Tile::_count;
+    REQUIRE_THROWS(Refl::ToBinary<std::vector<std::uint8_t>>(bad_cells));
+
+    // A bogus length doesn't allocate anything.
+    data = expected;
+    data[8] = data[9] = data[10] = data[11] = 0xff;
+    REQUIRE_THROWS(Refl::FromBinary<Array2D<Cell, int>>(Stream::ReadOnlyData::mem_reference(data)));
+}
+
+// Compares the bulk copy with the per-element interface calls that were used before.
+TEST_CASE("bench.map.cells_binary" * doctest::skip())
+{
+    using Cell = Map<ShipGrid>::Cell;
+
+    Array2D<Cell, int> cells(ivec2(1024));
+    std::vector<Cell> cell_vector;
+    std::uint32_t state = 1;
+    for (ivec2 pos : vector_range(cells.size()))
+    {
+        state = state * 1664525 + 1013904223;
+        cells.safe_nonthrowing_at(pos) = {.tile = ShipGrid::Tile(state >> 24 & 3), .noise = std::uint8_t(state >> 16)};
+        cell_vector.push_back(cells.safe_nonthrowing_at(pos));
+    }
+
+    for (bool bulk : {false, true})
+    {
+        // The best time of several runs.
+        double write_seconds = 1e9, read_seconds = 1e9;
+        std::size_t size = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            std::vector<std::uint8_t> data;
+            auto start = std::chrono::steady_clock::now();
+            Stream::Output output = Stream::Output::Container(data);
+            if (bulk)
+                Refl::ToBinary(cells, output);
+            else
+                Refl::Interface<std::vector<Cell>>().Refl::Interface_BasicContainer<std::vector<Cell>>::ToBinary(cell_vector, output, {}, Refl::initial_state);
+            output.Flush();
+            write_seconds = std::min(write_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            size = data.size();
+
+            start = std::chrono::steady_clock::now();
+            if (bulk)
+            {
+                REQUIRE(Refl::FromBinary<Array2D<Cell, int>>(Stream::ReadOnlyData::mem_reference(data)).size() == cells.size());
+            }
+            else
+            {
+                std::vector<Cell> result;
+                Stream::Input input = Stream::ReadOnlyData::mem_reference(data);
+                Refl::Interface<std::vector<Cell>>().Refl::Interface_BasicContainer<std::vector<Cell>>::FromBinary(result, input, {}, Refl::initial_state);
+                REQUIRE(result.size() == cell_vector.size());
+            }
+            read_seconds = std::min(read_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::cout << FMT("{:<11}: {} bytes, write {:.2f} ms ({:.0f} MB/s), read {:.2f} ms ({:.0f} MB/s)\n", bulk ? "bulk" : "per-element",
+            size, write_seconds * 1000, size / write_seconds / 1e6, read_seconds * 1000, size / read_seconds / 1e6);
+    }
+}
+
+// Compiling a level and loading it back must produce the same entities as loading the JSON.
+TEST_CASE("world.compiled_level_round_trip")
+{
+    std::string file_name = (std::filesystem::temp_directory_path() / "imp_test_level.bin").string();
+
+    int num_levels = 0;
+    for (int index = 0; Stream::AssetPack::FileExists(LevelIndexToFilename(index)); index++)
+    {
+        CAPTURE(index);
+        num_levels++;
+
+        ResetGameForLevel();
+        game.create<MapObject>(LevelIndexToFilename(index));
+        CompiledLevel from_json = CompiledLevel::FromGame();
+        from_json.sources = CompiledLevel::FindSources(LevelIndexToFilename(index));
+        REQUIRE(from_json.sources.size() > 0);
+        REQUIRE(from_json.IsUpToDate());
+        from_json.Save(file_name);
+
+        std::optional<CompiledLevel> loaded = CompiledLevel::Load(file_name);
+        REQUIRE(loaded);
+        REQUIRE(loaded->IsUpToDate());
+
+        ResetGameForLevel();
+        loaded->CreateEntities();
+        CompiledLevel from_compiled = CompiledLevel::FromGame();
+        from_compiled.sources = from_json.sources;
+
+        // Compare everything at once: the maps, blocks, pistons, tooltips, and the editor.
+        REQUIRE(Refl::ToBinary<std::vector<std::uint8_t>>(from_compiled) == Refl::ToBinary<std::vector<std::uint8_t>>(from_json));
+
+        // A changed source file makes the compiled level stale.
+        CompiledLevel stale = *loaded;
+        stale.sources.front().hash++;
+        REQUIRE_FALSE(stale.IsUpToDate());
+        stale = *loaded;
+        stale.sources.front().name += ".missing";
+        REQUIRE_FALSE(stale.IsUpToDate());
+    }
+    REQUIRE(num_levels > 0);
+
+    // Malformed files and other versions load as null, so the game falls back to the JSON.
+    std::vector<std::uint8_t> bytes;
+    {
+        Stream::ReadOnlyData data = Stream::ReadOnlyData::file(file_name);
+        bytes.assign(data.data(), data.data() + data.size());
+    }
+    auto LoadModified = [&](auto &&modify)
+    {
+        std::vector<std::uint8_t> copy = bytes;
+        modify(copy);
+        Stream::SaveFile(file_name, copy);
+        return CompiledLevel::Load(file_name);
+    };
+    REQUIRE(LoadModified([](std::vector<std::uint8_t> &){}));
+    REQUIRE_FALSE(LoadModified([](std::vector<std::uint8_t> &b){b[0]++;}));
+    REQUIRE_FALSE(LoadModified([](std::vector<std::uint8_t> &b){b[4]++;}));
+    REQUIRE_FALSE(LoadModified([](std::vector<std::uint8_t> &b){b.resize(b.size() / 2);}));
+
+    game = nullptr;
+    std::filesystem::remove(file_name);
+}
+
+namespace
+{
+    // Replaces the global renderer with a capturing one, and loads the images without making textures, so no GL calls are made.
+    // Restores the old renderer and the old images, and destroys the level entities on destruction.
+    class FrameCapture
+    {
+        Graphics::GlobalData::StateBackup old_images; // Must be the first field, to be restored after the renderer that uses the atlases.
+        Render old_renderer;
+        GameUtils::State::Manager<StateBase> state_manager;
+
+      public:
+        FrameCapture()
+        {
+            Graphics::GlobalData::Load(ImageLoadParams(false));
+            old_renderer = std::exchange(r, Render(0x2000, Render::capture));
+            r.SetMatrix(adaptive_viewport.GetDetails().MatrixCentered());
+            r.SetAtlas("");
+        }
+        FrameCapture(const FrameCapture &) = delete;
+        FrameCapture &operator=(const FrameCapture &) = delete;
+        ~FrameCapture()
+        {
+            game = nullptr;
+            r = std::move(old_renderer);
+        }
+
+        void LoadLevel(int index)
+        {
+            state_manager.SetState(FMT("World{{cur_level_index={}}}", index));
+        }
+
+        // Renders one frame of the current level, and returns the commands it produced.
+        const Render::CaptureLog &RenderFrame()
+        {
+            r.ClearCaptureLog();
+            state_manager.Call(&StateBase::Render);
+            return r.GetCaptureLog();
+        }
+    };
+}
+
+// The first frame of each level is the same on every load, so frame dumps can be diffed between builds to check that rendering changes don't affect the output.
+TEST_CASE("world.level_frames")
+{
+    FrameCapture capture;
+
+    int num_levels = 0;
+    for (int index = 0; Stream::AssetPack::FileExists(LevelIndexToFilename(index)); index++)
+    {
+        CAPTURE(index);
+        num_levels++;
+
+        capture.LoadLevel(index);
+        const Render::CaptureLog &log = capture.RenderFrame();
+        REQUIRE(log.NumTriangles() > 0);
+        std::string first = log.Dump();
+
+        REQUIRE(capture.RenderFrame().Dump() == first);
+
+        capture.LoadLevel(index);
+        REQUIRE(capture.RenderFrame().Dump() == first);
+    }
+    REQUIRE(num_levels > 0);
+}
+
+// Profiles the CPU side of `World::Render()`, without any GL calls.
+TEST_CASE("bench.world.render" * doctest::skip())
+{
+    FrameCapture capture;
+
+    for (int index = 0; Stream::AssetPack::FileExists(LevelIndexToFilename(index)); index++)
+    {
+        capture.LoadLevel(index);
+
+        // The best time of several runs.
+        double seconds = 1e9;
+        std::size_t num_triangles = 0;
+        for (int i = 0; i < 20; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            num_triangles = capture.RenderFrame().NumTriangles();
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::cout << FMT("Level {}: {} triangles, {:.3f} ms per frame\n", index, num_triangles, seconds * 1000);
+    }
+}
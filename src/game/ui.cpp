@@ -216,10 +216,11 @@ bool ShipEditorController::MouseFocusTick()
                 // Start level.
                 auto &new_blocks = game.create<ShipPartBlocks>();
                 new_blocks.pos = world_pos;
-                new_blocks.map.cells.resize(cells.size());
+                auto &new_cells = new_blocks.map.ModifyCells();
+                new_cells.resize(cells.size());
                 for (ivec2 pos : vector_range(cells.size()))
                 {
-                    auto &target_cell = new_blocks.map.cells.safe_nonthrowing_at(pos);
+                    auto &target_cell = new_cells.safe_nonthrowing_at(pos);
                     target_cell.tile = cells.safe_nonthrowing_at(pos);
                     target_cell.RegenerateNoise();
                 }
@@ -386,7 +387,7 @@ void ShipEditorController::GuiRender() const
         {
             float alpha = (1 - clamp((tutorial_tooltip_fade_out_timer - 60) / 90.f)) * t;
             if (alpha > 0.001f)
-                r.itext(ivec2(0, screen_size.y/2 - 16), Graphics::Text(Fonts::main, "Left click to place tile, right click to erase")).color(fvec3(1)).alpha(alpha);
+                r.itext(ivec2(0, screen_size.y/2 - 16), text_cache.Get(Fonts::main, "Left click to place tile, right click to erase")).color(fvec3(1)).alpha(alpha);
         }
     }
 
@@ -440,6 +441,6 @@ void Tooltip::GuiRender() const
     float alpha = min(clamp((timer - 120) / 90.f), 1 - clamp((timer2 - 60) / 90.f));
 
     for (int i = 0; i < 8; i++)
-        r.itext(text_pos + ivec2::dir8(i), Graphics::Text(Fonts::main, text)).align(align).color(fvec3(0)).alpha(smoothstep(clamp(alpha * 2 - 1)) * (i % 2 ? 0.2f : 0.5f));
-    r.itext(text_pos, Graphics::Text(Fonts::main, text)).align(align).color(fvec3(1)).alpha(smoothstep(clamp(alpha * 2)));
+        r.itext(text_pos + ivec2::dir8(i), text_cache.Get(Fonts::main, text)).align(align).color(fvec3(0)).alpha(smoothstep(clamp(alpha * 2 - 1)) * (i % 2 ? 0.2f : 0.5f));
+    r.itext(text_pos, text_cache.Get(Fonts::main, text)).align(align).color(fvec3(1)).alpha(smoothstep(clamp(alpha * 2)));
 }
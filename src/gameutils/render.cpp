@@ -55,9 +55,96 @@ void main()
 
     std::optional<std::string> current_atlas;
 
+    std::optional<CaptureLog> capture_log; // If set, we don't use GL, and record everything here instead.
+
     Data(std::size_t queue_size, const Graphics::ShaderConfig &config) : queue(queue_size), shader("Main", config, Graphics::ShaderPreferences{}, Meta::tag<Attribs>{}, uni, vertex_source, fragment_source) {}
+
+    Data(std::size_t queue_size, capture_t)
+        : queue(queue_size, [this](std::span<const Attribs> vertices)
+        {
+            CaptureLog::DrawTriangles command;
+            command.vertices.reserve(vertices.size());
+            for (const Attribs &vertex : vertices)
+                command.vertices.push_back(AttribsToVertex(vertex));
+            capture_log->commands.push_back(std::move(command));
+        }),
+        capture_log(std::in_place)
+    {}
+
+    // How many quads `AddVertices()` and `AddQuads()` can submit to the queue at once.
+    [[nodiscard]] std::size_t QuadsPerBatch() const
+    {
+        // Those functions would loop forever if no quads fit, so this is checked even in release builds.
+        ASSERT_ALWAYS(queue.Size() >= 2, "2D poly renderer: The queue is too small to fit a single quad.");
+        return std::max<std::size_t>(1, queue.Size() / 2);
+    }
+
+    // Convert between our vertex type and the public one. They must have the same fields.
+    [[nodiscard]] static Vertex AttribsToVertex(const Attribs &a)
+    {
+        Vertex ret;
+        ret.pos = a.pos;
+        ret.color = a.color;
+        ret.texcoord = a.texcoord;
+        ret.factors = a.factors;
+        return ret;
+    }
+    [[nodiscard]] static Attribs VertexToAttribs(const Vertex &v)
+    {
+        Attribs ret;
+        ret.pos = v.pos;
+        ret.color = v.color;
+        ret.texcoord = v.texcoord;
+        ret.factors = v.factors;
+        return ret;
+    }
 };
 
+namespace
+{
+    // Writes the vertices for `quads` to `out`, either 4 per quad (same as `Render::VertexList`), or 6 per quad (as two triangles for the queue).
+    // The results match `Render::Quad_t` exactly.
+    template <int VerticesPerQuad, typename V>
+    void WriteQuadVertices(std::span<const Render::QuadDesc> quads, fvec2 offset, V *out)
+    {
+        static_assert(VerticesPerQuad == 4 || VerticesPerQuad == 6);
+
+        // This is branchless, to let the compiler vectorize it.
+        for (const Render::QuadDesc &quad : quads)
+        {
+            fvec2 pos_a = quad.pos + offset;
+            fvec2 pos_b = quad.size + pos_a;
+            fvec2 tex_b = quad.tex_pos + quad.tex_size;
+            fvec3 factors(1, quad.alpha, 1);
+
+            auto Write = [&](V &v, bool x, bool y)
+            {
+                v.pos = fvec2(x ? pos_b.x : pos_a.x, y ? pos_b.y : pos_a.y);
+                v.color = fvec4(0);
+                v.texcoord = fvec2(x ? tex_b.x : quad.tex_pos.x, y ? tex_b.y : quad.tex_pos.y);
+                v.factors = factors;
+            };
+
+            // The same order as in `SimpleRenderQueue::Add()`.
+            Write(out[0], 0, 0);
+            Write(out[1], 1, 0);
+            if constexpr (VerticesPerQuad == 4)
+            {
+                Write(out[2], 1, 1);
+                Write(out[3], 0, 1);
+            }
+            else
+            {
+                Write(out[2], 0, 1);
+                Write(out[3], 0, 1);
+                Write(out[4], 1, 0);
+                Write(out[5], 1, 1);
+            }
+            out += VerticesPerQuad;
+        }
+    }
+}
+
 void *Render::GetRenderQueuePtr()
 {
     return &data->queue;
@@ -78,17 +165,26 @@ Render::Render(std::size_t queue_size, const Graphics::ShaderConfig &config)
     SetColorMatrix(fmat4());
 }
 
+Render::Render(std::size_t queue_size, capture_t)
+{
+    data = std::make_unique<Data>(queue_size, capture);
+    SetMatrix(fmat4());
+    SetColorMatrix(fmat4());
+}
+
 Render::Render(Render &&) noexcept = default;
 Render &Render::operator=(Render &&) noexcept = default;
 Render::~Render() = default;
 
 Render::operator bool() const
 {
-    return bool(data->shader);
+    return bool(data->shader) || IsCapturing();
 }
 
 void Render::BindShader() const
 {
+    if (IsCapturing())
+        return;
     data->shader.Bind();
 }
 
@@ -97,6 +193,25 @@ void Render::Finish()
     data->queue.Flush();
 }
 
+bool Render::IsCapturing() const
+{
+    return data && data->capture_log;
+}
+
+const Render::CaptureLog &Render::GetCaptureLog() const
+{
+    if (!IsCapturing())
+        throw std::runtime_error("2D poly renderer: This renderer doesn't capture commands.");
+    return *data->capture_log;
+}
+
+void Render::ClearCaptureLog()
+{
+    if (!IsCapturing())
+        throw std::runtime_error("2D poly renderer: This renderer doesn't capture commands.");
+    data->capture_log->commands.clear();
+}
+
 void Render::SetAtlas(std::string_view name)
 {
     auto it = Graphics::GlobalData::GetAtlases().find(name);
@@ -105,6 +220,14 @@ void Render::SetAtlas(std::string_view name)
 
     Finish(); // Since we're planning to clobber `data->tex_unit`.
 
+    if (IsCapturing())
+    {
+        data->capture_log->commands.push_back(CaptureLog::SetAtlas{.name = std::string(name)});
+        SetTextureSize(it->second.size);
+        data->current_atlas = std::move(name);
+        return;
+    }
+
     if (!data->tex_unit)
         data->tex_unit = nullptr;
     data->tex_unit.Attach(it->second.texture);
@@ -116,14 +239,20 @@ void Render::SetAtlas(std::string_view name)
 void Render::SetTextureUnit(const Graphics::TexUnit &unit)
 {
     Finish();
-    data->uni.texture = unit;
+    if (IsCapturing())
+        data->capture_log->commands.push_back(CaptureLog::SetTextureUnit{.index = unit.Index()});
+    else
+        data->uni.texture = unit;
     data->current_atlas.reset();
 }
 
 void Render::SetTextureSize(ivec2 size)
 {
     Finish();
-    data->uni.tex_size = size;
+    if (IsCapturing())
+        data->capture_log->commands.push_back(CaptureLog::SetTextureSize{.size = size});
+    else
+        data->uni.tex_size = size;
 }
 
 void Render::SetTexture(const Graphics::Texture &tex)
@@ -135,18 +264,132 @@ void Render::SetTexture(const Graphics::Texture &tex)
 void Render::SetMatrix(const fmat4 &m)
 {
     Finish();
-    data->uni.matrix = m;
+    if (IsCapturing())
+        data->capture_log->commands.push_back(CaptureLog::SetMatrix{.matrix = m});
+    else
+        data->uni.matrix = m;
 }
 
 void Render::SetColorMatrix(const fmat4 &m)
 {
     Finish();
-    data->uni.color_matrix = m;
+    if (IsCapturing())
+        data->capture_log->commands.push_back(CaptureLog::SetColorMatrix{.matrix = m});
+    else
+        data->uni.color_matrix = m;
+}
+
+std::size_t Render::CaptureLog::NumTriangles() const
+{
+    std::size_t ret = 0;
+    for (const Command &command : commands)
+    {
+        if (auto draw = std::get_if<DrawTriangles>(&command))
+            ret += draw->vertices.size() / 3;
+    }
+    return ret;
+}
+
+std::string Render::CaptureLog::Dump() const
+{
+    std::string ret;
+
+    auto AppendMatrix = [&](const char *name, const fmat4 &m)
+    {
+        ret += FMT("{}:", name);
+        for (int i = 0; i < 4; i++)
+            ret += FMT(" [{} {} {} {}]", m[i].x, m[i].y, m[i].z, m[i].w);
+        ret += '\n';
+    };
+
+    for (const Command &command : commands)
+    {
+        std::visit(Meta::overload{
+            [&](const DrawTriangles &draw)
+            {
+                ret += FMT("draw {} triangles\n", draw.vertices.size() / 3);
+                for (const Vertex &v : draw.vertices)
+                {
+                    ret += FMT("  pos={} {} color={} {} {} {} tex={} {} factors={} {} {}\n",
+                        v.pos.x, v.pos.y, v.color.x, v.color.y, v.color.z, v.color.w, v.texcoord.x, v.texcoord.y, v.factors.x, v.factors.y, v.factors.z
+                    );
+                }
+            },
+            [&](const SetAtlas &atlas)
+            {
+                ret += FMT("atlas `{}`\n", atlas.name);
+            },
+            [&](const SetTextureUnit &unit)
+            {
+                ret += FMT("texture unit {}\n", unit.index);
+            },
+            [&](const SetTextureSize &size)
+            {
+                ret += FMT("texture size {} {}\n", size.size.x, size.size.y);
+            },
+            [&](const SetMatrix &matrix)
+            {
+                AppendMatrix("matrix", matrix.matrix);
+            },
+            [&](const SetColorMatrix &matrix)
+            {
+                AppendMatrix("color matrix", matrix.matrix);
+            },
+        }, command);
+    }
+
+    return ret;
+}
+
+void Render::AddVertices(std::span<const Vertex> vertices, fvec2 offset)
+{
+    // The leftover vertices would make the loop below run forever, so this is checked even in release builds.
+    ASSERT_ALWAYS(vertices.size() % 4 == 0, "2D poly renderer: The number of vertices must be a multiple of 4.");
+
+    std::size_t quads_per_batch = data->QuadsPerBatch();
+
+    while (!vertices.empty())
+    {
+        std::size_t num_quads = std::min(vertices.size() / 4, quads_per_batch);
+        Data::Attribs *out = data->queue.AddUninitialized(num_quads * 2);
+
+        for (std::size_t i = 0; i < num_quads; i++)
+        {
+            // The same order as in `SimpleRenderQueue::Add()`.
+            for (int j : {0, 1, 3, 3, 1, 2})
+            {
+                *out = Data::VertexToAttribs(vertices[i * 4 + j]);
+                out->pos += offset;
+                out++;
+            }
+        }
+
+        vertices = vertices.subspan(num_quads * 4);
+    }
+}
+
+void Render::AddQuads(std::span<const QuadDesc> quads, fvec2 offset)
+{
+    std::size_t quads_per_batch = data->QuadsPerBatch();
+
+    while (!quads.empty())
+    {
+        std::size_t num_quads = std::min(quads.size(), quads_per_batch);
+        WriteQuadVertices<6>(quads.first(num_quads), offset, data->queue.AddUninitialized(num_quads * 2));
+        quads = quads.subspan(num_quads);
+    }
+}
+
+void Render::VertexList::AddQuads(std::span<const QuadDesc> quads, fvec2 offset)
+{
+    std::size_t old_size = vertices.size();
+    vertices.resize(old_size + quads.size() * 4);
+    WriteQuadVertices<4>(quads, offset, vertices.data() + old_size);
 }
 
 Render::Quad_t::~Quad_t()
 {
-    if (!queue)
+    if (!queue && !vertex_list)
         return;
 
     ASSERT(data.has_texture || data.has_color, "2D poly renderer: Quad with no texture nor color specified.");
@@ -227,6 +470,13 @@ Render::Quad_t::~Quad_t()
     out[1].texcoord = {out[2].texcoord.x, out[0].texcoord.y};
     out[3].texcoord = {out[0].texcoord.x, out[2].texcoord.y};
 
+    if (vertex_list)
+    {
+        for (const auto &it : out)
+            vertex_list->push_back(Render::Data::AttribsToVertex(it));
+        return;
+    }
+
     ((decltype(Render::Data::queue) *)queue)->Add(out[0], out[1], out[2], out[3]);
 }
 
@@ -281,11 +531,33 @@ Render::Text_t::~Text_t()
     if (!renderer)
         return;
 
-    Graphics::Text::Stats stats = data.text.ComputeStats();
+    auto DrawGlyph = [&](fvec2 offset, ivec2 size, ivec2 texture_pos)
+    {
+        fvec2 symbol_pos;
+
+        if (!data.has_matrix)
+            symbol_pos = data.pos + offset;
+        else
+            symbol_pos = data.pos + (data.matrix * offset.to_vec3(1)).to_vec2();
+
+        auto quad = renderer->fquad(symbol_pos, size).tex(texture_pos).color(data.color).mix(0).alpha(data.alpha).beta(data.beta);
+        if (data.has_matrix)
+            quad.matrix(data.matrix.to_mat2()).pixel_center(fvec2(0));
+    };
 
     ivec2 align_box(data.has_box_alignment ? data.align_box_x : data.align.x, data.align.y);
 
-    fvec2 pos = data.pos;
+    if (data.layout)
+    {
+        data.layout->ForEachGlyph(data.align, align_box, [&](ivec2 offset, const Graphics::TextLayout::Glyph &glyph)
+        {
+            DrawGlyph(fvec2(offset), glyph.size, glyph.texture_pos);
+        });
+        return;
+    }
+
+    // Uncached text is drawn directly, without building a `TextLayout`, to avoid the allocations.
+    Graphics::Text::Stats stats = data.text.ComputeStats();
 
     fvec2 offset = -stats.size * (1 + align_box) / 2;
     offset.x += stats.size.x * (1 + data.align.x) / 2; // Note that we don't change vertical position here.
@@ -302,17 +574,7 @@ Render::Text_t::~Text_t()
 
         for (const Graphics::Text::Symbol &symbol : line.symbols)
         {
-            fvec2 symbol_pos;
-
-            if (!data.has_matrix)
-                symbol_pos = pos + offset + symbol.offset;
-            else
-                symbol_pos = pos + (data.matrix * (offset + symbol.offset).to_vec3(1)).to_vec2();
-
-            auto quad = renderer->fquad(symbol_pos, symbol.size).tex(symbol.texture_pos).color(data.color).mix(0).alpha(data.alpha).beta(data.beta);
-            if (data.has_matrix)
-                quad.matrix(data.matrix.to_mat2()).pixel_center(fvec2(0));
-
+            DrawGlyph(offset + symbol.offset, symbol.size, symbol.texture_pos);
             offset.x += symbol.advance + symbol.kerning;
         }
 
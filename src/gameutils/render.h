@@ -1,7 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <span>
+#include <string>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #include "graphics/global_image_loader.h"
 #include "graphics/text.h"
@@ -26,8 +30,46 @@ class Render
     void ExpectAtlas(std::string_view name);
 
   public:
+    // A single vertex, in the same format that's sent to the GPU.
+    // You don't need this unless you want to cache geometry on the CPU, see `VertexList` below.
+    struct Vertex
+    {
+        fvec2 pos;
+        fvec4 color;
+        fvec2 texcoord;
+        fvec3 factors;
+
+        [[nodiscard]] friend bool operator==(const Vertex &, const Vertex &) = default;
+    };
+
+    // Everything a capturing renderer would've sent to GL. See the constructor below.
+    struct CaptureLog
+    {
+        struct DrawTriangles {std::vector<Vertex> vertices;}; // 3 vertices per triangle.
+        struct SetAtlas {std::string name;};
+        struct SetTextureUnit {int index = -1;};
+        struct SetTextureSize {ivec2 size;};
+        struct SetMatrix {fmat4 matrix;};
+        struct SetColorMatrix {fmat4 matrix;};
+
+        using Command = std::variant<DrawTriangles, SetAtlas, SetTextureUnit, SetTextureSize, SetMatrix, SetColorMatrix>;
+        std::vector<Command> commands;
+
+        // How many triangles were drawn in total.
+        [[nodiscard]] std::size_t NumTriangles() const;
+
+        // Returns a human-readable dump, one command or vertex per line, suitable for diffing.
+        // The floats are printed with the full precision.
+        [[nodiscard]] std::string Dump() const;
+    };
+
+    static constexpr struct capture_t {} capture{};
+
     Render();
     Render(std::size_t queue_size, const Graphics::ShaderConfig &config);
+    // Creates a renderer that doesn't use GL, and records everything to a `CaptureLog` instead.
+    // This is good for testing and profiling without a GPU.
+    Render(std::size_t queue_size, capture_t);
 
     Render(Render &&) noexcept;
     Render &operator=(Render &&) noexcept;
@@ -39,6 +81,12 @@ class Render
 
     void Finish();
 
+    // Whether this renderer was created with `capture`.
+    [[nodiscard]] bool IsCapturing() const;
+    // Throws if not capturing. Call `Finish()` first to flush the pending vertices.
+    [[nodiscard]] const CaptureLog &GetCaptureLog() const;
+    void ClearCaptureLog();
+
     // Enables a global texture atlas (see `graphics/global_image_loader.h`).
     // Calls `SetTexture??` internally.
     void SetAtlas(std::string_view name);
@@ -58,13 +106,27 @@ class Render
 
     void SetColorMatrix(const fmat4 &m);
 
+    // A plain textured quad, see `AddQuads()`.
+    struct QuadDesc
+    {
+        fvec2 pos;
+        fvec2 size;
+        fvec2 tex_pos;
+        fvec2 tex_size;
+        float alpha = 1;
+    };
+
+    class VertexList;
+
     class Quad_t
     {
         friend class Render;
+        friend class VertexList;
 
         using ref = Quad_t &&;
 
         void *queue = 0; // Actually the type should be `Graphics::SimpleRenderQueue<Attribs, 3> *`, but we don't include "graphics/simple_render_queue.h" for better compilation times.
+        std::vector<Vertex> *vertex_list = nullptr; // If set, the vertices are appended here instead of being sent to the `queue`.
 
         struct Data
         {
@@ -101,11 +163,17 @@ class Render
             data.pos = pos;
             data.size = size;
         }
+        Quad_t(std::vector<Vertex> *vertex_list, fvec2 pos, fvec2 size) : vertex_list(vertex_list)
+        {
+            data.pos = pos;
+            data.size = size;
+        }
       public:
-        Quad_t(Quad_t &&other) noexcept : queue(std::exchange(other.queue, {})), data(std::move(other.data)) {}
+        Quad_t(Quad_t &&other) noexcept : queue(std::exchange(other.queue, {})), vertex_list(std::exchange(other.vertex_list, {})), data(std::move(other.data)) {}
         Quad_t &operator=(Quad_t other) noexcept
         {
             std::swap(queue, other.queue);
+            std::swap(vertex_list, other.vertex_list);
             std::swap(data, other.data);
             return *this;
         }
@@ -440,6 +508,7 @@ class Render
             // The constructor sets those:
             fvec2 pos;
             Graphics::Text text;
+            const Graphics::TextLayout *layout = nullptr; // If set, `text` is ignored.
 
             ivec2 align = ivec2(0);
 
@@ -460,6 +529,11 @@ class Render
             data.pos = pos;
             data.text = std::move(text);
         }
+        Text_t(Render *renderer, fvec2 pos, const Graphics::TextLayout &layout) : renderer(renderer)
+        {
+            data.pos = pos;
+            data.layout = &layout;
+        }
       public:
         Text_t(Text_t &&other) noexcept : renderer(std::exchange(other.renderer, {})), data(std::move(other.data)) {}
         Text_t &operator=(Text_t other)
@@ -554,6 +628,39 @@ class Render
         ~Text_t();
     };
 
+    // Accumulates quads on the CPU instead of drawing them, doesn't need a GL context.
+    // Draw the result with `AddVertices()`. This is useful for caching geometry that rarely changes.
+    class VertexList
+    {
+        std::vector<Vertex> vertices;
+
+      public:
+        // Four vertices per quad, in the order expected by `AddVertices()`.
+        [[nodiscard]] const std::vector<Vertex> &Vertices() const {return vertices;}
+
+        void Clear() {vertices.clear();}
+
+        // Same as `Render::AddQuads()`, but appends to this list.
+        void AddQuads(std::span<const QuadDesc> quads, fvec2 offset = fvec2(0));
+
+        Quad_t fquad(fvec2 pos, fvec2 size)
+        {
+            return Quad_t(&vertices, pos, size);
+        }
+        Quad_t iquad(ivec2 pos, ivec2 size)
+        {
+            return Quad_t(&vertices, pos, size);
+        }
+    };
+
+    // Draws the quads generated by a `VertexList`, moved by `offset`.
+    void AddVertices(std::span<const Vertex> vertices, fvec2 offset = fvec2(0));
+
+    // Draws a lot of textured quads at once, moved by `offset`.
+    // Same as `fquad(q.pos + offset, q.size).tex(q.tex_pos, q.tex_size).alpha(q.alpha)` for each quad, but much faster,
+    // since this writes directly to the queue storage.
+    void AddQuads(std::span<const QuadDesc> quads, fvec2 offset = fvec2(0));
+
     Quad_t fquad(fvec2 pos, fvec2 size)
     {
         return Quad_t(GetRenderQueuePtr(), pos, size);
@@ -603,4 +710,17 @@ class Render
     {
         return Text_t(this, pos, std::move(text));
     }
+
+    // Draws a precomputed layout, e.g. from `Graphics::TextCache`. The layout must stay alive until the returned object is destroyed.
+    Text_t ftext(fvec2 pos, const Graphics::TextLayout &layout)
+    {
+        return Text_t(this, pos, layout);
+    }
+    Text_t ftext(fvec2 pos, Graphics::TextLayout &&layout) = delete;
+    Text_t itext(fvec2 pos, const Graphics::TextLayout &layout) = delete;
+    Text_t itext(ivec2 pos, const Graphics::TextLayout &layout)
+    {
+        return Text_t(this, pos, layout);
+    }
+    Text_t itext(ivec2 pos, Graphics::TextLayout &&layout) = delete;
 };
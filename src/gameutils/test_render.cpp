@@ -0,0 +1,150 @@
+#include "render.h"
+
+#include <chrono>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+namespace
+{
+    [[nodiscard]] std::vector<Render::QuadDesc> MakeTestQuads(int count)
+    {
+        std::vector<Render::QuadDesc> ret;
+        ret.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            ret.push_back({
+                .pos = fvec2(i % 97 * 3.5f, i / 97 * 12 - 40.25f),
+                .size = fvec2(12, i % 5 + 1),
+                .tex_pos = fvec2(i % 7 * 12, i % 3 * 12),
+                .tex_size = fvec2(12, i % 5 + 1),
+                .alpha = i % 4 / 3.f,
+            });
+        }
+        return ret;
+    }
+}
+
+TEST_CASE("render.batch_quads_match_builder")
+{
+    auto quads = MakeTestQuads(1000);
+    fvec2 offset(-17, 3.5f);
+
+    Render::VertexList expected;
+    for (const auto &quad : quads)
+        expected.fquad(quad.pos + offset, quad.size).tex(quad.tex_pos, quad.tex_size).alpha(quad.alpha);
+
+    Render::VertexList actual;
+    actual.AddQuads(quads, offset);
+
+    REQUIRE(actual.Vertices() == expected.Vertices());
+}
+
+TEST_CASE("render.capture")
+{
+    auto quads = MakeTestQuads(300);
+
+    // Draws the quads one by one or all at once, and returns the log.
+    auto Capture = [&](bool batch)
+    {
+        Render render(64, Render::capture); // Smaller than the quad count, to test multiple flushes.
+        REQUIRE(render.IsCapturing());
+        render.SetMatrix(fmat4::scale(fvec3(2, 3, 1)));
+        if (batch)
+        {
+            render.AddQuads(quads);
+        }
+        else
+        {
+            for (const auto &quad : quads)
+                render.fquad(quad.pos, quad.size).tex(quad.tex_pos, quad.tex_size).alpha(quad.alpha);
+        }
+        render.Finish();
+        return render.GetCaptureLog();
+    };
+
+    Render::CaptureLog log = Capture(false);
+    REQUIRE(log.NumTriangles() == quads.size() * 2);
+    REQUIRE(log.commands.size() == 3 + (quads.size() * 2 + 63) / 64); // Two matrices from the constructor, one set by us, then the draws.
+    REQUIRE(std::holds_alternative<Render::CaptureLog::SetMatrix>(log.commands[2]));
+    REQUIRE(std::get<Render::CaptureLog::SetMatrix>(log.commands[2]).matrix == fmat4::scale(fvec3(2, 3, 1)));
+
+    REQUIRE(Capture(true).Dump() == log.Dump());
+}
+
+// Uncached text is drawn without building a layout, which must produce the same quads.
+TEST_CASE("render.text_layout_matches_direct")
+{
+    Graphics::Font font;
+    font.SetAscent(9);
+    font.SetDescent(3);
+    font.SetLineSkip(13);
+    font.SetKerningFunc([](uint32_t a, uint32_t b){return a == 'A' && b == 'V' ? -2 : 0;});
+    for (uint32_t ch = ' '; ch < 127; ch++)
+    {
+        Graphics::Font::Glyph &glyph = font.Insert(ch);
+        glyph.texture_pos = ivec2(ch % 16 * 6, ch / 16 * 12);
+        glyph.size = ivec2(ch % 3 + 4, 8);
+        glyph.offset = ivec2(ch % 2, -7);
+        glyph.advance = 6;
+    }
+
+    Graphics::Text text(font, "AVb\nxy\n\nlonger line");
+    Graphics::TextLayout layout(text);
+
+    for (ivec2 align : ivec2(-1) <= vector_range <= ivec2(1))
+    for (int align_box = -1; align_box <= 1; align_box++)
+    for (bool use_matrix : {false, true})
+    {
+        CAPTURE(align);
+        CAPTURE(align_box);
+        CAPTURE(use_matrix);
+
+        auto Capture = [&](bool use_layout)
+        {
+            Render render(64, Render::capture);
+            {
+                auto t = use_layout ? render.ftext(fvec2(10.5f, -3), layout) : render.ftext(fvec2(10.5f, -3), text);
+                t.align(align, align_box).color(fvec3(1, 0.5f, 0)).alpha(0.5f);
+                if (use_matrix)
+                    t.rotate(0.3f).scale(2);
+            }
+            render.Finish();
+            return render.GetCaptureLog().Dump();
+        };
+        REQUIRE(Capture(true) == Capture(false));
+    }
+}
+
+TEST_CASE("bench.render.batch_quads" * doctest::skip())
+{
+    constexpr int num_quads = 10000, num_reps = 200;
+    auto quads = MakeTestQuads(num_quads);
+
+    Render::VertexList list;
+
+    auto Measure = [&](const char *name, auto &&func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_reps; i++)
+        {
+            list.Clear();
+            func();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << num_quads * double(num_reps) / seconds / 1e6 << " M quads/s\n";
+        REQUIRE(list.Vertices().size() == num_quads * 4);
+    };
+
+    Measure("builder", [&]
+    {
+        for (const auto &quad : quads)
+            list.fquad(quad.pos, quad.size).tex(quad.tex_pos, quad.tex_size).alpha(quad.alpha);
+    });
+    Measure("batch", [&]
+    {
+        list.AddQuads(quads);
+    });
+}
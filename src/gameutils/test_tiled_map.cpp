@@ -0,0 +1,143 @@
+#include "tiled_map.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "utils/archive.h"
+
+namespace
+{
+    [[nodiscard]] std::string EncodeBase64(const std::vector<std::uint8_t> &data)
+    {
+        const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string ret;
+        for (std::size_t i = 0; i < data.size(); i += 3)
+        {
+            std::uint32_t group = data[i] << 16 | (i + 1 < data.size() ? data[i + 1] << 8 : 0) | (i + 2 < data.size() ? data[i + 2] : 0);
+            for (std::size_t k = 0; k < 4; k++)
+                ret += i + k <= data.size() ? chars[group >> (18 - k * 6) & 63] : '=';
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> TilesToBytes(const std::vector<int> &tiles)
+    {
+        std::vector<std::uint8_t> ret;
+        for (int tile : tiles)
+        {
+            for (int i = 0; i < 4; i++)
+                ret.push_back(std::uint32_t(tile) >> (i * 8) & 0xff);
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> CompressZlib(const std::vector<std::uint8_t> &data)
+    {
+        std::vector<std::uint8_t> ret(Archive::Raw::MaxCompressedSize(data.data(), data.data() + data.size()));
+        ret.resize(Archive::Raw::Compress(data.data(), data.data() + data.size(), ret.data(), ret.data() + ret.size()) - ret.data());
+        return ret;
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> CompressZstd(const std::vector<std::uint8_t> &data)
+    {
+        std::vector<std::uint8_t> ret(Archive::MaxCompressedSize(Archive::Codec::zstd, data.size()));
+        ret.resize(Archive::Compress(Archive::Codec::zstd, data.data(), data.data() + data.size(), ret.data(), ret.data() + ret.size()) - ret.data());
+        return ret;
+    }
+
+    // Makes a single tile layer in the same format as the ones saved by Tiled.
+    [[nodiscard]] std::string MakeLayer(ivec2 size, std::string_view encoding, std::string_view compression, std::string_view data)
+    {
+        std::string quote = encoding == "csv" ? "" : "\"";
+        return FMT(R"({{ "compression":"{}", "data":{}{}{}, "encoding":"{}", "height":{}, "name":"mid", "type":"tilelayer", "width":{} }})", compression, quote, data, quote, encoding, size.y, size.x);
+    }
+
+    [[nodiscard]] Tiled::TileLayer LoadLayer(const std::string &json_string)
+    {
+        Json json(json_string.c_str(), 32);
+        return Tiled::LoadTileLayer(json.GetView());
+    }
+}
+
+TEST_CASE("tiled_map.tile_layer_encodings")
+{
+    // The last tile has the horizontal flip flag.
+    std::vector<int> tiles = {1, 2, 3, 0, 5, int(0x80000001)};
+    auto CheckLayer = [&](const Tiled::TileLayer &layer)
+    {
+        REQUIRE(layer.size() == ivec2(3, 2));
+        REQUIRE(std::vector<int>(layer.elements(), layer.elements() + layer.element_count()) == tiles);
+        REQUIRE(layer.safe_throwing_at(ivec2(1, 1)) == 5);
+    };
+
+    // The flip flags don't fit into `int` when stored as text, so we only check them in the binary formats.
+    REQUIRE(LoadLayer(R"({ "data":[1, 2, 3, 0, 5, 7], "height":2, "name":"mid", "type":"tilelayer", "width":3 })").elements()[5] == 7);
+    REQUIRE_THROWS(LoadLayer(R"({ "data":[1, 2, 3, 0, 5], "height":2, "name":"mid", "type":"tilelayer", "width":3 })"));
+
+    std::string plain = EncodeBase64(TilesToBytes(tiles));
+    REQUIRE(plain == "AQAAAAIAAAADAAAAAAAAAAUAAAABAACA");
+    CheckLayer(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "", plain)));
+    CheckLayer(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "zlib", EncodeBase64(CompressZlib(TilesToBytes(tiles))))));
+    REQUIRE(LoadLayer(MakeLayer(ivec2(1, 1), "base64", "", "BQAAAA==")).elements()[0] == 5); // With padding.
+    // Produced by Python's `gzip.compress()`.
+    CheckLayer(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "gzip", "H4sIAAAAAAACA2NkYGBgAmJmBghgBWJGBoYGAFiHBtwYAAAA")));
+
+    // Wrong tile count.
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(2, 2), "base64", "", plain)));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(4, 2), "base64", "zlib", EncodeBase64(CompressZlib(TilesToBytes(tiles))))));
+    // Malformed data.
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "", "AQAAAAIAAAADAAAAAAAAAAUAAAABAAC!")));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "", "AQAAAAIAAAADAAAAAAAAAAUAAAABA!=A")));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "gzip", plain)));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "zstd", plain)));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "lz4", plain)));
+    REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(3, 2), "xml", "", plain)));
+
+    // Zstd needs an optional library.
+    if (Archive::CodecAvailable(Archive::Codec::zstd))
+    {
+        CheckLayer(LoadLayer(MakeLayer(ivec2(3, 2), "base64", "zstd", EncodeBase64(CompressZstd(TilesToBytes(tiles))))));
+        REQUIRE_THROWS(LoadLayer(MakeLayer(ivec2(4, 2), "base64", "zstd", EncodeBase64(CompressZstd(TilesToBytes(tiles))))));
+    }
+}
+
+// Run this in a release build, otherwise the `ASSERT()`s in `MultiArray` dominate.
+TEST_CASE("bench.tiled_map.compressed_layer" * doctest::skip())
+{
+    ivec2 size(256, 256);
+    std::vector<int> tiles;
+    for (int i = 0; i < size.prod(); i++)
+        tiles.push_back(i * 7 % 23 < 15 ? 0 : i % 13);
+
+    std::string csv;
+    for (int tile : tiles)
+        csv += (csv.empty() ? "[" : ", ") + std::to_string(tile);
+    csv += "]";
+
+    std::vector<std::array<std::string, 3>> formats = {
+        {"csv", "", csv},
+        {"base64", "", EncodeBase64(TilesToBytes(tiles))},
+        {"base64", "zlib", EncodeBase64(CompressZlib(TilesToBytes(tiles)))},
+    };
+    if (Archive::CodecAvailable(Archive::Codec::zstd))
+        formats.push_back({"base64", "zstd", EncodeBase64(CompressZstd(TilesToBytes(tiles)))});
+
+    for (const auto &[encoding, compression, data] : formats)
+    {
+        std::string source = MakeLayer(size, encoding, compression, data);
+
+        int checksum = 0;
+        int num_reps = 100;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_reps; i++)
+            checksum += LoadLayer(source).elements()[i];
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << FMT("{}x{} layer, {} {}: {} bytes, {:.1f} us per load (checksum {})\n", size.x, size.y, encoding, compression, source.size(), seconds / num_reps * 1e6, checksum);
+    }
+}
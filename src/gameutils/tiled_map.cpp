@@ -1,10 +1,84 @@
 #include "tiled_map.h"
 
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
 #include "strings/format.h"
+#include "utils/archive.h"
+#include "utils/byte_order.h"
 #include "utils/mat.h"
 
 namespace Tiled
 {
+    // Returns the size of the decoded data. Throws if the size of `source` is invalid.
+    [[nodiscard]] static std::size_t Base64DecodedSize(std::string_view source)
+    {
+        if (source.size() % 4 != 0)
+            throw std::runtime_error("Invalid base64 string length.");
+        std::size_t ret = source.size() / 4 * 3;
+        if (source.ends_with("=="))
+            ret -= 2;
+        else if (source.ends_with("="))
+            ret -= 1;
+        return ret;
+    }
+
+    // `dst` must have the size returned by `Base64DecodedSize()`. Throws on invalid characters.
+    static void DecodeBase64(std::string_view source, std::uint8_t *dst)
+    {
+        static constexpr auto table = []{
+            std::array<std::uint8_t, 256> ret{};
+            ret.fill(0xff);
+            const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++)
+                ret[std::uint8_t(chars[i])] = i;
+            return ret;
+        }();
+
+        std::size_t dst_size = Base64DecodedSize(source);
+        if (source.empty())
+            return;
+
+        auto DecodeGroup = [&](const char *group_source, bool allow_padding) -> std::uint32_t
+        {
+            std::uint32_t ret = 0;
+            std::uint8_t invalid = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                std::uint8_t value = table[std::uint8_t(group_source[k])];
+                invalid |= value;
+                ret = ret << 6 | (value & 63);
+            }
+
+            if (invalid == 0xff)
+            {
+                // Padding is only allowed in the last two positions of the last group.
+                auto IsValid = [&](int k){return table[std::uint8_t(group_source[k])] != 0xff;};
+                if (!allow_padding || !IsValid(0) || !IsValid(1) || group_source[3] != '=' || (group_source[2] != '=' && !IsValid(2)))
+                    throw std::runtime_error("Invalid base64 string.");
+            }
+            return ret;
+        };
+
+        // All groups except the last one. This loop is the bottleneck for large layers, so it has no per-byte branches.
+        const char *cur = source.data();
+        const char *last = source.data() + source.size() - 4;
+        for (; cur < last; cur += 4)
+        {
+            std::uint32_t group = DecodeGroup(cur, false);
+            *dst++ = group >> 16 & 0xff;
+            *dst++ = group >> 8 & 0xff;
+            *dst++ = group & 0xff;
+        }
+
+        std::uint32_t group = DecodeGroup(cur, true);
+        std::size_t last_size = dst_size - (source.size() / 4 - 1) * 3;
+        for (std::size_t k = 0; k < last_size; k++)
+            *dst++ = group >> (16 - k * 8) & 0xff;
+    }
+
     Json::View FindLayer(Json::View map, std::string name)
     {
         Json::View ret = FindLayerOpt(map, name);
@@ -19,7 +93,7 @@ namespace Tiled
 
         map["layers"].ForEachArrayElement([&](Json::View elem)
         {
-            if (elem["name"].GetString() == name)
+            if (elem["name"].GetStringView() == name)
             {
                 if (!ret)
                     ret = elem;
@@ -36,21 +110,81 @@ namespace Tiled
         if (!source)
             throw std::runtime_error("Attempt to load a null tile layer.");
 
-        if (source["type"].GetString() != "tilelayer")
+        if (source["type"].GetStringView() != "tilelayer")
             throw std::runtime_error(FMT("Expected `{}` to be a tile layer.", source["name"].GetString()));
 
         ivec2 size(source["width"].GetInt(), source["height"].GetInt());
-
-        Json::View array_view = source["data"];
-        if (array_view.GetArraySize() != size.prod())
-            throw std::runtime_error(FMT("Expected the layer of size {} to have exactly {} tiles.", size, size.prod()));
+        if (size(any) < 0)
+            throw std::runtime_error(FMT("Invalid size {} of layer `{}`.", size, source["name"].GetStringView()));
 
         TileLayer ret(size);
-        int index = 0;
+        // The tiles are stored in the same order in the JSON and in the layer.
+        int *tiles = ret.elements();
 
-        for (int y = 0; y < ret.size().y; y++)
-        for (int x = 0; x < ret.size().x; x++)
-            ret.unsafe_at(ivec2(x,y)) = array_view[index++].GetInt();
+        std::string_view encoding = source.HasElement("encoding") ? source["encoding"].GetStringView() : "csv";
+
+        if (encoding == "csv")
+        {
+            Json::View array_view = source["data"];
+            if (array_view.GetArraySize() != size.prod())
+                throw std::runtime_error(FMT("Expected the layer of size {} to have exactly {} tiles.", size, size.prod()));
+
+            array_view.ForEachArrayElement([&](Json::View elem)
+            {
+                *tiles++ = elem.GetInt();
+            });
+        }
+        else if (encoding == "base64")
+        {
+            // The tiles are stored as little-endian 32-bit integers.
+            static_assert(sizeof(int) == 4);
+            std::uint8_t *dst_begin = reinterpret_cast<std::uint8_t *>(tiles);
+            std::uint8_t *dst_end = dst_begin + size.prod() * sizeof(int);
+
+            std::string_view data = source["data"].GetStringView();
+            std::string_view compression = source.HasElement("compression") ? source["compression"].GetStringView() : "";
+
+            try
+            {
+                if (compression == "")
+                {
+                    if (Base64DecodedSize(data) != std::size_t(dst_end - dst_begin))
+                        throw std::runtime_error(FMT("Expected the layer of size {} to have exactly {} tiles.", size, size.prod()));
+                    DecodeBase64(data, dst_begin);
+                }
+                else if (compression == "zlib" || compression == "gzip")
+                {
+                    std::vector<std::uint8_t> compressed(Base64DecodedSize(data));
+                    DecodeBase64(data, compressed.data());
+                    Archive::Raw::Uncompress(compressed.data(), compressed.data() + compressed.size(), dst_begin, dst_end,
+                        compression == "zlib" ? Archive::Raw::Format::zlib : Archive::Raw::Format::gzip);
+                }
+                else if (compression == "zstd")
+                {
+                    std::vector<std::uint8_t> compressed(Base64DecodedSize(data));
+                    DecodeBase64(data, compressed.data());
+                    Archive::Uncompress(Archive::Codec::zstd, compressed.data(), compressed.data() + compressed.size(), dst_begin, dst_end);
+                }
+                else
+                {
+                    throw std::runtime_error(FMT("Unsupported compression `{}`, use `zlib`, `gzip`, `zstd`, or none.", compression));
+                }
+            }
+            catch (std::exception &e)
+            {
+                throw std::runtime_error(FMT("Unable to decode layer `{}`: {}", source["name"].GetStringView(), e.what()));
+            }
+
+            if constexpr (ByteOrder::native != ByteOrder::little)
+            {
+                for (int i = 0; i < ret.element_count(); i++)
+                    ByteOrder::Convert(ret.elements()[i], ByteOrder::little);
+            }
+        }
+        else
+        {
+            throw std::runtime_error(FMT("Unsupported encoding `{}` of layer `{}`.", encoding, source["name"].GetStringView()));
+        }
 
         return ret;
     }
@@ -60,7 +194,7 @@ namespace Tiled
         if (!source)
             throw std::runtime_error("Attempt to load a null point layer.");
 
-        if (source["type"].GetString() != "objectgroup")
+        if (source["type"].GetStringView() != "objectgroup")
             throw std::runtime_error(FMT("Expected `{}` to be an object layer.", source["name"].GetString()));
 
         PointLayer ret;
@@ -81,7 +215,7 @@ namespace Tiled
         Properties ret;
         map["properties"].ForEachArrayElement([&](Json::View elem)
         {
-            std::string type = elem["type"].GetString();
+            std::string_view type = elem["type"].GetStringView();
             if (type == "string")
                 ret.strings.insert({elem["name"].GetString(), elem["value"].GetString()});
         });
@@ -3,7 +3,9 @@
 #include "graphics/blending.h"
 #include "graphics/clear.h"
 #include "graphics/dummy_vertex_array.h"
+#include "graphics/dynamic_glyph_cache.h"
 #include "graphics/errors.h"
+#include "graphics/font_atlas_cache.h"
 #include "graphics/font_file.h"
 #include "graphics/font.h"
 #include "graphics/framebuffer.h"
@@ -13,6 +15,7 @@
 #include "graphics/scissor.h"
 #include "graphics/shader.h"
 #include "graphics/simple_render_queue.h"
+#include "graphics/text_cache.h"
 #include "graphics/text.h"
 #include "graphics/texture_atlas.h"
 #include "graphics/texture.h"
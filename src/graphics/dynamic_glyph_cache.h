@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graphics/font_file.h"
+#include "graphics/font.h"
+#include "graphics/image.h"
+#include "utils/mat.h"
+#include "utils/packing.h"
+
+namespace Graphics
+{
+    // Makes a `Font` rasterize glyphs on demand, instead of baking the whole character set in advance with `MakeFontAtlas()`.
+    // The glyphs are packed into a region of a CPU-side image. When it's full, the least recently used glyphs are evicted.
+    // You're responsible for uploading the changed part of the image to the GPU, see `TakeDirtyRect()`.
+    // Glyphs used since the last `NextFrame()` are never evicted, so call it once per frame after drawing everything.
+    // Evicting a glyph calls `Font::InvalidateGlyphs()`, so `TextCache` lays out the strings again. Other layouts of dynamic fonts shouldn't be kept for more than one frame.
+    class DynamicGlyphCache
+    {
+      public:
+        // Rasterizes a glyph, or returns null if there's no such glyph.
+        using rasterize_func_t = std::function<std::optional<FontFile::GlyphData>(uint32_t ch)>;
+
+        struct Counters
+        {
+            std::size_t hits = 0;
+            std::size_t misses = 0; // Each miss rasterizes a glyph.
+            std::size_t evictions = 0;
+            std::size_t failures = 0; // How many times a glyph didn't fit even after evicting everything we could (at most once per glyph per frame). The default glyph is used then.
+        };
+
+      private:
+        struct Entry
+        {
+            Font::Glyph glyph;
+            std::uint64_t last_used_frame = 0;
+            bool is_missing = false; // The font doesn't have this glyph, so the default one is used.
+            bool is_failed = false; // The glyph didn't fit in `last_used_frame`, so the default one is used until the next frame.
+        };
+
+        Font *target = nullptr;
+        Image *image = nullptr;
+        irect2 rect;
+        rasterize_func_t rasterize;
+
+        Packing::ShelfPacker packer;
+        std::unordered_map<uint32_t, Entry> entries;
+        std::uint64_t frame = 1;
+
+        std::optional<irect2> dirty_rect;
+        Counters counters;
+
+        void MarkDirty(irect2 changed_rect)
+        {
+            if (!changed_rect.has_area())
+                return;
+            dirty_rect = dirty_rect ? dirty_rect->combine(changed_rect) : changed_rect;
+        }
+
+        // Tries to find space for a glyph, evicting the old ones if needed.
+        [[nodiscard]] std::optional<ivec2> AllocateSpace(ivec2 size)
+        {
+            if (auto pos = packer.Allocate(size))
+                return pos;
+
+            // Evict the least recently used glyphs, one at a time, until we have enough space.
+            std::vector<std::pair<std::uint64_t, uint32_t>> candidates;
+            for (const auto &[ch, entry] : entries)
+            {
+                if (entry.last_used_frame < frame && !entry.is_missing && !entry.is_failed)
+                    candidates.emplace_back(entry.last_used_frame, ch);
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (const auto &candidate : candidates)
+            {
+                Evict(candidate.second);
+                if (auto pos = packer.Allocate(size))
+                    return pos;
+            }
+
+            return {};
+        }
+
+        void Evict(uint32_t ch)
+        {
+            auto it = entries.find(ch);
+            ASSERT(it != entries.end());
+            const Font::Glyph &glyph = it->second.glyph;
+
+            packer.Free(glyph.texture_pos - rect.a, glyph.size);
+            image->UnsafeFill(glyph.texture_pos.rect_size(glyph.size), u8vec4(0));
+            MarkDirty(glyph.texture_pos.rect_size(glyph.size));
+
+            entries.erase(it);
+            counters.evictions++;
+            target->InvalidateGlyphs();
+        }
+
+        [[nodiscard]] std::optional<Font::Glyph> GetGlyph(uint32_t ch)
+        {
+            if (auto it = entries.find(ch); it != entries.end())
+            {
+                if (!it->second.is_failed)
+                {
+                    counters.hits++;
+                    it->second.last_used_frame = frame;
+                    if (it->second.is_missing)
+                        return {};
+                    return it->second.glyph;
+                }
+
+                // Don't rasterize it again in the same frame, since nothing can be evicted until the next one.
+                if (it->second.last_used_frame == frame)
+                    return {};
+
+                entries.erase(it);
+            }
+
+            counters.misses++;
+
+            std::optional<FontFile::GlyphData> data = rasterize(ch);
+            if (!data)
+            {
+                // Remember that there's no such glyph, to avoid asking again.
+                entries.try_emplace(ch, Entry{.glyph = {}, .last_used_frame = frame, .is_missing = true});
+                return {};
+            }
+
+            ivec2 size = data->image.Size();
+            std::optional<ivec2> pos = AllocateSpace(size);
+            if (!pos)
+            {
+                counters.failures++;
+                entries.try_emplace(ch, Entry{.glyph = {}, .last_used_frame = frame, .is_failed = true});
+                return {};
+            }
+
+            Entry &entry = entries.try_emplace(ch).first->second;
+            entry.last_used_frame = frame;
+            entry.glyph.texture_pos = rect.a + *pos;
+            entry.glyph.size = size;
+            entry.glyph.offset = data->offset;
+            entry.glyph.advance = data->advance;
+
+            if (size != ivec2(0))
+            {
+                image->UnsafeDrawImage(data->image, entry.glyph.texture_pos);
+                MarkDirty(entry.glyph.texture_pos.rect_size(size));
+            }
+
+            return entry.glyph;
+        }
+
+      public:
+        // `target` is modified to request glyphs from this cache. The default glyph is rasterized immediately, and is never evicted.
+        // `rect` is the part of `image` reserved for the glyphs.
+        DynamicGlyphCache(Font &target, Image &image, irect2 rect, rasterize_func_t rasterize, bool add_gaps = true)
+            : target(&target), image(&image), rect(rect), rasterize(std::move(rasterize)), packer(rect.size(), add_gaps ? 1 : 0)
+        {
+            if (!image.Bounds().contains(rect))
+                throw std::runtime_error("Invalid target rectangle for a dynamic glyph cache.");
+
+            image.UnsafeFill(rect, u8vec4(0));
+            MarkDirty(rect);
+
+            if (std::optional<FontFile::GlyphData> data = this->rasterize(Unicode::default_char))
+            {
+                std::optional<ivec2> pos = packer.Allocate(data->image.Size());
+                if (!pos)
+                    throw std::runtime_error("The default glyph doesn't fit into the dynamic glyph cache.");
+
+                Font::Glyph &glyph = target.DefaultGlyph();
+                glyph.texture_pos = rect.a + *pos;
+                glyph.size = data->image.Size();
+                glyph.offset = data->offset;
+                glyph.advance = data->advance;
+                image.UnsafeDrawImage(data->image, glyph.texture_pos);
+            }
+
+            target.SetGlyphFunc([this](uint32_t ch){return GetGlyph(ch);});
+        }
+
+        // Rasterizes the glyphs from `source` (which must outlive the cache) using `flags`. Also copies the font metrics and kerning to `target`.
+        // The kerning is usually baked for all characters of the font (see below), which takes about a millisecond for a typical Latin font.
+        DynamicGlyphCache(Font &target, const FontFile &source, FontFile::RenderFlags flags, Image &image, irect2 rect, bool add_gaps = true)
+            : DynamicGlyphCache(target, image, rect, [&source, flags](uint32_t ch) -> std::optional<FontFile::GlyphData>
+            {
+                if (!source.HasGlyph(ch))
+                    return {};
+                return source.GetGlyph(ch, flags);
+            }, add_gaps)
+        {
+            target.SetAscent(source.Ascent());
+            target.SetDescent(source.Descent());
+            target.SetLineSkip(source.LineSkip());
+
+            // We don't know in advance which characters will be used, so the kerning is baked for all of them, if that's cheap.
+            // It is if the font lists its kerning pairs, or if it's small enough to check every pair.
+            // Otherwise (large fonts without a `kern` table, e.g. Type 1 with an AFM file) it'd take millions of FreeType calls, so we query it per pair.
+            Unicode::CharSet all_chars = source.AllChars();
+            std::size_t num_chars = 0;
+            for (const Unicode::CharRange &range : all_chars.Ranges())
+                num_chars += range.end - range.begin + 1;
+            if (source.HasKernTable() || num_chars <= KerningTable::max_dense_chars)
+            {
+                target.SetKerningFunc(nullptr);
+                target.SetKerningTable(source.MakeKerningTable(all_chars));
+            }
+            else
+            {
+                target.SetKerningTable({});
+                target.SetKerningFunc(source.KerningFunc());
+            }
+        }
+
+        // The font refers to this object.
+        DynamicGlyphCache(const DynamicGlyphCache &) = delete;
+        DynamicGlyphCache &operator=(const DynamicGlyphCache &) = delete;
+
+        ~DynamicGlyphCache()
+        {
+            target->SetGlyphFunc(nullptr);
+        }
+
+        // Call this once per frame, after drawing everything. Glyphs used before this call become evictable.
+        void NextFrame()
+        {
+            frame++;
+        }
+
+        // Returns the part of the image changed since the last call, if any, and resets it.
+        [[nodiscard]] std::optional<irect2> TakeDirtyRect()
+        {
+            return std::exchange(dirty_rect, {});
+        }
+
+        [[nodiscard]] std::size_t NumGlyphs() const
+        {
+            return entries.size();
+        }
+
+        [[nodiscard]] const Counters &GetCounters() const
+        {
+            return counters;
+        }
+        void ResetCounters()
+        {
+            counters = {};
+        }
+    };
+}
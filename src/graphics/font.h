@@ -1,13 +1,163 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "utils/mat.h"
 
 namespace Graphics
 {
+    // Precomputed kerning for all pairs of characters from a fixed set.
+    // Small sets are stored as a dense matrix, large ones as a sorted list of the pairs with non-zero kerning.
+    // Pairs involving characters outside of the set have no kerning.
+    class KerningTable
+    {
+      public:
+        // Sets with at most this many characters use the dense matrix.
+        static constexpr std::size_t max_dense_chars = 256;
+
+        struct Pair
+        {
+            std::uint64_t key = 0; // See `PairKey()`.
+            int value = 0;
+        };
+
+        // The underlying data, exposed for serialization.
+        struct Storage
+        {
+            std::vector<std::uint32_t> chars; // Sorted. Only used in the dense mode.
+            std::vector<std::int16_t> matrix; // `chars.size()` squared, the first character selects the row.
+            std::vector<Pair> pairs; // Sorted by key. Only used in the sparse mode.
+        };
+
+        [[nodiscard]] static std::uint64_t PairKey(std::uint32_t a, std::uint32_t b)
+        {
+            return std::uint64_t(a) << 32 | b;
+        }
+
+      private:
+        Storage storage;
+
+        // Returns the index of `ch` in `chars`, or -1 if none.
+        [[nodiscard]] std::ptrdiff_t CharIndex(std::uint32_t ch) const
+        {
+            auto it = std::lower_bound(storage.chars.begin(), storage.chars.end(), ch);
+            if (it == storage.chars.end() || *it != ch)
+                return -1;
+            return it - storage.chars.begin();
+        }
+
+      public:
+        KerningTable() {}
+
+        // Throws if the storage is malformed.
+        explicit KerningTable(Storage new_storage) : storage(std::move(new_storage))
+        {
+            if (storage.matrix.size() != storage.chars.size() * storage.chars.size())
+                throw std::runtime_error("Kerning table: The matrix size doesn't match the number of characters.");
+            if (!storage.chars.empty() && !storage.pairs.empty())
+                throw std::runtime_error("Kerning table: Can't have both the matrix and the pairs.");
+            if (!std::is_sorted(storage.chars.begin(), storage.chars.end()) || !std::is_sorted(storage.pairs.begin(), storage.pairs.end(), [](const Pair &a, const Pair &b){return a.key < b.key;}))
+                throw std::runtime_error("Kerning table: The data is not sorted.");
+        }
+
+        // `new_chars` must be sorted and have no duplicates.
+        // `func` is `int func(std::size_t a_index, std::size_t b_index)`, it's called for every pair of characters (with indices into `new_chars`).
+        // The complexity is quadratic, so for large sets prefer `FromPairs()` if you can list the kerned pairs directly.
+        template <typename F>
+        KerningTable(std::span<const std::uint32_t> new_chars, F &&func)
+        {
+            if (new_chars.size() <= max_dense_chars)
+            {
+                storage.chars.assign(new_chars.begin(), new_chars.end());
+                storage.matrix.resize(storage.chars.size() * storage.chars.size());
+
+                bool any_kerning = false;
+                for (std::size_t a = 0; a < storage.chars.size(); a++)
+                for (std::size_t b = 0; b < storage.chars.size(); b++)
+                {
+                    int value = func(a, b);
+                    storage.matrix[a * storage.chars.size() + b] = std::int16_t(value);
+                    if (value != 0)
+                        any_kerning = true;
+                }
+
+                // Don't waste time on lookups if there's no kerning.
+                if (!any_kerning)
+                {
+                    storage.chars = {};
+                    storage.matrix = {};
+                }
+            }
+            else
+            {
+                for (std::size_t a = 0; a < new_chars.size(); a++)
+                for (std::size_t b = 0; b < new_chars.size(); b++)
+                {
+                    if (int value = func(a, b))
+                        storage.pairs.push_back({.key = PairKey(new_chars[a], new_chars[b]), .value = value});
+                }
+                // The pairs are already sorted, since the characters are.
+            }
+        }
+
+        // Makes a sparse table from pairs in any order. Pairs with zero kerning are dropped.
+        // Duplicate pairs are allowed, the first one of them is used.
+        [[nodiscard]] static KerningTable FromPairs(std::vector<Pair> pairs)
+        {
+            std::erase_if(pairs, [](const Pair &pair){return pair.value == 0;});
+            std::stable_sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b){return a.key < b.key;});
+            pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b){return a.key == b.key;}), pairs.end());
+
+            KerningTable ret;
+            ret.storage.pairs = std::move(pairs);
+            return ret;
+        }
+
+        [[nodiscard]] bool IsEmpty() const
+        {
+            return storage.chars.empty() && storage.pairs.empty();
+        }
+        [[nodiscard]] bool IsDense() const
+        {
+            return !storage.chars.empty();
+        }
+
+        [[nodiscard]] const Storage &GetStorage() const
+        {
+            return storage;
+        }
+
+        [[nodiscard]] int Get(std::uint32_t a, std::uint32_t b) const
+        {
+            if (IsDense())
+            {
+                std::ptrdiff_t a_index = CharIndex(a);
+                if (a_index < 0)
+                    return 0;
+                std::ptrdiff_t b_index = CharIndex(b);
+                if (b_index < 0)
+                    return 0;
+                return storage.matrix[a_index * storage.chars.size() + b_index];
+            }
+            else
+            {
+                std::uint64_t key = PairKey(a, b);
+                auto it = std::lower_bound(storage.pairs.begin(), storage.pairs.end(), key, [](const Pair &pair, std::uint64_t key){return pair.key < key;});
+                if (it == storage.pairs.end() || it->key != key)
+                    return 0;
+                return it->value;
+            }
+        }
+    };
+
     class Font
     {
       public:
@@ -26,11 +176,19 @@ namespace Graphics
 
         using kerning_func_t = std::function<int(uint32_t, uint32_t)>;
         kerning_func_t kerning_func = 0;
+        KerningTable kerning_table; // If not empty, this is used instead of `kerning_func`.
 
         // Some code might rely on references not being invalidated on insertion. Keep that in mind if you decide to change the container.
         std::unordered_map<uint32_t, Glyph> glyphs;
         Glyph default_glyph;
 
+        // If set, `Get()` and `GetOpt()` use this instead of `glyphs`. See `DynamicGlyphCache`.
+        using glyph_func_t = std::function<std::optional<Glyph>(uint32_t)>;
+        glyph_func_t glyph_func;
+
+        // Incremented when the glyphs returned earlier become outdated. See `GlyphVersion()`.
+        std::uint64_t glyph_version = 0;
+
       public:
         void SetAscent(int new_ascent)
         {
@@ -48,6 +206,31 @@ namespace Graphics
         {
             kerning_func = std::move(new_kerning_func);
         }
+        void SetKerningTable(KerningTable new_kerning_table) // Overrides the kerning func, unless empty.
+        {
+            kerning_table = std::move(new_kerning_table);
+        }
+        void SetGlyphFunc(glyph_func_t new_glyph_func) // The function should return null for unknown glyphs. Pass a null function to use the inserted glyphs again.
+        {
+            glyph_func = std::move(new_glyph_func);
+            InvalidateGlyphs();
+        }
+
+        // Call this when the glyphs returned earlier become outdated, e.g. when a `DynamicGlyphCache` evicts one.
+        // `TextCache` uses this to lay out the affected strings again.
+        void InvalidateGlyphs()
+        {
+            glyph_version++;
+        }
+        [[nodiscard]] std::uint64_t GlyphVersion() const
+        {
+            return glyph_version;
+        }
+        // Whether the glyphs come from `SetGlyphFunc()`. Then they can be evicted if they're not requested every frame.
+        [[nodiscard]] bool HasGlyphFunc() const
+        {
+            return bool(glyph_func);
+        }
 
         int Ascent() const
         {
@@ -74,13 +257,19 @@ namespace Graphics
         {
             return kerning_func;
         }
+        const KerningTable &GetKerningTable() const
+        {
+            return kerning_table;
+        }
         bool HasKerning() const
         {
-            return bool(kerning_func);
+            return !kerning_table.IsEmpty() || bool(kerning_func);
         }
         int Kerning(uint32_t a, uint32_t b) const
         {
-            if (kerning_func)
+            if (!kerning_table.IsEmpty())
+                return kerning_table.Get(a, b);
+            else if (kerning_func)
                 return kerning_func(a, b);
             else
                 return 0;
@@ -95,14 +284,28 @@ namespace Graphics
             return default_glyph;
         }
 
-        // Note that returned references remain valid even after insertions.
-        const Glyph &Get(uint32_t ch) const
+        // Returns a copy, because with `SetGlyphFunc()` the glyph can be evicted by any later call.
+        Glyph Get(uint32_t ch) const
         {
+            if (glyph_func)
+                return glyph_func(ch).value_or(default_glyph);
+
             if (auto it = glyphs.find(ch); it != glyphs.end())
                 return it->second;
             else
                 return default_glyph;
         }
+        // Returns null if there's no such glyph.
+        std::optional<Glyph> GetOpt(uint32_t ch) const
+        {
+            if (glyph_func)
+                return glyph_func(ch);
+
+            if (auto it = glyphs.find(ch); it != glyphs.end())
+                return it->second;
+            else
+                return {};
+        }
         // If the glyph already exists, returns a reference to it instead of creating a new one.
         Glyph &Insert(uint32_t ch)
         {
@@ -114,6 +317,7 @@ namespace Graphics
         {
             for (auto &[code, glyph] : glyphs)
                 glyph.texture_pos += offset;
+            InvalidateGlyphs();
         }
     };
 }
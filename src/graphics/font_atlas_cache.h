@@ -0,0 +1,273 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "graphics/font_file.h"
+#include "graphics/font.h"
+#include "graphics/image.h"
+#include "stream/input.h"
+#include "stream/output.h"
+#include "stream/save_to_file.h"
+#include "utils/hash.h"
+#include "utils/mat.h"
+
+// A persistent cache for `MakeFontAtlas()`.
+// The cache file stores the atlas pixels, the font metrics, the glyphs and the kerning tables, so a warm start doesn't touch FreeType at all.
+
+namespace Graphics
+{
+    namespace impl::FontAtlasCache
+    {
+        // Bump this when changing the file format or `MakeFontAtlas()`.
+        inline constexpr std::uint32_t version = 1;
+        inline constexpr std::string_view magic = "FONTATLS";
+
+        struct FontData
+        {
+            int ascent = 0;
+            int descent = 0;
+            int line_skip = 0;
+            std::optional<Font::Glyph> default_glyph;
+            std::vector<std::pair<std::uint32_t, Font::Glyph>> glyphs;
+            KerningTable kerning;
+        };
+
+        inline void WriteGlyph(Stream::Output &output, const Font::Glyph &glyph, ivec2 offset)
+        {
+            output.WriteLittle<std::int32_t>(glyph.texture_pos.x - offset.x);
+            output.WriteLittle<std::int32_t>(glyph.texture_pos.y - offset.y);
+            output.WriteLittle<std::int32_t>(glyph.size.x);
+            output.WriteLittle<std::int32_t>(glyph.size.y);
+            output.WriteLittle<std::int32_t>(glyph.offset.x);
+            output.WriteLittle<std::int32_t>(glyph.offset.y);
+            output.WriteLittle<std::int32_t>(glyph.advance);
+        }
+
+        [[nodiscard]] inline Font::Glyph ReadGlyph(Stream::Input &input, ivec2 offset)
+        {
+            Font::Glyph ret;
+            ret.texture_pos.x = input.ReadLittle<std::int32_t>() + offset.x;
+            ret.texture_pos.y = input.ReadLittle<std::int32_t>() + offset.y;
+            ret.size.x = input.ReadLittle<std::int32_t>();
+            ret.size.y = input.ReadLittle<std::int32_t>();
+            ret.offset.x = input.ReadLittle<std::int32_t>();
+            ret.offset.y = input.ReadLittle<std::int32_t>();
+            ret.advance = input.ReadLittle<std::int32_t>();
+            return ret;
+        }
+
+        inline void WriteKerningTable(Stream::Output &output, const KerningTable &table)
+        {
+            const KerningTable::Storage &storage = table.GetStorage();
+            output.WriteLittle<std::uint32_t>(storage.chars.size());
+            output.WriteLittle<std::uint32_t>(storage.chars.data(), storage.chars.size());
+            output.WriteLittle<std::int16_t>(storage.matrix.data(), storage.matrix.size());
+            output.WriteLittle<std::uint32_t>(storage.pairs.size());
+            for (const KerningTable::Pair &pair : storage.pairs)
+            {
+                output.WriteLittle<std::uint64_t>(pair.key);
+                output.WriteLittle<std::int32_t>(pair.value);
+            }
+        }
+
+        [[nodiscard]] inline KerningTable ReadKerningTable(Stream::Input &input)
+        {
+            KerningTable::Storage storage;
+            storage.chars.resize(input.ReadLittle<std::uint32_t>());
+            input.ReadLittle<std::uint32_t>(storage.chars.data(), storage.chars.size());
+            storage.matrix.resize(storage.chars.size() * storage.chars.size());
+            input.ReadLittle<std::int16_t>(storage.matrix.data(), storage.matrix.size());
+            storage.pairs.resize(input.ReadLittle<std::uint32_t>());
+            for (KerningTable::Pair &pair : storage.pairs)
+            {
+                pair.key = input.ReadLittle<std::uint64_t>();
+                pair.value = input.ReadLittle<std::int32_t>();
+            }
+            return KerningTable(std::move(storage));
+        }
+    }
+
+    // Computes a key describing the inputs of `MakeFontAtlas()`, for the cache files.
+    // Uses the font file contents, sizes, render flags and character sets.
+    [[nodiscard]] inline std::uint64_t FontAtlasCacheKey(ivec2 rect_size, const std::vector<FontAtlasEntry> &entries, bool add_gaps)
+    {
+        std::size_t ret = Hash::Combine({impl::FontAtlasCache::version, std::size_t(rect_size.x), std::size_t(rect_size.y), add_gaps, entries.size()});
+
+        for (const FontAtlasEntry &entry : entries)
+        {
+            if (entry.source)
+            {
+                const Stream::ReadOnlyData &file = entry.source->File();
+                Hash::Append(ret, {
+                    std::hash<std::string_view>{}(std::string_view(file.data_char(), file.size())),
+                    std::size_t(entry.source->RequestedSize().x),
+                    std::size_t(entry.source->RequestedSize().y),
+                    std::size_t(entry.source->Index()),
+                });
+            }
+            Hash::Append(ret, {std::size_t(entry.render_flags), std::size_t(entry.flags)});
+
+            Hash::Append(ret, entry.glyphs->Ranges().size());
+            for (const Unicode::CharRange &range : entry.glyphs->Ranges())
+                Hash::Append(ret, {range.begin, range.end});
+        }
+
+        return ret;
+    }
+
+    // Writes the atlas region `rect` of `image` and the fonts from `entries` to `output`, after `MakeFontAtlas()` has filled them.
+    inline void SaveFontAtlasCache(Stream::Output &output, std::uint64_t key, const Image &image, irect2 rect, const std::vector<FontAtlasEntry> &entries)
+    {
+        namespace C = impl::FontAtlasCache;
+
+        output.WriteString(C::magic.data(), C::magic.size());
+        output.WriteLittle<std::uint32_t>(C::version);
+        output.WriteLittle<std::uint64_t>(key);
+
+        output.WriteLittle<std::int32_t>(rect.size().x);
+        output.WriteLittle<std::int32_t>(rect.size().y);
+        for (int y = rect.a.y; y < rect.b.y; y++)
+            output.WriteBytes(reinterpret_cast<const std::uint8_t *>(&image.UnsafeAt(ivec2(rect.a.x, y))), std::size_t(rect.size().x) * sizeof(u8vec4));
+
+        output.WriteLittle<std::uint32_t>(entries.size());
+        for (const FontAtlasEntry &entry : entries)
+        {
+            output.WriteLittle<std::int32_t>(entry.target->Ascent());
+            output.WriteLittle<std::int32_t>(entry.target->Descent());
+            output.WriteLittle<std::int32_t>(entry.target->LineSkip());
+
+            // Same condition as in `MakeFontAtlas()`.
+            bool has_default_glyph = !bool(entry.flags & entry.no_default_glyph) && !entry.glyphs->Contains(Unicode::default_char);
+            output.WriteByte(has_default_glyph);
+            if (has_default_glyph)
+                C::WriteGlyph(output, entry.target->DefaultGlyph(), rect.a);
+
+            std::vector<std::pair<std::uint32_t, Font::Glyph>> glyphs;
+            for (std::uint32_t ch : *entry.glyphs)
+            {
+                if (ch == Unicode::default_char)
+                    glyphs.emplace_back(ch, entry.target->DefaultGlyph());
+                else if (std::optional<Font::Glyph> glyph = entry.target->GetOpt(ch))
+                    glyphs.emplace_back(ch, *glyph);
+            }
+
+            output.WriteLittle<std::uint32_t>(glyphs.size());
+            for (const auto &[ch, glyph] : glyphs)
+            {
+                output.WriteLittle<std::uint32_t>(ch);
+                C::WriteGlyph(output, glyph, rect.a);
+            }
+
+            C::WriteKerningTable(output, entry.target->GetKerningTable());
+        }
+    }
+
+    // Loads a cache written by `SaveFontAtlasCache()`, filling the `rect` of `image` and the fonts from `entries`.
+    // Returns false without changing anything if the cache has a different key or version.
+    // Throws if the file is malformed, also without changing anything.
+    [[nodiscard]] inline bool LoadFontAtlasCache(Stream::Input &input, std::uint64_t key, Image &image, irect2 rect, const std::vector<FontAtlasEntry> &entries)
+    {
+        namespace C = impl::FontAtlasCache;
+
+        if (!image.Bounds().contains(rect))
+            throw std::runtime_error("Invalid target rectangle for a font atlas.");
+
+        std::string file_magic(C::magic.size(), '\0');
+        input.Read(file_magic.data(), file_magic.size());
+        if (file_magic != C::magic)
+            throw std::runtime_error(input.GetExceptionPrefix() + "This is not a font atlas cache.");
+        if (input.ReadLittle<std::uint32_t>() != C::version || input.ReadLittle<std::uint64_t>() != key)
+            return false;
+
+        ivec2 size;
+        size.x = input.ReadLittle<std::int32_t>();
+        size.y = input.ReadLittle<std::int32_t>();
+        if (size != rect.size())
+            return false;
+
+        Image pixels(size);
+        for (int y = 0; y < size.y; y++)
+            input.Read(reinterpret_cast<std::uint8_t *>(&pixels.UnsafeAt(ivec2(0, y))), std::size_t(size.x) * sizeof(u8vec4));
+
+        if (input.ReadLittle<std::uint32_t>() != entries.size())
+            throw std::runtime_error(input.GetExceptionPrefix() + "Wrong number of fonts in the font atlas cache.");
+
+        std::vector<C::FontData> fonts(entries.size());
+        for (C::FontData &font : fonts)
+        {
+            font.ascent = input.ReadLittle<std::int32_t>();
+            font.descent = input.ReadLittle<std::int32_t>();
+            font.line_skip = input.ReadLittle<std::int32_t>();
+
+            if (input.ReadByte())
+                font.default_glyph = C::ReadGlyph(input, rect.a);
+
+            font.glyphs.resize(input.ReadLittle<std::uint32_t>());
+            for (auto &[ch, glyph] : font.glyphs)
+            {
+                ch = input.ReadLittle<std::uint32_t>();
+                glyph = C::ReadGlyph(input, rect.a);
+            }
+
+            font.kerning = C::ReadKerningTable(input);
+        }
+
+        input.ExpectEnd();
+
+        // Everything was loaded successfully, apply the changes.
+        image.UnsafeDrawImage(pixels, rect.a);
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            Font &target = *entries[i].target;
+            C::FontData &font = fonts[i];
+
+            target.SetAscent(font.ascent);
+            target.SetDescent(font.descent);
+            target.SetLineSkip(font.line_skip);
+            target.SetKerningFunc(nullptr);
+            target.SetKerningTable(std::move(font.kerning));
+
+            if (font.default_glyph)
+                target.DefaultGlyph() = *font.default_glyph;
+            for (const auto &[ch, glyph] : font.glyphs)
+                (ch != Unicode::default_char ? target.Insert(ch) : target.DefaultGlyph()) = glyph;
+        }
+
+        return true;
+    }
+
+    // Same as `MakeFontAtlas()`, but reuses the results from `cache_file_name` if they are still valid, or updates that file otherwise.
+    // A missing or broken cache file is silently regenerated.
+    inline void MakeFontAtlasCached(Image &image, irect2 rect, const std::vector<FontAtlasEntry> &entries, const std::string &cache_file_name, bool add_gaps = true)
+    {
+        std::uint64_t key = FontAtlasCacheKey(rect.size(), entries, add_gaps);
+
+        try
+        {
+            Stream::Input input(cache_file_name);
+            if (LoadFontAtlasCache(input, key, image, rect, entries))
+                return;
+        }
+        catch (std::exception &) {}
+
+        MakeFontAtlas(image, rect, entries, add_gaps);
+
+        try
+        {
+            std::vector<std::uint8_t> buffer;
+            Stream::Output output = Stream::Output::Container(buffer);
+            SaveFontAtlasCache(output, key, image, rect, entries);
+            output.Flush();
+            Stream::SaveFile(cache_file_name, buffer);
+        }
+        catch (std::exception &) {} // The cache is optional, don't fail if we can't write it.
+    }
+}
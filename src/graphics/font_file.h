@@ -1,12 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <exception>
+#include <optional>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H // Ugh.
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
 
 #include "graphics/font.h"
 #include "graphics/image.h"
@@ -34,6 +40,8 @@ namespace Graphics
         {
             FT_Face ft_font = 0;
             Stream::ReadOnlyData file;
+            ivec2 size;
+            int index = 0;
         };
 
         Data data;
@@ -58,6 +66,8 @@ namespace Graphics
             }
 
             data.file = std::move(file); // Memory files are ref-counted, but moving won't hurt.
+            data.size = size;
+            data.index = index;
 
             FT_Open_Args args{};
             args.flags = FT_OPEN_MEMORY;
@@ -136,6 +146,21 @@ namespace Graphics
             return bool(data.ft_font);
         }
 
+        // The file the font was loaded from.
+        const Stream::ReadOnlyData &File() const
+        {
+            return data.file;
+        }
+        // The size and the index that were passed to the constructor.
+        ivec2 RequestedSize() const
+        {
+            return data.size;
+        }
+        int Index() const
+        {
+            return data.index;
+        }
+
         int Ascent() const
         {
             return data.ft_font->size->metrics.ascender >> 6; // Ascent is stored as 26.6 fixed point and it's supposed to be already rounded, so we truncate it.
@@ -185,6 +210,134 @@ namespace Graphics
             };
         }
 
+        // Returns true if the font has a `kern` table. Then `MakeKerningTable()` is cheap even for large character sets.
+        bool HasKernTable() const
+        {
+            FT_ULong length = 0;
+            return FT_IS_SFNT(data.ft_font) && FT_Load_Sfnt_Table(data.ft_font, TTAG_kern, 0, nullptr, &length) == 0;
+        }
+
+        // Returns the pairs of glyph indices listed in the `kern` table of a TrueType/OpenType font.
+        // `FT_Get_Kerning()` returns zero for any other pair in such fonts, since it doesn't use the GPOS table.
+        // Returns null if the font has no `kern` table, then any pair can be kerned.
+        std::optional<std::vector<std::pair<FT_UInt, FT_UInt>>> KernTablePairs() const
+        {
+            FT_ULong length = 0;
+            if (!FT_IS_SFNT(data.ft_font) || FT_Load_Sfnt_Table(data.ft_font, TTAG_kern, 0, nullptr, &length) != 0)
+                return {};
+            std::vector<FT_Byte> table(length);
+            if (FT_Load_Sfnt_Table(data.ft_font, TTAG_kern, 0, table.data(), &length) != 0)
+                return {};
+
+            // Returns 0 when reading past the end.
+            auto Read16 = [&](std::size_t offset) -> std::uint16_t
+            {
+                if (offset + 2 > table.size())
+                    return 0;
+                return std::uint16_t(table[offset] << 8 | table[offset + 1]);
+            };
+
+            // This follows `tt_face_load_kern()` in FreeType: at most 32 subtables, only horizontal ones in format 0.
+            // The Apple version of the table has 1 in the upper half of the version, so it ends up with no subtables, same as in FreeType.
+            std::vector<std::pair<FT_UInt, FT_UInt>> ret;
+            std::size_t num_subtables = std::min(Read16(2), std::uint16_t(32));
+            std::size_t pos = 4;
+            for (std::size_t i = 0; i < num_subtables && pos + 6 <= table.size(); i++)
+            {
+                std::size_t subtable_length = Read16(pos + 2);
+                std::uint16_t coverage = Read16(pos + 4);
+                if (subtable_length <= 6 + 8)
+                    break;
+                std::size_t next_pos = std::min(pos + subtable_length, table.size());
+
+                if (coverage >> 8 == 0 && (coverage & 3) == 1 && pos + 14 <= next_pos)
+                {
+                    std::size_t num_pairs = std::min(std::size_t(Read16(pos + 6)), (next_pos - pos - 14) / 6);
+                    for (std::size_t j = 0; j < num_pairs; j++)
+                    {
+                        std::size_t pair_pos = pos + 14 + j * 6;
+                        ret.emplace_back(Read16(pair_pos), Read16(pair_pos + 2));
+                    }
+                }
+
+                pos = next_pos;
+            }
+
+            return ret;
+        }
+
+        // Precomputes kerning for all pairs of characters from `glyphs` that exist in the font, so it doesn't have to be queried from FreeType at runtime.
+        // Returns an empty table if the font doesn't support kerning.
+        KerningTable MakeKerningTable(const Unicode::CharSet &glyphs) const
+        {
+            if (!HasKerning())
+                return {};
+
+            std::vector<uint32_t> chars;
+            std::vector<FT_UInt> glyph_indices;
+            for (uint32_t ch : glyphs)
+            {
+                if (FT_UInt index = FT_Get_Char_Index(data.ft_font, ch))
+                {
+                    chars.push_back(ch);
+                    glyph_indices.push_back(index);
+                }
+            }
+
+            auto GlyphKerning = [&](FT_UInt a, FT_UInt b) -> int
+            {
+                FT_Vector vec;
+                if (FT_Get_Kerning(data.ft_font, a, b, FT_KERNING_DEFAULT, &vec))
+                    return 0;
+                return (vec.x + (1 << 5)) >> 6; // See `Kerning()` for why we bit-shift.
+            };
+
+            // For large sets, only query the pairs listed in the font instead of all of them. E.g. CJK sets can have tens of thousands of characters.
+            // Small sets need every pair for the dense matrix anyway.
+            if (chars.size() > KerningTable::max_dense_chars)
+            {
+                if (auto kern_pairs = KernTablePairs())
+                {
+                    // Several characters can share a glyph.
+                    std::unordered_multimap<FT_UInt, uint32_t> glyph_chars;
+                    for (std::size_t i = 0; i < chars.size(); i++)
+                        glyph_chars.emplace(glyph_indices[i], chars[i]);
+
+                    std::vector<KerningTable::Pair> pairs;
+                    for (auto [a, b] : *kern_pairs)
+                    {
+                        auto [a_begin, a_end] = glyph_chars.equal_range(a);
+                        auto [b_begin, b_end] = glyph_chars.equal_range(b);
+                        if (a_begin == a_end || b_begin == b_end)
+                            continue;
+
+                        int value = GlyphKerning(a, b);
+                        if (value == 0)
+                            continue;
+
+                        for (auto a_it = a_begin; a_it != a_end; a_it++)
+                        for (auto b_it = b_begin; b_it != b_end; b_it++)
+                            pairs.push_back({.key = KerningTable::PairKey(a_it->second, b_it->second), .value = value});
+                    }
+
+                    return KerningTable::FromPairs(std::move(pairs));
+                }
+            }
+
+            // Fonts without a `kern` table (e.g. Type 1 with an AFM file) can't list their pairs, so we have to check all of them.
+            return KerningTable(chars, [&](std::size_t a, std::size_t b){return GlyphKerning(glyph_indices[a], glyph_indices[b]);});
+        }
+
+        // Returns all characters that have glyphs in the font.
+        Unicode::CharSet AllChars() const
+        {
+            Unicode::CharSet ret;
+            FT_UInt index = 0;
+            for (FT_ULong ch = FT_Get_First_Char(data.ft_font, &index); index != 0; ch = FT_Get_Next_Char(data.ft_font, ch, &index))
+                ret.Add(uint32_t(ch));
+            return ret;
+        }
+
         // This always returns `true` for 0xFFFD `Unicode::default_char`, since freetype itself seems to able to draw it if it's not included in the font.
         bool HasGlyph(uint32_t ch) const
         {
@@ -269,16 +422,14 @@ namespace Graphics
                 ivec2 size = ivec2(bitmap.width, bitmap.rows);
                 ret.offset = ivec2(glyph->bitmap_left, -glyph->bitmap_top);
                 ret.advance = (glyph->advance.x + (1 << 5)) >> 6; // Advance is measured in 26.6 fixed point pixels, so we round it.
-                ret.image = Image(size);
 
                 if (is_antialiased)
                 {
-                    for (int y = 0; y < size.y; y++)
-                    for (int x = 0; x < size.x; x++)
-                        ret.image.UnsafeAt(ivec2(x,y)) = u8vec3(255).to_vec4(bitmap.buffer[bitmap.pitch * y + x]);
+                    ret.image = Image::FromAlpha(size, bitmap.buffer, bitmap.pitch);
                 }
                 else
                 {
+                    ret.image = Image(size);
                     for (int y = 0; y < size.y; y++)
                     {
                         uint8_t *byte_ptr = bitmap.buffer + bitmap.pitch * y;
@@ -344,7 +495,8 @@ namespace Graphics
             entry.target->SetAscent(entry.source->Ascent());
             entry.target->SetDescent(entry.source->Descent());
             entry.target->SetLineSkip(bool(entry.flags & entry.no_line_gap) ? entry.source->Height() : entry.source->LineSkip());
-            entry.target->SetKerningFunc(entry.source->KerningFunc());
+            entry.target->SetKerningFunc(nullptr);
+            entry.target->SetKerningTable(entry.source->MakeKerningTable(*entry.glyphs));
 
             auto AddGlyph = [&](uint32_t ch)
             {
@@ -1,18 +1,33 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string_view>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include "graphics/image.h"
+#include "graphics/texture_atlas_cache.h"
 #include "graphics/texture_atlas.h"
 #include "graphics/texture.h"
 #include "macros/enum_flag_operators.h"
+#include "meta/common.h"
 #include "meta/const_string.h"
+#include "stream/asset_pack.h"
+#include "stream/input.h"
+#include "stream/output.h"
 #include "stream/readonly_data.h"
+#include "stream/save_to_file.h"
+#include "utils/hash.h"
 #include "utils/mat.h"
+#include "utils/packing.h"
+#include "utils/parallel.h"
 
 namespace Graphics
 {
@@ -40,6 +55,7 @@ namespace Graphics::GlobalData
         TexObject texture;
         ivec2 size; // Since `image` can be null, and the texture doesn't remember its size, we also store it here.
         Image image; // Normally null, unless `Flags::keep_images` is used.
+        Packing::RectPacker packer; // Null if the atlas was loaded from the cache. `Reload()` uses this to place the images that changed size.
     };
 
     using AtlasMap = std::map<std::string, Atlas, std::less<>>;
@@ -77,6 +93,15 @@ namespace Graphics::GlobalData
             return ret;
         }
 
+        // An image that goes into an atlas.
+        struct AtlasInput
+        {
+            State::RegionPair *region = nullptr;
+            std::variant<Stream::ReadOnlyData, ivec2> data; // Either the file contents, or the size of a generated image.
+            std::optional<std::uint64_t> stamp; // If set, used in the cache key instead of the file contents, which are then loaded only on a cache miss.
+            std::unique_ptr<Generator> generator; // Null if the image is loaded from a file.
+        };
+
         template <Meta::ConstString Name, typename Generate>
         struct RegisterImage
         {
@@ -132,97 +157,317 @@ namespace Graphics::GlobalData
         std::function<void(Graphics::Image &image)> modify_image;
     };
 
+    namespace impl
+    {
+        // Computes a key for the atlas cache, from the atlas parameters and the image names, sizes and stamps (or contents, if there's no stamp).
+        [[nodiscard]] inline std::uint64_t AtlasCacheKey(const AtlasParams &atlas_params, const std::vector<AtlasInput> &inputs)
+        {
+            std::size_t ret = Hash::Combine({std::size_t(atlas_params.size.x), std::size_t(atlas_params.size.y), std::size_t(atlas_params.atlas_flags), inputs.size()});
+
+            for (const AtlasInput &input : inputs)
+            {
+                Hash::Append(ret, {std::hash<std::string_view>{}(input.region->first), input.data.index()});
+                if (input.stamp)
+                {
+                    Hash::Append(ret, std::size_t(*input.stamp));
+                    continue;
+                }
+                std::visit(Meta::overload{
+                    [&](const Stream::ReadOnlyData &data)
+                    {
+                        Hash::Append(ret, {data.size(), std::hash<std::string_view>{}(std::string_view(data.data_char(), data.size()))});
+                    },
+                    [&](ivec2 size)
+                    {
+                        Hash::Append(ret, {std::size_t(size.x), std::size_t(size.y)});
+                    },
+                }, input.data);
+            }
+
+            return ret;
+        }
+    }
+
     struct LoadParams
     {
         std::function<Stream::ReadOnlyData(const std::string &name)> get_data; // Mandatory, returns the memory to load the image from.
         std::function<std::string(const std::string &name)> name_to_atlas; // Optional, maps images to atlases. Assumed to return an empty string by default, putting all images into a single atlas.
         std::function<AtlasParams(const std::string &atlas)> atlas_params; // Optional, returns per-atlas parameters. Returns default-constructed parameters by default.
+        // Optional, returns a file name to cache the packed atlas in. If it returns an empty string or is null, the atlas isn't cached.
+        // The cache is reused if the image names and contents (or stamps, see below) don't change. The generated images are still regenerated every time.
+        std::function<std::string(const std::string &atlas)> cache_file_name;
+        // Optional, returns a number that changes when the image changes, e.g. from the file size and modification time. Only used with `cache_file_name`.
+        // If set, the cache key is computed from those instead of the image contents, and `get_data` is called only if the cache is outdated.
+        std::function<std::uint64_t(const std::string &name)> get_stamp;
 
         LoadParams() {}
 
         // Constructs the minimal viable parameters.
-        LoadParams(std::string prefix) : get_data(LoadFileFromPrefix(std::move(prefix))) {}
+        LoadParams(std::string prefix) : get_data(LoadFileFromPrefix(prefix)), get_stamp(StampFileFromPrefix(prefix)) {}
 
         // A default value for `get_data`, that loads files from a specific prefix.
         static decltype(get_data) LoadFileFromPrefix(std::string prefix, std::string suffix = ".png")
         {
             return [prefix = std::move(prefix), suffix = std::move(suffix)](const std::string &name) -> Stream::ReadOnlyData
             {
-                return Stream::ReadOnlyData(FMT("{}{}{}", prefix, name, suffix));
+                return Stream::ReadOnlyData::file_mapped(FMT("{}{}{}", prefix, name, suffix));
+            };
+        }
+
+        // A default value for `get_stamp`, matching `LoadFileFromPrefix()`. See `Stream::AssetPack::FileStamp()`. Missing files get a zero stamp.
+        static decltype(get_stamp) StampFileFromPrefix(std::string prefix, std::string suffix = ".png")
+        {
+            return [prefix = std::move(prefix), suffix = std::move(suffix)](const std::string &name) -> std::uint64_t
+            {
+                return Stream::AssetPack::FileStamp(FMT("{}{}{}", prefix, name, suffix)).value_or(0);
             };
         }
     };
 
-    // Loads all images mentioned in `Image()` calls into atlases.
-    inline void Load(const LoadParams &params)
+    namespace impl
     {
-        // In case the list of atlases changes.
-        impl::GetState().atlases.clear();
+        // Loads all images from `state.regions` into `state.atlases`. See `GlobalData::Load()`.
+        inline void Load(State &state, const LoadParams &params)
+        {
+            // In case the list of atlases changes.
+            state.atlases.clear();
 
-        // Group the regions by atlases.
-        std::map<std::string, std::vector<impl::State::RegionPair *>, std::less<>> regions_per_atlas;
-        for (auto &elem : impl::GetState().regions)
-            regions_per_atlas[params.name_to_atlas ? params.name_to_atlas(elem.first) : std::string{}].push_back(&elem);
+            // Group the regions by atlases.
+            std::map<std::string, std::vector<impl::State::RegionPair *>, std::less<>> regions_per_atlas;
+            for (auto &elem : state.regions)
+                regions_per_atlas[params.name_to_atlas ? params.name_to_atlas(elem.first) : std::string{}].push_back(&elem);
 
-        TexUnit tex_unit = nullptr; // We need this to upload images to textures.
+            TexUnit tex_unit = nullptr; // We need this to upload images to textures.
 
-        // For each atlas...
-        for (auto &[atlas_name, regions] : regions_per_atlas)
-        {
-            Atlas &atlas = impl::GetState().atlases.try_emplace(atlas_name).first->second;
+            // For each atlas...
+            for (auto &[atlas_name, regions] : regions_per_atlas)
+            {
+                Atlas &atlas = state.atlases.try_emplace(atlas_name).first->second;
 
-            AtlasParams atlas_params;
-            if (params.atlas_params)
-                atlas_params = params.atlas_params(atlas_name);
+                AtlasParams atlas_params;
+                if (params.atlas_params)
+                    atlas_params = params.atlas_params(atlas_name);
 
-            struct GeneratedImage
-            {
-                std::unique_ptr<Generator> generator;
-                impl::State::RegionPair *region = nullptr;
-            };
-            std::vector<GeneratedImage> generated_images;
+                std::string cache_file_name = params.cache_file_name ? params.cache_file_name(atlas_name) : std::string{};
+                // With stamps, the images are read only if the cache is outdated.
+                bool use_stamps = !cache_file_name.empty() && params.get_stamp;
 
-            // Generate the atlas.
-            atlas.image = MakeAtlas(atlas_params.size, [&, &regions = regions](AtlasInputFunc func)
-            {
+                // Collect the images. We need them (or their stamps) in advance to check the cache.
+                std::vector<impl::AtlasInput> inputs;
+                inputs.reserve(regions.size());
                 for (impl::State::RegionPair *pair : regions)
                 {
+                    impl::AtlasInput &input = inputs.emplace_back();
+                    input.region = pair;
                     if (pair->second.make_generator)
                     {
-                        if (generated_images.empty())
-                            generated_images.reserve(regions.size());
-                        generated_images.push_back({.generator = pair->second.make_generator(), .region = pair});
-                        func(generated_images.back().generator->Size(), pair->second.region);
+                        input.generator = pair->second.make_generator();
+                        input.data = input.generator->Size();
+                    }
+                    else if (use_stamps)
+                    {
+                        input.stamp = params.get_stamp(pair->first);
                     }
                     else
                     {
-                        func(params.get_data(pair->first), pair->second.region);
+                        input.data = params.get_data(pair->first);
+                    }
+                }
+
+                std::uint64_t cache_key = cache_file_name.empty() ? 0 : impl::AtlasCacheKey(atlas_params, inputs);
+
+                // Try loading the atlas from the cache.
+                bool loaded_from_cache = false;
+                if (!cache_file_name.empty())
+                {
+                    try
+                    {
+                        Stream::Input input(cache_file_name);
+                        if (std::optional<CachedAtlas> cached = LoadAtlasCache(input, cache_key, inputs.size()))
+                        {
+                            atlas.image = std::move(cached->image);
+                            for (std::size_t i = 0; i < inputs.size(); i++)
+                                inputs[i].region->second.region = cached->regions[i];
+                            loaded_from_cache = true;
+                        }
+                    }
+                    catch (std::exception &) {} // A missing or broken cache is silently regenerated.
+                }
+
+                if (!loaded_from_cache)
+                {
+                    if (use_stamps)
+                    {
+                        for (impl::AtlasInput &input : inputs)
+                        {
+                            if (!input.generator)
+                                input.data = params.get_data(input.region->first);
+                        }
+                    }
+
+                    // Generate the atlas.
+                    atlas.image = MakeAtlas(atlas_params.size, [&](AtlasInputFunc func)
+                    {
+                        for (impl::AtlasInput &input : inputs)
+                            func(input.data, input.region->second.region);
+                    }, atlas_params.atlas_flags, &atlas.packer);
+
+                    if (!cache_file_name.empty())
+                    {
+                        try
+                        {
+                            std::vector<irect2> cached_regions;
+                            cached_regions.reserve(inputs.size());
+                            for (const impl::AtlasInput &input : inputs)
+                                cached_regions.push_back(input.region->second.region);
+
+                            std::vector<std::uint8_t> buffer;
+                            Stream::Output output = Stream::Output::Container(buffer);
+                            SaveAtlasCache(output, cache_key, atlas.image, cached_regions);
+                            output.Flush();
+                            Stream::SaveFile(cache_file_name, buffer);
+                        }
+                        catch (std::exception &) {} // The cache is optional, don't fail if we can't write it.
                     }
                 }
-            }, atlas_params.atlas_flags);
 
-            // Insert the custom images into the atlas, if any.
-            for (GeneratedImage &generated : generated_images)
-                generated.generator->Generate(atlas.image, generated.region->second.region);
-            generated_images.clear();
+                // Insert the custom images into the atlas, if any.
+                for (impl::AtlasInput &input : inputs)
+                {
+                    if (input.generator)
+                        input.generator->Generate(atlas.image, input.region->second.region);
+                }
+                inputs.clear();
+
+                // Run a custom callback on the image, if any.
+                if (atlas_params.modify_image)
+                    atlas_params.modify_image(atlas.image);
+
+                atlas.size = atlas.image.Size();
+
+                // Load the image into a texture.
+                if (!bool(atlas_params.flags & Flags::no_texture))
+                {
+                    atlas.texture = nullptr;
+                    tex_unit.Attach(atlas.texture).SetData(atlas.image).Wrap(atlas_params.texture_wrap).Interpolation(atlas_params.texture_interpolation);
+                    if (!bool(atlas_params.flags & Flags::keep_image))
+                        atlas.image = {};
+                }
+            }
+        }
+
+        // Reloads the specified images from `state.regions`. See `GlobalData::Reload()`.
+        inline bool Reload(State &state, const LoadParams &params, const std::vector<std::string> &names)
+        {
+            struct Patch
+            {
+                impl::State::RegionPair *region = nullptr;
+                Atlas *atlas = nullptr;
+                Stream::ReadOnlyData data;
+                Graphics::Image image;
+                std::optional<irect2> new_region; // Set if the image changed size.
+            };
+
+            std::vector<Patch> patches;
+            for (const std::string &name : names)
+            {
+                auto it = state.regions.find(name);
+                if (it == state.regions.end() || it->second.make_generator)
+                    continue;
+
+                std::string atlas_name = params.name_to_atlas ? params.name_to_atlas(name) : std::string{};
+                auto atlas_it = state.atlases.find(atlas_name);
+                if (atlas_it == state.atlases.end() || (params.atlas_params && params.atlas_params(atlas_name).modify_image))
+                {
+                    Load(state, params);
+                    return false;
+                }
+
+                patches.push_back({.region = &*it, .atlas = &atlas_it->second, .data = params.get_data(name), .image = {}, .new_region = {}});
+            }
+
+            // Decode the images in parallel, like `MakeAtlas()` does.
+            Parallel::For(patches.size(), [&](std::size_t i)
+            {
+                patches[i].image = Graphics::Image(std::move(patches[i].data));
+            });
 
-            // Run a custom callback on the image, if any.
-            if (atlas_params.modify_image)
-                atlas_params.modify_image(atlas.image);
+            // The images that changed size are added to the free space of their atlas. Their old space stays unused until the next `Load()`.
+            for (Patch &patch : patches)
+            {
+                if (patch.image.Size() == patch.region->second.region.size())
+                    continue;
 
-            atlas.size = atlas.image.Size();
+                Packing::Rect rect(patch.image.Size());
+                if (!patch.atlas->packer || patch.atlas->packer.Add(&rect, 1) != 0)
+                {
+                    Load(state, params);
+                    return false;
+                }
+                patch.new_region = rect.pos.rect_size(rect.size);
+            }
 
-            // Load the image into a texture.
-            if (!bool(atlas_params.flags & Flags::no_texture))
+            TexUnit tex_unit = nullptr;
+            for (const Patch &patch : patches)
             {
-                atlas.texture = nullptr;
-                tex_unit.Attach(atlas.texture).SetData(atlas.image).Wrap(atlas_params.texture_wrap).Interpolation(atlas_params.texture_interpolation);
-                if (!bool(atlas_params.flags & Flags::keep_image))
-                    atlas.image = {};
+                if (patch.new_region)
+                    patch.region->second.region = *patch.new_region;
+
+                ivec2 pos = patch.region->second.region.a;
+                if (patch.atlas->image)
+                    patch.atlas->image.UnsafeDrawImage(patch.image, pos);
+                if (patch.atlas->texture)
+                    tex_unit.Attach(patch.atlas->texture).SetDataPart(pos, patch.image.Size(), patch.image.Data());
             }
+            return true;
         }
     }
 
+    // Loads all images mentioned in `Image()` calls into atlases.
+    inline void Load(const LoadParams &params)
+    {
+        impl::Load(impl::GetState(), params);
+    }
+
+    // Reloads the specified images after `Load()`, e.g. when their files change. Unknown and generated images are ignored.
+    // The new images are patched into the existing atlases (and their textures). The ones that changed size are placed into the free space
+    //   of the atlas using `Atlas::packer`, the rest of the images don't move.
+    // If they don't fit, or the atlas was loaded from the cache, or an affected atlas uses `modify_image`, falls back to calling `Load()`.
+    // Returns true if the atlases were patched, false if they were rebuilt. Throws if an image can't be loaded, without changing anything.
+    inline bool Reload(const LoadParams &params, const std::vector<std::string> &names)
+    {
+        return impl::Reload(impl::GetState(), params, names);
+    }
+
+    // Saves the image regions and the loaded atlases, and restores them on destruction.
+    // This lets tests call `Load()` with different parameters, without affecting the code that runs after them.
+    class StateBackup
+    {
+        std::map<std::string, Region, std::less<>> regions;
+        AtlasMap atlases;
+
+      public:
+        StateBackup()
+        {
+            for (const auto &[name, data] : impl::GetState().regions)
+                regions.try_emplace(name, data.region);
+            atlases = std::move(impl::GetState().atlases);
+            impl::GetState().atlases.clear();
+        }
+        StateBackup(const StateBackup &) = delete;
+        StateBackup &operator=(const StateBackup &) = delete;
+        ~StateBackup()
+        {
+            // The images registered since the backup was made keep their new regions.
+            for (auto &[name, data] : impl::GetState().regions)
+            {
+                if (auto it = regions.find(name); it != regions.end())
+                    data.region = it->second;
+            }
+            impl::GetState().atlases = std::move(atlases);
+        }
+    };
+
     // Returns a map of all loaded atlases.
     // The atlas addresses are NOT stable across reloads.
     [[nodiscard]] inline const AtlasMap &GetAtlases()
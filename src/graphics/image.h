@@ -1,12 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <utility>
 
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include "graphics/pixel_ops.h"
 #include "macros/finally.h"
 #include "stream/readonly_data.h"
 #include "strings/format.h"
@@ -39,7 +41,7 @@ namespace Graphics
         }
         Image(Stream::ReadOnlyData file, FlipMode flip_mode = no_flip) // Throws on failure.
         {
-            stbi_set_flip_vertically_on_load(flip_mode == flip_y);
+            stbi_set_flip_vertically_on_load_thread(flip_mode == flip_y); // The thread-local version, since images can be loaded in parallel, see `MakeAtlas()`.
             ivec2 img_size;
             uint8_t *bytes = stbi_load_from_memory(file.data(), file.size(), &img_size.x, &img_size.y, 0, 4);
             if (!bytes)
@@ -48,9 +50,20 @@ namespace Graphics
             *this = Image(img_size, bytes);
         }
 
+        // Makes white pixels with the specified alpha, e.g. from a glyph bitmap. `pitch` is the distance between the rows, in bytes.
+        [[nodiscard]] static Image FromAlpha(ivec2 size, const uint8_t *alpha, std::ptrdiff_t pitch)
+        {
+            Image ret(size);
+            for (int y = 0; y < size.y; y++)
+                PixelOps::Simd::ExpandAlpha(alpha + pitch * y, ret.data.data() + std::size_t(size.x) * y, size.x);
+            return ret;
+        }
+
         explicit operator bool() const {return data.size() > 0;}
 
+        u8vec4 *Pixels() {return data.data();}
         const u8vec4 *Pixels() const {return data.data();}
+        uint8_t *Data() {return (uint8_t *)Pixels();}
         const uint8_t *Data() const {return (const uint8_t *)Pixels();}
         ivec2 Size() const {return size;}
         irect2 Bounds() const {return ivec2().rect_size(Size());}
@@ -100,8 +113,10 @@ namespace Graphics
 
         void UnsafeFill(irect2 rect, u8vec4 color)
         {
-            for (ivec2 pos : vector_range(rect))
-                UnsafeAt(pos) = color;
+            if (!rect.has_area())
+                return;
+            for (int y = rect.a.y; y < rect.b.y; y++)
+                PixelOps::Simd::Fill(&UnsafeAt(ivec2(rect.a.x, y)), rect.size().x, color);
         }
 
         void UnsafeDrawImage(const Image &other, ivec2 pos) // Copies other image into this image, at specified location.
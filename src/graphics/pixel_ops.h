@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "utils/mat.h"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define IMP_PIXEL_OPS_AVX2 1
+#  define IMP_PIXEL_OPS_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define IMP_PIXEL_OPS_AVX2 0
+#  define IMP_PIXEL_OPS_SSE2 1
+#else
+#  define IMP_PIXEL_OPS_AVX2 0
+#  define IMP_PIXEL_OPS_SSE2 0
+#endif
+
+// Pixel loops for `Graphics::Image`.
+// Each operation has a scalar version, and a SIMD one (SSE2 or AVX2, depending on the compiler flags), which must give bit-exact results.
+// The SIMD versions fall back to the scalar ones if no SIMD is available, or for the leftover pixels.
+
+namespace Graphics::PixelOps
+{
+    static_assert(sizeof(u8vec4) == 4);
+
+    // Whether the `Simd` functions actually use SIMD.
+    inline constexpr bool has_simd = IMP_PIXEL_OPS_SSE2;
+    inline constexpr const char *simd_name = IMP_PIXEL_OPS_AVX2 ? "AVX2" : IMP_PIXEL_OPS_SSE2 ? "SSE2" : "none";
+
+    namespace Scalar
+    {
+        inline void Fill(u8vec4 *dst, std::size_t count, u8vec4 color)
+        {
+            std::fill_n(dst, count, color);
+        }
+
+        // Converts alpha values to white pixels with that alpha.
+        inline void ExpandAlpha(const std::uint8_t *src, u8vec4 *dst, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; i++)
+                dst[i] = u8vec4(255, 255, 255, src[i]);
+        }
+    }
+
+    namespace Simd
+    {
+        inline void Fill(u8vec4 *dst, std::size_t count, u8vec4 color)
+        {
+            std::size_t i = 0;
+            #if IMP_PIXEL_OPS_SSE2
+            std::uint32_t value;
+            std::memcpy(&value, &color, 4);
+            #if IMP_PIXEL_OPS_AVX2
+            __m256i wide = _mm256_set1_epi32(int(value));
+            for (; i + 8 <= count; i += 8)
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), wide);
+            #endif
+            __m128i narrow = _mm_set1_epi32(int(value));
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), narrow);
+            #endif
+            Scalar::Fill(dst + i, count - i, color);
+        }
+
+        inline void ExpandAlpha(const std::uint8_t *src, u8vec4 *dst, std::size_t count)
+        {
+            std::size_t i = 0;
+            #if IMP_PIXEL_OPS_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i white = _mm_set1_epi32(0x00ffffff);
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                __m128i lo = _mm_unpacklo_epi8(zero, a); // Each alpha is now in the high byte of a 16-bit lane.
+                __m128i hi = _mm_unpackhi_epi8(zero, a);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i     ), _mm_or_si128(white, _mm_unpacklo_epi16(zero, lo)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4 ), _mm_or_si128(white, _mm_unpackhi_epi16(zero, lo)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8 ), _mm_or_si128(white, _mm_unpacklo_epi16(zero, hi)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 12), _mm_or_si128(white, _mm_unpackhi_epi16(zero, hi)));
+            }
+            #endif
+            Scalar::ExpandAlpha(src + i, dst + i, count - i);
+        }
+    }
+}
@@ -2,11 +2,14 @@
 
 #include <algorithm>
 #include <array>
+#include <functional>
 #include <memory>
+#include <span>
 #include <type_traits>
 #include <vector>
 
 #include "graphics/vertex_buffer.h"
+#include "program/errors.h"
 
 namespace Graphics
 {
@@ -16,9 +19,15 @@ namespace Graphics
         static_assert(Graphics::VertexBuffer<T>::is_reflected, "The type must be reflected.");
         static_assert(N >= 1 && N <= 3, "N must be 1 (points), 2 (lines), or 3 (triangles).");
 
+      public:
+        // Receives the vertices on every flush, instead of drawing them.
+        using capture_func_t = std::function<void(std::span<const T> vertices)>;
+
+      private:
         std::size_t pos = 0, size = 0; // These are measured in primitives, not vertices.
         std::unique_ptr<T[]> storage;
         Graphics::VertexBuffer<T> buffer;
+        capture_func_t capture_func; // If set, we don't have a `buffer`, and call this instead.
 
         template <typename ...P>
         void AddLow(const P &... p)
@@ -38,6 +47,9 @@ namespace Graphics
         // The size is measured in primitives, not vertices.
         SimpleRenderQueue(std::size_t size) : size(size), storage(std::make_unique<T[]>(size * N)), buffer(size * N, 0, Graphics::stream_draw) {}
 
+        // Creates a queue that doesn't use GL. Instead, every flush passes the vertices to `capture_func`.
+        SimpleRenderQueue(std::size_t size, capture_func_t capture_func) : size(size), storage(std::make_unique<T[]>(size * N)), capture_func(std::move(capture_func)) {}
+
         [[nodiscard]] explicit operator bool()
         {
             return bool(storage);
@@ -65,11 +77,30 @@ namespace Graphics
         {
             if (pos <= 0)
                 return;
-            buffer.SetDataPart(0, pos * N, storage.get());
-            buffer.Draw(std::array{points, lines, triangles}[N-1], pos * N);
+            if (capture_func)
+            {
+                capture_func(std::span<const T>(storage.get(), pos * N));
+            }
+            else
+            {
+                buffer.SetDataPart(0, pos * N, storage.get());
+                buffer.Draw(std::array{points, lines, triangles}[N-1], pos * N);
+            }
             pos = 0;
         }
 
+        // Returns a pointer to `count` primitives (`count * N` vertices) at the end of the queue, which you must then fill.
+        // Flushes first if they don't fit. `count` can't be larger than `Size()`.
+        [[nodiscard]] T *AddUninitialized(std::size_t count)
+        {
+            ASSERT(count <= size, "Too many primitives requested from the render queue.");
+            if (pos + count > size)
+                Flush();
+            T *ret = storage.get() + N * pos;
+            pos += count;
+            return ret;
+        }
+
         void Add(const T &a) requires (N == 1)
         {
             AddLow(a);
@@ -0,0 +1,363 @@
+#include "dynamic_glyph_cache.h"
+#include "font_atlas_cache.h"
+#include "font_file.h"
+#include "text.h"
+#include "text_cache.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include <doctest/doctest.h>
+
+namespace
+{
+    [[nodiscard]] int TestKerning(std::uint32_t a, std::uint32_t b)
+    {
+        return int(a * 7 + b * 3) % 11 == 0 ? int(a + b) % 5 - 2 : 0;
+    }
+}
+
+TEST_CASE("font.kerning_table")
+{
+    constexpr std::size_t max_dense = Graphics::KerningTable::max_dense_chars;
+    for (std::size_t num_chars : {std::size_t(0), std::size_t(40), max_dense, max_dense + 60})
+    {
+        CAPTURE(num_chars);
+
+        std::vector<std::uint32_t> chars;
+        for (std::size_t i = 0; i < num_chars; i++)
+            chars.push_back(32 + i * 3);
+
+        Graphics::KerningTable table(chars, [&](std::size_t a, std::size_t b){return TestKerning(chars[a], chars[b]);});
+        REQUIRE(table.IsEmpty() == (num_chars == 0));
+        REQUIRE(table.IsDense() == (num_chars > 0 && num_chars <= Graphics::KerningTable::max_dense_chars));
+
+        for (std::uint32_t a = 0; a < 32 + num_chars * 3 + 5; a++)
+        for (std::uint32_t b = 0; b < 32 + num_chars * 3 + 5; b += 2)
+        {
+            bool in_set = a >= 32 && b >= 32 && (a - 32) % 3 == 0 && (b - 32) % 3 == 0 && (a - 32) / 3 < num_chars && (b - 32) / 3 < num_chars;
+            REQUIRE(table.Get(a, b) == (in_set ? TestKerning(a, b) : 0));
+        }
+    }
+
+    { // A sparse table from a list of pairs.
+        using Graphics::KerningTable;
+        KerningTable table = KerningTable::FromPairs({
+            {.key = KerningTable::PairKey('b', 'a'), .value = 2},
+            {.key = KerningTable::PairKey('a', 'b'), .value = -1},
+            {.key = KerningTable::PairKey('a', 'c'), .value = 0},
+            {.key = KerningTable::PairKey('b', 'a'), .value = 3},
+        });
+        REQUIRE_FALSE(table.IsDense());
+        REQUIRE(table.GetStorage().pairs.size() == 2);
+        REQUIRE(table.Get('a', 'b') == -1);
+        REQUIRE(table.Get('b', 'a') == 2);
+        REQUIRE(table.Get('a', 'c') == 0);
+        REQUIRE(table.Get('c', 'a') == 0);
+        REQUIRE(KerningTable::FromPairs({}).IsEmpty());
+    }
+
+    // The table overrides the function.
+    Graphics::Font font;
+    font.SetKerningFunc([](std::uint32_t, std::uint32_t){return 100;});
+    REQUIRE(font.Kerning('a', 'b') == 100);
+    std::vector<std::uint32_t> chars = {'a', 'b'};
+    font.SetKerningTable(Graphics::KerningTable(chars, [](std::size_t a, std::size_t b){return int(a) - int(b);}));
+    REQUIRE(font.Kerning('a', 'b') == -1);
+    REQUIRE(font.Kerning('b', 'c') == 0);
+}
+
+// Set `BENCH_FONT_FILE` to a font with kerning to run this.
+TEST_CASE("bench.font.kerning" * doctest::skip())
+{
+    const char *font_path = std::getenv("BENCH_FONT_FILE");
+    if (!font_path)
+    {
+        std::cout << "`BENCH_FONT_FILE` is not set, skipping.\n";
+        return;
+    }
+
+    Graphics::FontFile font_file(font_path, 16);
+    if (!font_file.HasKerning())
+    {
+        std::cout << "This font has no kerning, skipping.\n";
+        return;
+    }
+
+    Unicode::CharSet glyph_ranges;
+    glyph_ranges.Add(Unicode::Ranges::Basic_Latin);
+
+    std::string str;
+    while (str.size() < 100000)
+        str += "AVATAR WAVE To Tomorrow, Yesterday: \"LT\" vs \"AV\", PA. ";
+
+    auto Measure = [&](const char *name, const Graphics::Font &font)
+    {
+        constexpr int num_reps = 20;
+        int width = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_reps; i++)
+            width = Graphics::Text(font, str).ComputeStats().size.x;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << str.size() * double(num_reps) / seconds / 1e6 << " M chars/s\n";
+        return width;
+    };
+
+    Graphics::Font with_func;
+    with_func.SetKerningFunc(font_file.KerningFunc());
+    Graphics::Font with_table;
+    with_table.SetKerningTable(font_file.MakeKerningTable(glyph_ranges));
+
+    auto start = std::chrono::steady_clock::now();
+    (void)font_file.MakeKerningTable(glyph_ranges);
+    std::cout << "baking the table: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000 << " ms\n";
+
+    // The dynamic glyph cache bakes the kerning for the whole font.
+    Graphics::Font dynamic;
+    Graphics::Image image(ivec2(256));
+    start = std::chrono::steady_clock::now();
+    Graphics::DynamicGlyphCache cache(dynamic, font_file, Graphics::FontFile::none, image, image.Bounds());
+    std::cout << "starting the dynamic glyph cache (" << (dynamic.GetKerningTable().IsEmpty() ? "no table" : "with a table") << "): "
+        << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000 << " ms\n";
+
+    REQUIRE(Measure("freetype", with_func) == Measure("table", with_table));
+
+    // The dynamic font has actual glyphs, so compare the kerning directly.
+    for (std::uint32_t a = 0x20; a < 0x250; a++)
+    for (std::uint32_t b = 0x20; b < 0x250; b++)
+        REQUIRE(dynamic.Kerning(a, b) == font_file.Kerning(a, b));
+}
+
+TEST_CASE("font.atlas_cache")
+{
+    Unicode::CharSet glyph_ranges;
+    glyph_ranges.Add(Unicode::CharRange::Inclusive('a', 'z'));
+
+    irect2 rect = ivec2(8, 4).rect_size(ivec2(40, 30));
+    Graphics::Image image(ivec2(64));
+    for (ivec2 pos : vector_range(image.Size()))
+        image.UnsafeAt(pos) = u8vec4(pos.x * 3, pos.y * 5, pos.x ^ pos.y, 200);
+
+    Graphics::Font font;
+    font.SetAscent(9);
+    font.SetDescent(3);
+    font.SetLineSkip(13);
+    font.DefaultGlyph() = {.texture_pos = rect.a + 1, .size = ivec2(4, 6), .offset = ivec2(0, -6), .advance = 5};
+    for (uint32_t ch = 'a'; ch <= 'z'; ch++)
+        font.Insert(ch) = {.texture_pos = rect.a + ivec2(ch % 8 * 5, ch / 8 % 4 * 7), .size = ivec2(ch % 3 + 2, 7), .offset = ivec2(ch % 2, -7), .advance = 6};
+    std::vector<std::uint32_t> chars = {'a', 'v', 'w'};
+    font.SetKerningTable(Graphics::KerningTable(chars, [](std::size_t a, std::size_t b){return int(a) - int(b);}));
+
+    Graphics::FontAtlasEntry entry;
+    entry.target = &font;
+    entry.glyphs = &glyph_ranges;
+
+    std::uint64_t key = Graphics::FontAtlasCacheKey(rect.size(), {entry}, true);
+    REQUIRE(key != Graphics::FontAtlasCacheKey(rect.size(), {entry}, false));
+
+    std::vector<std::uint8_t> buffer;
+    Stream::Output output = Stream::Output::Container(buffer);
+    Graphics::SaveFontAtlasCache(output, key, image, rect, {entry});
+    output.Flush();
+
+    Graphics::Font loaded_font;
+    Graphics::Image loaded_image(image.Size());
+    Graphics::FontAtlasEntry loaded_entry = entry;
+    loaded_entry.target = &loaded_font;
+
+    // Wrong key.
+    Stream::Input input(Stream::ReadOnlyData::mem_reference(buffer));
+    REQUIRE_FALSE(Graphics::LoadFontAtlasCache(input, key + 1, loaded_image, rect, {loaded_entry}));
+    REQUIRE(loaded_font.Ascent() == 0);
+
+    // Truncated file.
+    std::vector<std::uint8_t> truncated(buffer.begin(), buffer.end() - 1);
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(truncated));
+    REQUIRE_THROWS(void(Graphics::LoadFontAtlasCache(input, key, loaded_image, rect, {loaded_entry})));
+    REQUIRE(loaded_font.Ascent() == 0);
+
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(buffer));
+    REQUIRE(Graphics::LoadFontAtlasCache(input, key, loaded_image, rect, {loaded_entry}));
+
+    for (ivec2 pos : vector_range(image.Size()))
+        REQUIRE(loaded_image.UnsafeAt(pos) == (rect.contains(pos) ? image.UnsafeAt(pos) : u8vec4(0)));
+
+    REQUIRE(loaded_font.Ascent() == font.Ascent());
+    REQUIRE(loaded_font.Descent() == font.Descent());
+    REQUIRE(loaded_font.LineSkip() == font.LineSkip());
+    REQUIRE(loaded_font.DefaultGlyph().texture_pos == font.DefaultGlyph().texture_pos);
+    REQUIRE(loaded_font.DefaultGlyph().advance == font.DefaultGlyph().advance);
+    for (uint32_t ch = 'a'; ch <= 'z'; ch++)
+    {
+        REQUIRE(loaded_font.GetOpt(ch));
+        REQUIRE(loaded_font.Get(ch).texture_pos == font.Get(ch).texture_pos);
+        REQUIRE(loaded_font.Get(ch).size == font.Get(ch).size);
+        REQUIRE(loaded_font.Get(ch).offset == font.Get(ch).offset);
+        REQUIRE(loaded_font.Get(ch).advance == font.Get(ch).advance);
+        for (uint32_t ch2 = 'a'; ch2 <= 'z'; ch2++)
+            REQUIRE(loaded_font.Kerning(ch, ch2) == font.Kerning(ch, ch2));
+    }
+}
+
+// Set `BENCH_FONT_FILE` to run this.
+TEST_CASE("bench.font.atlas_cache" * doctest::skip())
+{
+    const char *font_path = std::getenv("BENCH_FONT_FILE");
+    if (!font_path)
+    {
+        std::cout << "`BENCH_FONT_FILE` is not set, skipping.\n";
+        return;
+    }
+
+    Graphics::FontFile font_file(font_path, 16);
+    Unicode::CharSet glyph_ranges;
+    glyph_ranges.Add(Unicode::Ranges::Basic_Latin);
+    glyph_ranges.Add(Unicode::Ranges::Latin_1_Supplement);
+
+    std::string cache_file_name = (std::filesystem::temp_directory_path() / "bench_font_atlas.cache").string();
+    std::filesystem::remove(cache_file_name);
+
+    Graphics::Image image(ivec2(512));
+    Graphics::Font font;
+
+    auto Measure = [&](const char *name, auto &&func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::cout << name << ": " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000 << " ms\n";
+    };
+
+    Measure("uncached", [&]{Graphics::MakeFontAtlas(image, image.Bounds(), {{font, font_file, glyph_ranges}});});
+    Measure("cold", [&]{Graphics::MakeFontAtlasCached(image, image.Bounds(), {{font, font_file, glyph_ranges}}, cache_file_name);});
+    Measure("warm", [&]{Graphics::MakeFontAtlasCached(image, image.Bounds(), {{font, font_file, glyph_ranges}}, cache_file_name);});
+
+    std::filesystem::remove(cache_file_name);
+}
+
+TEST_CASE("font.dynamic_glyph_cache")
+{
+    // Each glyph is a solid square, colored by the character code. `?` acts as the default glyph.
+    std::size_t num_rasterized = 0;
+    auto Rasterize = [&](std::uint32_t ch) -> std::optional<Graphics::FontFile::GlyphData>
+    {
+        if (ch == 'z')
+            return {};
+        num_rasterized++;
+        int size = ch == Unicode::default_char ? 3 : 6;
+        Graphics::FontFile::GlyphData ret{.image = Graphics::Image(ivec2(size), u8vec4(ch, 0, 0, 255)), .offset = ivec2(0, -size), .advance = size + 1};
+        return ret;
+    };
+
+    irect2 rect = ivec2(4, 2).rect_size(ivec2(20, 17)); // Fits the default glyph and 2x3 other glyphs below it, with gaps.
+    Graphics::Image image(ivec2(32), u8vec4(1, 2, 3, 4));
+    Graphics::Font font;
+    Graphics::DynamicGlyphCache cache(font, image, rect, Rasterize);
+    REQUIRE(cache.TakeDirtyRect() == rect);
+    REQUIRE_FALSE(cache.TakeDirtyRect());
+
+    auto CheckGlyph = [&](std::uint32_t ch, const Graphics::Font::Glyph &glyph)
+    {
+        REQUIRE(rect.contains(glyph.texture_pos.rect_size(glyph.size)));
+        for (ivec2 pos : vector_range(glyph.size))
+            REQUIRE(image.UnsafeAt(glyph.texture_pos + pos) == u8vec4(ch, 0, 0, 255));
+    };
+    CheckGlyph(Unicode::default_char, font.DefaultGlyph());
+    auto IsDefaultGlyph = [&](const Graphics::Font::Glyph &glyph)
+    {
+        return glyph.texture_pos == font.DefaultGlyph().texture_pos && glyph.size == font.DefaultGlyph().size;
+    };
+
+    // Glyphs are rasterized once, on demand.
+    Graphics::Font::Glyph a = font.Get('a');
+    CheckGlyph('a', a);
+    REQUIRE(a.advance == 7);
+    REQUIRE(font.Get('a').texture_pos == a.texture_pos);
+    REQUIRE(num_rasterized == 2);
+    REQUIRE(cache.TakeDirtyRect() == a.texture_pos.rect_size(a.size));
+
+    // Missing glyphs use the default one.
+    REQUIRE(IsDefaultGlyph(font.Get('z')));
+    REQUIRE_FALSE(font.GetOpt('z'));
+    REQUIRE(num_rasterized == 2);
+
+    // Glyphs used in the current frame are never evicted.
+    for (std::uint32_t ch = 'b'; ch <= 'f'; ch++)
+        CheckGlyph(ch, font.Get(ch));
+    REQUIRE(cache.GetCounters().evictions == 0);
+    REQUIRE(IsDefaultGlyph(font.Get('g')));
+    REQUIRE(cache.GetCounters().failures == 1);
+    // The failure is remembered until the next frame.
+    std::size_t num_rasterized_before_retry = num_rasterized;
+    REQUIRE(IsDefaultGlyph(font.Get('g')));
+    REQUIRE(num_rasterized == num_rasterized_before_retry);
+    REQUIRE(cache.GetCounters().failures == 1);
+
+    // Next frame, the least recently used glyphs are evicted to make space.
+    cache.NextFrame();
+    (void)font.Get('a');
+    (void)cache.TakeDirtyRect();
+    std::uint64_t glyph_version = font.GlyphVersion();
+    Graphics::Font::Glyph g = font.Get('g');
+    CheckGlyph('g', g);
+    REQUIRE(cache.GetCounters().evictions == 1);
+    REQUIRE(font.GlyphVersion() != glyph_version); // Evictions are reported to the font.
+    REQUIRE(cache.TakeDirtyRect() == g.texture_pos.rect_size(g.size)); // `g` took the place of `b`.
+    CheckGlyph('a', font.Get('a')); // `a` was used this frame, so `b` was evicted instead.
+    std::size_t num_misses = cache.GetCounters().misses;
+    CheckGlyph('b', font.Get('b'));
+    REQUIRE(cache.GetCounters().misses == num_misses + 1);
+    CheckGlyph(Unicode::default_char, font.DefaultGlyph());
+}
+
+// Cached layouts of dynamic fonts must follow the glyphs when they're evicted and rasterized again.
+TEST_CASE("font.dynamic_glyph_cache_text_cache")
+{
+    auto Rasterize = [&](std::uint32_t ch) -> std::optional<Graphics::FontFile::GlyphData>
+    {
+        int size = ch == Unicode::default_char ? 3 : 6;
+        Graphics::FontFile::GlyphData ret{.image = Graphics::Image(ivec2(size), u8vec4(ch, 0, 0, 255)), .offset = ivec2(0, -size), .advance = size + 1};
+        return ret;
+    };
+
+    irect2 rect = ivec2(4, 2).rect_size(ivec2(20, 17)); // Fits the default glyph and 2x3 other glyphs, same as above.
+    Graphics::Image image(ivec2(32));
+    Graphics::Font font;
+    Graphics::DynamicGlyphCache cache(font, image, rect, Rasterize);
+    Graphics::TextCache text_cache;
+
+    // Checks that the layout of `ab` uses the current glyphs.
+    auto CheckLayout = [&](const Graphics::TextLayout &layout)
+    {
+        REQUIRE(layout.glyphs.size() == 2);
+        REQUIRE(layout.glyphs[0].texture_pos == font.Get('a').texture_pos);
+        REQUIRE(layout.glyphs[1].texture_pos == font.Get('b').texture_pos);
+        REQUIRE(image.UnsafeAt(layout.glyphs[0].texture_pos) == u8vec4('a', 0, 0, 255));
+        REQUIRE(image.UnsafeAt(layout.glyphs[1].texture_pos) == u8vec4('b', 0, 0, 255));
+    };
+
+    CheckLayout(text_cache.Get(font, "ab"));
+    REQUIRE(text_cache.GetCounters().misses == 1);
+
+    // Evict `a`, then `b` and `c` when `a` and `b` are requested again by the cache.
+    cache.NextFrame();
+    for (std::uint32_t ch = 'c'; ch <= 'g'; ch++)
+        (void)font.Get(ch);
+    REQUIRE(cache.GetCounters().evictions == 1);
+    cache.NextFrame();
+    CheckLayout(text_cache.Get(font, "ab"));
+    REQUIRE(cache.GetCounters().evictions == 3);
+    REQUIRE(text_cache.GetCounters().misses == 2);
+    REQUIRE(text_cache.Size() == 1);
+
+    // A cache hit counts as using the glyphs, so they're not evicted in the same frame.
+    cache.NextFrame();
+    CheckLayout(text_cache.Get(font, "ab"));
+    REQUIRE(text_cache.GetCounters().hits == 1);
+    for (std::uint32_t ch = 'h'; ch <= 'l'; ch++)
+        (void)font.Get(ch);
+    REQUIRE(cache.GetCounters().failures == 1);
+    CheckLayout(text_cache.Get(font, "ab"));
+}
@@ -0,0 +1,94 @@
+#include "image.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+namespace
+{
+    [[nodiscard]] std::vector<u8vec4> RandomPixels(std::size_t count, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<u8vec4> ret(count);
+        for (u8vec4 &pixel : ret)
+            pixel = u8vec4(rng(), rng(), rng(), rng());
+        return ret;
+    }
+}
+
+TEST_CASE("image.pixel_ops")
+{
+    // Check the SIMD versions against the scalar ones, with all kinds of leftovers.
+    for (std::size_t count = 0; count < 70; count++)
+    {
+        CAPTURE(count);
+
+        std::vector<u8vec4> pixels = RandomPixels(count + 2, count);
+        auto Compare = [&](auto &&scalar, auto &&simd)
+        {
+            // Operate on the middle of the buffer, to check that the pixels around it are untouched.
+            std::vector<u8vec4> a = pixels, b = pixels;
+            scalar(a.data() + 1);
+            simd(b.data() + 1);
+            REQUIRE(a == b);
+        };
+
+        Compare([&](u8vec4 *p){Graphics::PixelOps::Scalar::Fill(p, count, u8vec4(1, 2, 3, 4));}, [&](u8vec4 *p){Graphics::PixelOps::Simd::Fill(p, count, u8vec4(1, 2, 3, 4));});
+
+        std::vector<std::uint8_t> alpha(count);
+        for (std::size_t i = 0; i < count; i++)
+            alpha[i] = std::uint8_t(i * 37 + 5);
+        Compare([&](u8vec4 *p){Graphics::PixelOps::Scalar::ExpandAlpha(alpha.data(), p, count);}, [&](u8vec4 *p){Graphics::PixelOps::Simd::ExpandAlpha(alpha.data(), p, count);});
+    }
+}
+
+TEST_CASE("image.operations")
+{
+    ivec2 size(23, 7);
+    std::vector<u8vec4> pixels = RandomPixels(size.prod(), 1);
+    Graphics::Image original(size, reinterpret_cast<const std::uint8_t *>(pixels.data()));
+
+    Graphics::Image image = original;
+    irect2 rect = ivec2(3, 1).rect_to(ivec2(20, 5));
+    image.UnsafeFill(rect, u8vec4(9));
+    for (ivec2 pos : vector_range(size))
+        REQUIRE(image.UnsafeAt(pos) == (rect.contains(pos) ? u8vec4(9) : original.UnsafeAt(pos)));
+
+    // Rows with padding.
+    std::vector<std::uint8_t> alpha;
+    for (int y = 0; y < 5; y++)
+    for (int x = 0; x < 20; x++)
+        alpha.push_back(std::uint8_t(x * 10 + y));
+    image = Graphics::Image::FromAlpha(ivec2(17, 5), alpha.data(), 20);
+    for (ivec2 pos : vector_range(image.Size()))
+        REQUIRE(image.UnsafeAt(pos) == u8vec4(255, 255, 255, pos.x * 10 + pos.y));
+}
+
+TEST_CASE("bench.image.pixel_ops" * doctest::skip())
+{
+    std::cout << "SIMD: " << Graphics::PixelOps::simd_name << '\n';
+
+    constexpr std::size_t count = 2048 * 2048;
+    std::vector<u8vec4> pixels = RandomPixels(count, 42);
+    std::vector<std::uint8_t> alpha(count, 200);
+
+    auto Measure = [&](const char *name, auto &&func)
+    {
+        constexpr int num_reps = 20;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_reps; i++)
+            func();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << count * double(num_reps) / seconds / 1e6 << " M pixels/s\n";
+    };
+
+    namespace Scalar = Graphics::PixelOps::Scalar;
+    namespace Simd = Graphics::PixelOps::Simd;
+    Measure("fill, scalar", [&]{Scalar::Fill(pixels.data(), count, u8vec4(1, 2, 3, 4));});
+    Measure("fill, simd", [&]{Simd::Fill(pixels.data(), count, u8vec4(1, 2, 3, 4));});
+    Measure("expand alpha, scalar", [&]{Scalar::ExpandAlpha(alpha.data(), pixels.data(), count);});
+    Measure("expand alpha, simd", [&]{Simd::ExpandAlpha(alpha.data(), pixels.data(), count);});
+}
@@ -0,0 +1,73 @@
+#include "text_cache.h"
+
+#include <doctest/doctest.h>
+
+namespace
+{
+    [[nodiscard]] Graphics::Font MakeTestFont()
+    {
+        Graphics::Font font;
+        font.SetAscent(9);
+        font.SetDescent(3);
+        font.SetLineSkip(13);
+        font.SetKerningFunc([](uint32_t a, uint32_t b){return a == 'A' && b == 'V' ? -2 : 0;});
+        for (uint32_t ch = ' '; ch < 127; ch++)
+        {
+            Graphics::Font::Glyph &glyph = font.Insert(ch);
+            glyph.texture_pos = ivec2(ch % 16 * 6, ch / 16 * 12);
+            glyph.size = ivec2(ch % 3 + 4, 8);
+            glyph.offset = ivec2(ch % 2, -7);
+            glyph.advance = 6;
+        }
+        return font;
+    }
+}
+
+TEST_CASE("text_cache.layout")
+{
+    Graphics::Font font = MakeTestFont();
+    Graphics::TextLayout layout(Graphics::Text(font, "AV\nb"));
+
+    REQUIRE(layout.lines.size() == 2);
+    REQUIRE(layout.glyphs.size() == 3);
+    REQUIRE(layout.size == ivec2(10, 25));
+    REQUIRE(layout.lines[0].width == 10); // Kerning applies to `AV`.
+    REQUIRE(layout.glyphs[1].pos == ivec2(4 + 'V' % 2, 9 - 7));
+    REQUIRE(layout.glyphs[2].pos == ivec2('b' % 2, 9 + 13 - 7));
+
+    // Right-aligned lines, centered block.
+    std::vector<ivec2> offsets;
+    layout.ForEachGlyph(ivec2(1, 0), ivec2(0), [&](ivec2 offset, const Graphics::TextLayout::Glyph &){offsets.push_back(offset);});
+    REQUIRE(offsets == std::vector<ivec2>{ivec2(-5 + 'A' % 2, -12 + 2), ivec2(-1 + 'V' % 2, -12 + 2), ivec2(-1 + 'b' % 2, -12 + 15)});
+}
+
+TEST_CASE("text_cache.lru")
+{
+    Graphics::Font font = MakeTestFont();
+    Graphics::TextCache cache(2);
+
+    const Graphics::TextLayout *a = &cache.Get(font, "a");
+    REQUIRE(&cache.Get(font, "a") == a);
+    (void)cache.Get(font, "bb");
+    REQUIRE(&cache.Get(font, "a") == a); // Now `bb` is the least recently used one.
+    (void)cache.Get(font, "ccc");
+
+    REQUIRE(cache.Size() == 2);
+    REQUIRE(cache.GetCounters().hits == 2);
+    REQUIRE(cache.GetCounters().misses == 3);
+    REQUIRE(cache.GetCounters().evictions == 1);
+
+    REQUIRE(&cache.Get(font, "a") == a);
+    REQUIRE(cache.GetCounters().hits == 3);
+    REQUIRE(cache.Get(font, "bb").glyphs.size() == 2);
+    REQUIRE(cache.GetCounters().misses == 4);
+
+    // Different fonts don't share entries.
+    Graphics::Font other_font = MakeTestFont();
+    (void)cache.Get(other_font, "bb");
+    REQUIRE(cache.GetCounters().misses == 5);
+
+    cache.ResetCounters();
+    REQUIRE(cache.GetCounters().hits == 0);
+    REQUIRE(cache.GetCounters().HitRate() == 1);
+}
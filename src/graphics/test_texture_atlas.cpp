@@ -0,0 +1,246 @@
+#include "global_image_loader.h"
+#include "texture_atlas_cache.h"
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include <doctest/doctest.h>
+
+TEST_CASE("texture_atlas.cache")
+{
+    Graphics::Image image(ivec2(16, 8));
+    for (ivec2 pos : vector_range(image.Size()))
+        image.UnsafeAt(pos) = u8vec4(pos.x * 7, pos.y * 11, pos.x ^ pos.y, 255);
+    std::vector<irect2> regions = {ivec2(0).rect_size(ivec2(4)), ivec2(5, 1).rect_size(ivec2(8, 7)), ivec2(0).rect_size(ivec2(0))};
+
+    std::vector<std::uint8_t> buffer;
+    Stream::Output output = Stream::Output::Container(buffer);
+    Graphics::SaveAtlasCache(output, 42, image, regions);
+    output.Flush();
+
+    // Wrong key or region count.
+    Stream::Input input(Stream::ReadOnlyData::mem_reference(buffer));
+    REQUIRE_FALSE(Graphics::LoadAtlasCache(input, 43, regions.size()));
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(buffer));
+    REQUIRE_FALSE(Graphics::LoadAtlasCache(input, 42, regions.size() + 1));
+
+    // Truncated file.
+    std::vector<std::uint8_t> truncated(buffer.begin(), buffer.end() - 1);
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(truncated));
+    REQUIRE_THROWS(void(Graphics::LoadAtlasCache(input, 42, regions.size())));
+
+    // A huge atlas size is rejected before allocating anything.
+    std::vector<std::uint8_t> huge = buffer;
+    for (int i = 0; i < 8; i++)
+        huge[20 + i] = i % 4 == 3 ? 0x7f : 0xff; // 8 bytes after the magic, the version, and the key.
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(huge));
+    REQUIRE_THROWS(void(Graphics::LoadAtlasCache(input, 42, regions.size())));
+
+    input = Stream::Input(Stream::ReadOnlyData::mem_reference(buffer));
+    std::optional<Graphics::CachedAtlas> cached = Graphics::LoadAtlasCache(input, 42, regions.size());
+    REQUIRE(cached);
+    REQUIRE(cached->regions == regions);
+    REQUIRE(cached->image.Size() == image.Size());
+    for (ivec2 pos : vector_range(image.Size()))
+        REQUIRE(cached->image.UnsafeAt(pos) == image.UnsafeAt(pos));
+}
+
+namespace
+{
+    // Makes a PNG image with a unique pattern.
+    [[nodiscard]] std::vector<std::uint8_t> MakeTestPng(ivec2 size, int seed)
+    {
+        std::vector<u8vec4> pixels;
+        for (ivec2 pos : vector_range(size))
+            pixels.push_back(u8vec4(pos.x * 13 + seed, pos.y * 7 + seed * 3, seed, 255));
+
+        std::vector<std::uint8_t> ret;
+        stbi_write_png_to_func([](void *context, void *data, int size)
+        {
+            auto &ret = *static_cast<std::vector<std::uint8_t> *>(context);
+            ret.insert(ret.end(), static_cast<std::uint8_t *>(data), static_cast<std::uint8_t *>(data) + size);
+        }, &ret, size.x, size.y, 4, pixels.data(), size.x * 4);
+        return ret;
+    }
+}
+
+TEST_CASE("texture_atlas.make_atlas")
+{
+    std::vector<std::vector<std::uint8_t>> files;
+    for (int i = 0; i < 200; i++)
+        files.push_back(MakeTestPng(ivec2(i % 7 + 1, i % 5 + 2), i));
+
+    Packing::RectPacker packer;
+    auto Make = [&](std::vector<irect2> &texcoords)
+    {
+        texcoords.resize(files.size() + 1);
+        return Graphics::MakeAtlas(ivec2(256), [&](Graphics::AtlasInputFunc func)
+        {
+            for (std::size_t i = 0; i < files.size(); i++)
+            {
+                func(Stream::ReadOnlyData::mem_reference(files[i]), texcoords[i]);
+                if (i == 100)
+                    func(ivec2(10, 3), texcoords.back());
+            }
+        }, Graphics::AtlasFlags::add_gaps, &packer);
+    };
+
+    std::vector<irect2> texcoords;
+    Graphics::Image atlas = Make(texcoords);
+
+    REQUIRE(texcoords.back().size() == ivec2(10, 3));
+    REQUIRE(packer);
+    REQUIRE(packer.GetStats().num_packed == int(files.size()) + 1);
+    REQUIRE(packer.GetStats().Occupancy() > 0);
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+        int seed = int(i);
+        REQUIRE(texcoords[i].size() == ivec2(seed % 7 + 1, seed % 5 + 2));
+        for (ivec2 pos : vector_range(texcoords[i].size()))
+            REQUIRE(atlas.UnsafeAt(texcoords[i].a + pos) == u8vec4(pos.x * 13 + seed, pos.y * 7 + seed * 3, seed, 255));
+    }
+
+    // The output doesn't depend on the order in which the threads run.
+    for (int i = 0; i < 3; i++)
+    {
+        std::vector<irect2> other_texcoords;
+        Graphics::Image other_atlas = Make(other_texcoords);
+        REQUIRE(other_texcoords == texcoords);
+        REQUIRE(std::equal(atlas.Pixels(), atlas.Pixels() + atlas.Size().prod(), other_atlas.Pixels()));
+    }
+
+    // Broken images are reported.
+    files[150] = {1, 2, 3};
+    REQUIRE_THROWS(Make(texcoords));
+}
+
+TEST_CASE("texture_atlas.reload")
+{
+    // A private list of images. Registering them with `GlobalData::Image<...>()` would make every `GlobalData::Load()` in this binary look for them.
+    Graphics::GlobalData::impl::State state;
+    const Graphics::Region &a = state.regions["test_reload_a"].region;
+    const Graphics::Region &b = state.regions["test_reload_b"].region;
+
+    std::map<std::string, std::vector<std::uint8_t>> files;
+    int num_loaded = 0;
+
+    Graphics::GlobalData::LoadParams params;
+    params.get_data = [&](const std::string &name)
+    {
+        num_loaded++;
+        auto it = files.find(name);
+        if (it == files.end())
+            it = files.try_emplace(name, MakeTestPng(ivec2(3), 1)).first;
+        return Stream::ReadOnlyData::mem_reference(it->second);
+    };
+    params.atlas_params = [](const std::string &)
+    {
+        Graphics::GlobalData::AtlasParams ret;
+        ret.size = ivec2(256);
+        ret.flags = Graphics::GlobalData::no_texture;
+        return ret;
+    };
+
+    files["test_reload_a"] = MakeTestPng(ivec2(4, 5), 10);
+    files["test_reload_b"] = MakeTestPng(ivec2(6, 2), 20);
+    Graphics::GlobalData::impl::Load(state, params);
+    const Graphics::Image &atlas = state.atlases.at("").image;
+
+    auto CheckImage = [&](const Graphics::Region &region, ivec2 size, int seed)
+    {
+        REQUIRE(region.size() == size);
+        for (ivec2 pos : vector_range(size))
+            REQUIRE(atlas.UnsafeAt(region.a + pos) == u8vec4(pos.x * 13 + seed, pos.y * 7 + seed * 3, seed, 255));
+    };
+    CheckImage(a, ivec2(4, 5), 10);
+    CheckImage(b, ivec2(6, 2), 20);
+
+    // Same size, patched in place. Only the changed image is loaded.
+    irect2 old_b = b;
+    files["test_reload_a"] = MakeTestPng(ivec2(4, 5), 11);
+    num_loaded = 0;
+    REQUIRE(Graphics::GlobalData::impl::Reload(state, params, {"test_reload_a", "unknown_image"}));
+    REQUIRE(num_loaded == 1);
+    REQUIRE(b == old_b);
+    CheckImage(a, ivec2(4, 5), 11);
+    CheckImage(b, ivec2(6, 2), 20);
+
+    // A broken image doesn't change anything.
+    files["test_reload_b"] = {1, 2, 3};
+    REQUIRE_THROWS(Graphics::GlobalData::impl::Reload(state, params, {"test_reload_b"}));
+    CheckImage(b, ivec2(6, 2), 20);
+
+    // Different size, added to the free space in the atlas. The other images don't move.
+    irect2 old_a = a;
+    int num_packed = state.atlases.at("").packer.GetStats().num_packed;
+    files["test_reload_b"] = MakeTestPng(ivec2(7, 7), 21);
+    REQUIRE(Graphics::GlobalData::impl::Reload(state, params, {"test_reload_b"}));
+    REQUIRE(a == old_a);
+    CheckImage(a, ivec2(4, 5), 11);
+    CheckImage(b, ivec2(7, 7), 21);
+    REQUIRE(state.atlases.at("").packer.GetStats().num_packed == num_packed + 1);
+
+    // Doesn't fit into the free space, everything is reloaded.
+    files["test_reload_b"] = MakeTestPng(ivec2(250, 250), 22);
+    REQUIRE_FALSE(Graphics::GlobalData::impl::Reload(state, params, {"test_reload_b"}));
+    const Graphics::Image &new_atlas = state.atlases.at("").image;
+    REQUIRE(new_atlas.Size() == ivec2(256));
+    REQUIRE(b.size() == ivec2(250, 250));
+    REQUIRE(new_atlas.UnsafeAt(b.a + 1) == u8vec4(13 + 22, 7 + 22 * 3, 22, 255));
+}
+
+TEST_CASE("texture_atlas.load_cached")
+{
+    Graphics::GlobalData::impl::State state;
+    const Graphics::Region &a = state.regions["a"].region;
+    const Graphics::Region &b = state.regions["b"].region;
+
+    std::map<std::string, std::vector<std::uint8_t>> files = {{"a", MakeTestPng(ivec2(4, 5), 10)}, {"b", MakeTestPng(ivec2(6, 2), 20)}};
+    std::map<std::string, std::uint64_t> stamps = {{"a", 1}, {"b", 2}};
+    int num_loaded = 0;
+
+    std::string cache_file_name = (std::filesystem::temp_directory_path() / "imp_test_image_atlas.cache").string();
+    std::filesystem::remove(cache_file_name);
+
+    Graphics::GlobalData::LoadParams params;
+    params.get_data = [&](const std::string &name)
+    {
+        num_loaded++;
+        return Stream::ReadOnlyData::mem_reference(files.at(name));
+    };
+    params.get_stamp = [&](const std::string &name){return stamps.at(name);};
+    params.cache_file_name = [&](const std::string &){return cache_file_name;};
+    params.atlas_params = [](const std::string &)
+    {
+        Graphics::GlobalData::AtlasParams ret;
+        ret.size = ivec2(256);
+        ret.flags = Graphics::GlobalData::no_texture;
+        return ret;
+    };
+
+    Graphics::GlobalData::impl::Load(state, params);
+    REQUIRE(num_loaded == 2);
+    irect2 old_a = a, old_b = b;
+    Graphics::Image old_atlas = state.atlases.at("").image;
+
+    // Same stamps, the images aren't read at all.
+    num_loaded = 0;
+    Graphics::GlobalData::impl::Load(state, params);
+    REQUIRE(num_loaded == 0);
+    REQUIRE(a == old_a);
+    REQUIRE(b == old_b);
+    const Graphics::Image &atlas = state.atlases.at("").image;
+    REQUIRE(std::equal(atlas.Pixels(), atlas.Pixels() + atlas.Size().prod(), old_atlas.Pixels()));
+
+    // A changed stamp rebuilds the atlas.
+    files["b"] = MakeTestPng(ivec2(7, 7), 21);
+    stamps["b"] = 3;
+    Graphics::GlobalData::impl::Load(state, params);
+    REQUIRE(num_loaded == 2);
+    REQUIRE(b.size() == ivec2(7, 7));
+
+    std::filesystem::remove(cache_file_name);
+}
@@ -129,7 +129,7 @@ namespace Graphics
             }
             else
             {
-                const Font::Glyph &glyph = font.Get(ch);
+                Font::Glyph glyph = font.Get(ch);
                 Symbol symbol;
                 symbol.ch = ch;
                 symbol.texture_pos = glyph.texture_pos;
@@ -174,4 +174,77 @@ namespace Graphics
             return *this;
         }
     };
+
+    // A `Text` with precomputed glyph positions, ready to be drawn.
+    // The alignment is applied when drawing, so the same layout can be reused with different alignments.
+    struct TextLayout
+    {
+        struct Glyph
+        {
+            ivec2 pos; // Horizontally relative to the line start, vertically relative to the top of the text.
+            ivec2 size;
+            ivec2 texture_pos;
+        };
+
+        struct Line
+        {
+            int width = 0;
+            std::size_t glyphs_begin = 0;
+            std::size_t glyphs_end = 0;
+        };
+
+        std::vector<Glyph> glyphs;
+        std::vector<Line> lines;
+        ivec2 size;
+
+        TextLayout() {}
+        TextLayout(const Text &text)
+        {
+            Text::Stats stats = text.ComputeStats();
+            size = stats.size;
+
+            std::size_t num_glyphs = 0;
+            for (const Text::Line &line : text.lines)
+                num_glyphs += line.symbols.size();
+            glyphs.reserve(num_glyphs);
+            lines.reserve(text.lines.size());
+
+            int y = 0;
+            for (std::size_t line_index = 0; line_index < text.lines.size(); line_index++)
+            {
+                const Text::Stats::Line &line_stats = stats.lines[line_index];
+                Line &line = lines.emplace_back();
+                line.width = line_stats.width;
+                line.glyphs_begin = glyphs.size();
+
+                y += line_stats.ascent;
+
+                int x = 0;
+                for (const Text::Symbol &symbol : text.lines[line_index].symbols)
+                {
+                    glyphs.push_back({.pos = ivec2(x, y) + symbol.offset, .size = symbol.size, .texture_pos = symbol.texture_pos});
+                    x += symbol.advance + symbol.kerning;
+                }
+
+                line.glyphs_end = glyphs.size();
+                y += line_stats.descent + line_stats.line_gap;
+            }
+        }
+
+        // Calls `func(ivec2 offset, const Glyph &glyph)` for every glyph, where `offset` is the glyph position relative to the text position.
+        // `align` aligns each line, and `align_box` aligns the whole text block. Both are in range -1..1.
+        template <typename F>
+        void ForEachGlyph(ivec2 align, ivec2 align_box, F &&func) const
+        {
+            ivec2 offset = -size * (1 + align_box) / 2;
+            offset.x += size.x * (1 + align.x) / 2; // Note that we don't change vertical position here.
+
+            for (const Line &line : lines)
+            {
+                ivec2 line_offset(offset.x - line.width * (1 + align.x) / 2, offset.y);
+                for (std::size_t i = line.glyphs_begin; i < line.glyphs_end; i++)
+                    func(line_offset + glyphs[i].pos, glyphs[i]);
+            }
+        }
+    };
 }
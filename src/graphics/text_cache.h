@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "graphics/font.h"
+#include "graphics/text.h"
+#include "utils/hash.h"
+
+namespace Graphics
+{
+    // Caches text layouts by font and string, to avoid laying out the same strings every frame.
+    // When there's more than `capacity` entries, the least recently used ones are evicted.
+    // The cache stores font pointers, so `Clear()` it if a font is destroyed or modified.
+    // Changes reported by `Font::InvalidateGlyphs()` (e.g. evictions in a `DynamicGlyphCache`) are handled automatically, by laying out the strings again.
+    class TextCache
+    {
+      public:
+        struct Counters
+        {
+            std::size_t hits = 0;
+            std::size_t misses = 0; // Each miss allocates a new layout.
+            std::size_t evictions = 0;
+
+            [[nodiscard]] float HitRate() const
+            {
+                return hits + misses == 0 ? 1 : hits / float(hits + misses);
+            }
+        };
+
+      private:
+        struct Entry
+        {
+            const Font *font = nullptr;
+            std::string str;
+            TextLayout layout;
+            std::uint64_t glyph_version = 0; // `Font::GlyphVersion()` when `layout` was computed.
+        };
+        std::list<Entry> entries; // Most recently used first.
+
+        struct Key
+        {
+            const Font *font = nullptr;
+            std::string_view str; // Points to `Entry::str`.
+
+            friend bool operator==(const Key &, const Key &) = default;
+        };
+        struct KeyHasher
+        {
+            std::size_t operator()(const Key &key) const
+            {
+                return Hash::Combine(std::hash<const Font *>{}(key.font), std::hash<std::string_view>{}(key.str));
+            }
+        };
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> map;
+
+        std::size_t capacity = 0;
+        Counters counters;
+
+      public:
+        TextCache(std::size_t capacity = 64) : capacity(std::max(capacity, std::size_t(1))) {}
+
+        // Returns the layout for this string, computing it if necessary.
+        // The reference remains valid until the entry is evicted by a later call.
+        [[nodiscard]] const TextLayout &Get(const Font &font, std::string_view str)
+        {
+            if (auto it = map.find(Key{&font, str}); it != map.end())
+            {
+                Entry &entry = *it->second;
+                entries.splice(entries.begin(), entries, it->second);
+
+                // Dynamic fonts evict the glyphs that weren't requested recently, so request them again.
+                // This happens before the version check, since it can evict other glyphs.
+                if (font.HasGlyphFunc() && !str.empty())
+                {
+                    for (uint32_t ch : Unicode::Iterator(str))
+                    {
+                        if (ch != '\n')
+                            (void)font.Get(ch);
+                    }
+                }
+
+                if (entry.glyph_version == font.GlyphVersion())
+                {
+                    counters.hits++;
+                    return entry.layout;
+                }
+
+                // Some glyphs were evicted or moved since the layout was computed.
+                counters.misses++;
+                entry.layout = TextLayout(Text(font, str));
+                entry.glyph_version = font.GlyphVersion();
+                return entry.layout;
+            }
+
+            counters.misses++;
+            Entry &entry = entries.emplace_front(Entry{.font = &font, .str = std::string(str), .layout = TextLayout(Text(font, str)), .glyph_version = font.GlyphVersion()});
+            map.try_emplace(Key{entry.font, entry.str}, entries.begin());
+
+            while (entries.size() > capacity)
+            {
+                map.erase(Key{entries.back().font, entries.back().str});
+                entries.pop_back();
+                counters.evictions++;
+            }
+
+            return entry.layout;
+        }
+
+        [[nodiscard]] std::size_t Size() const
+        {
+            return entries.size();
+        }
+        [[nodiscard]] std::size_t Capacity() const
+        {
+            return capacity;
+        }
+
+        void Clear()
+        {
+            map.clear();
+            entries.clear();
+        }
+
+        [[nodiscard]] const Counters &GetCounters() const
+        {
+            return counters;
+        }
+        void ResetCounters()
+        {
+            counters = {};
+        }
+    };
+}
@@ -1,18 +1,22 @@
 #include "texture_atlas.h"
 
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "meta/common.h"
 #include "strings/format.h"
 #include "utils/packing.h"
+#include "utils/parallel.h"
 
 namespace Graphics
 {
-    Image MakeAtlas(ivec2 target_size, std::function<void(AtlasInputFunc func)> func, AtlasFlags flags)
+    Image MakeAtlas(ivec2 target_size, std::function<void(AtlasInputFunc func)> func, AtlasFlags flags, Packing::RectPacker *packer)
     {
-        // Load images.
+        // Collect the images.
         struct Elem
         {
+            std::optional<Stream::ReadOnlyData> data; // Null for empty images. Reset after decoding.
             Image image; // Can be empty for empty images. But the size in `texcoords` is always correct.
             irect2 *texcoords = nullptr;
         };
@@ -22,10 +26,9 @@ namespace Graphics
             Elem &new_elem = elem_list.emplace_back();
             new_elem.texcoords = &texcoords;
             std::visit(Meta::overload{
-                [&](const Stream::ReadOnlyData &data)
+                [&](Stream::ReadOnlyData &data)
                 {
-                    new_elem.image = data;
-                    texcoords = ivec2().rect_size(new_elem.image.Size());
+                    new_elem.data = std::move(data);
                 },
                 [&](ivec2 size)
                 {
@@ -34,19 +37,34 @@ namespace Graphics
             }, data);
         });
 
+        // Decode the images. This is the slowest part, so it's done in parallel.
+        Parallel::For(elem_list.size(), [&](std::size_t i)
+        {
+            Elem &elem = elem_list[i];
+            if (!elem.data)
+                return;
+            elem.image = *elem.data;
+            *elem.texcoords = ivec2().rect_size(elem.image.Size());
+            elem.data.reset();
+        });
+
         // Construct the rectangle list for packing.
         std::vector<Packing::Rect> rect_list;
         rect_list.reserve(elem_list.size());
         for (const Elem &elem : elem_list)
             rect_list.push_back(elem.texcoords->size());
 
-        // Try packing the rectangles.
-        if (Packing::PackRects(target_size, rect_list.data(), rect_list.size(), bool(flags & AtlasFlags::add_gaps)))
+        // Try packing the rectangles, with several heuristics.
+        Packing::RectPacker best_packer = Packing::PackRectsBest(target_size, rect_list.data(), rect_list.size(), bool(flags & AtlasFlags::add_gaps));
+        if (std::size_t(best_packer.GetStats().num_packed) != rect_list.size())
             throw std::runtime_error(FMT("Unable to fit texture atlas into a {}x{} texture.", target_size.x, target_size.y));
+        if (packer)
+            *packer = std::move(best_packer);
 
         // Construct the final image, and output the texture coords.
+        // The packed rectangles don't overlap, so the images can be copied in parallel.
         Image ret = Image(target_size, u8vec4(0));
-        for (size_t i = 0; i < elem_list.size(); i++)
+        Parallel::For(elem_list.size(), [&](std::size_t i)
         {
             // Copy the image, if any.
             if (elem_list[i].image)
@@ -54,7 +72,7 @@ namespace Graphics
 
             // Output the coordinates.
             *elem_list[i].texcoords = rect_list[i].pos.rect_size(elem_list[i].texcoords->size());
-        }
+        });
 
         return ret;
     }
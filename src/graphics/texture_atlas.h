@@ -7,6 +7,7 @@
 #include "macros/enum_flag_operators.h"
 #include "stream/readonly_data.h"
 #include "utils/mat.h"
+#include "utils/packing.h"
 
 namespace Graphics
 {
@@ -24,5 +25,7 @@ namespace Graphics
 
     // Packs images into an atlas. Throws on failure.
     // Call the `func` you receive once for each image that needs to be loaded.
-    [[nodiscard]] Image MakeAtlas(ivec2 target_size, std::function<void(AtlasInputFunc func)> func, AtlasFlags flags = AtlasFlags::none);
+    // If `packer` isn't null, it receives the packer that was used, with its statistics.
+    // More images can be added to it later without moving the existing ones, see `GlobalData::Reload()`.
+    [[nodiscard]] Image MakeAtlas(ivec2 target_size, std::function<void(AtlasInputFunc func)> func, AtlasFlags flags = AtlasFlags::none, Packing::RectPacker *packer = nullptr);
 }
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "graphics/image.h"
+#include "stream/input.h"
+#include "stream/output.h"
+#include "utils/mat.h"
+
+// A persistent cache for `MakeAtlas()`.
+// The cache file stores the packed atlas pixels and the resulting texture coords, so a warm start doesn't need to decode or pack anything.
+// Computing the key is up to you, see `GlobalData::Load()` for an example.
+
+namespace Graphics
+{
+    namespace impl::AtlasCache
+    {
+        // Bump this when changing the file format or `MakeAtlas()`.
+        inline constexpr std::uint32_t version = 2;
+        inline constexpr std::string_view magic = "IMGATLAS";
+    }
+
+    struct CachedAtlas
+    {
+        Image image;
+        std::vector<irect2> regions; // In the same order as passed to `SaveAtlasCache()`.
+    };
+
+    // Writes an atlas produced by `MakeAtlas()`, and the texture coords it produced.
+    inline void SaveAtlasCache(Stream::Output &output, std::uint64_t key, const Image &image, std::span<const irect2> regions)
+    {
+        namespace C = impl::AtlasCache;
+
+        output.WriteString(C::magic.data(), C::magic.size());
+        output.WriteLittle<std::uint32_t>(C::version);
+        output.WriteLittle<std::uint64_t>(key);
+
+        output.WriteLittle<std::int32_t>(image.Size().x);
+        output.WriteLittle<std::int32_t>(image.Size().y);
+        output.WriteBytes(image.Data(), std::size_t(image.Size().prod()) * sizeof(u8vec4));
+
+        output.WriteLittle<std::uint32_t>(regions.size());
+        for (const irect2 &region : regions)
+        {
+            output.WriteLittle<std::int32_t>(region.a.x);
+            output.WriteLittle<std::int32_t>(region.a.y);
+            output.WriteLittle<std::int32_t>(region.b.x);
+            output.WriteLittle<std::int32_t>(region.b.y);
+        }
+    }
+
+    // Loads a cache written by `SaveAtlasCache()`.
+    // Returns null if the cache has a different key, version, or number of regions. Throws if the file is malformed.
+    [[nodiscard]] inline std::optional<CachedAtlas> LoadAtlasCache(Stream::Input &input, std::uint64_t key, std::size_t num_regions)
+    {
+        namespace C = impl::AtlasCache;
+
+        std::string file_magic(C::magic.size(), '\0');
+        input.Read(file_magic.data(), file_magic.size());
+        if (file_magic != C::magic)
+            throw std::runtime_error(input.GetExceptionPrefix() + "This is not a texture atlas cache.");
+        if (input.ReadLittle<std::uint32_t>() != C::version || input.ReadLittle<std::uint64_t>() != key)
+            return {};
+
+        ivec2 size;
+        size.x = input.ReadLittle<std::int32_t>();
+        size.y = input.ReadLittle<std::int32_t>();
+        // Check the size against the file size before allocating, to reject corrupted files instead of overflowing.
+        std::uint64_t num_pixels = std::uint64_t(std::max(size.x, 0)) * std::uint64_t(std::max(size.y, 0));
+        if ((size <= 0).any() || num_pixels > input.RemainingBytes() / sizeof(u8vec4) || num_pixels > std::uint64_t(std::numeric_limits<int>::max()))
+            throw std::runtime_error(input.GetExceptionPrefix() + "Invalid texture atlas size in the cache.");
+
+        CachedAtlas ret;
+        ret.image = Image(size);
+        input.Read(ret.image.Data(), std::size_t(num_pixels) * sizeof(u8vec4));
+
+        if (input.ReadLittle<std::uint32_t>() != num_regions)
+            return {};
+        ret.regions.resize(num_regions);
+        for (irect2 &region : ret.regions)
+        {
+            region.a.x = input.ReadLittle<std::int32_t>();
+            region.a.y = input.ReadLittle<std::int32_t>();
+            region.b.x = input.ReadLittle<std::int32_t>();
+            region.b.y = input.ReadLittle<std::int32_t>();
+            if (!ret.image.Bounds().contains(region))
+                throw std::runtime_error(input.GetExceptionPrefix() + "Invalid texture coords in the texture atlas cache.");
+        }
+
+        input.ExpectEnd();
+        return ret;
+    }
+}
@@ -163,3 +163,10 @@
 #ifndef IMP_PLATFORM_FLAG_prod
 #  define IMP_PLATFORM_FLAG_prod 0
 #endif
+
+// - Optional libraries
+
+// Whether LZ4 and Zstd are linked, for `Archive::Codec::lz4` and `zstd`. Needs to be set to true manually, see `EXTRA_CODECS` in `project.mk`.
+#ifndef IMP_PLATFORM_FLAG_extra_codecs
+#  define IMP_PLATFORM_FLAG_extra_codecs 0
+#endif
@@ -202,6 +202,15 @@ namespace Refl
         // that all nested objects have this flag set too), otherwise conversion to string can yield weird results.
         template <typename T, typename = void>
         struct HasShortStringRepresentation : std::false_type {};
+
+        // Set `value` to true for types whose binary representation matches the object representation (no padding, no pointers, native byte order).
+        // Contiguous containers of such types are then [de]serialized with a single copy, instead of per-element interface calls.
+        // The specializations must also have `static bool IsValid(const T &)`, which should return false for values the interface would refuse to [de]serialize.
+        template <typename T, typename = void>
+        struct BulkBinaryRepresentation
+        {
+            static constexpr bool value = false;
+        };
     }
 
 
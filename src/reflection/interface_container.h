@@ -1,14 +1,17 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <iterator>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
 #include "meta/common.h"
 #include "reflection/interface_basic.h"
+#include "strings/format.h"
 #include "utils/robust_math.h"
 
 namespace Refl
@@ -139,10 +142,7 @@ namespace Refl
 
         void ToBinary(const T &object, Stream::Output &output, const ToBinaryOptions &options, impl::ToBinaryState state) const override
         {
-            impl::container_length_binary_t len;
-            if (Robust::conversion_fails(object.size(), len))
-                throw std::runtime_error(output.GetExceptionPrefix() + "The container is too long.");
-            output.WriteWithByteOrder<impl::container_length_binary_t>(impl::container_length_byte_order, len);
+            WriteBinaryLength(Size(object), output);
 
             auto next_state = state.MemberOrElem(options);
 
@@ -154,9 +154,7 @@ namespace Refl
 
         void FromBinary(T &object, Stream::Input &input, const FromBinaryOptions &options, impl::FromBinaryState state) const override
         {
-            std::size_t len;
-            if (Robust::conversion_fails(input.ReadWithByteOrder<impl::container_length_binary_t>(impl::container_length_byte_order), len))
-                throw std::runtime_error(input.GetExceptionPrefix() + "The string is too long.");
+            std::size_t len = ReadBinaryLength(input);
 
             std::size_t max_reserved_elems = options.max_reserved_size / sizeof(elem_t);
 
@@ -180,6 +178,23 @@ namespace Refl
                 }
             }
         }
+
+      protected:
+        // The length prefix used by `ToBinary()` and `FromBinary()`.
+        static void WriteBinaryLength(std::size_t size, Stream::Output &output)
+        {
+            impl::container_length_binary_t len;
+            if (Robust::conversion_fails(size, len))
+                throw std::runtime_error(output.GetExceptionPrefix() + "The container is too long.");
+            output.WriteWithByteOrder<impl::container_length_binary_t>(impl::container_length_byte_order, len);
+        }
+        [[nodiscard]] static std::size_t ReadBinaryLength(Stream::Input &input)
+        {
+            std::size_t len;
+            if (Robust::conversion_fails(input.ReadWithByteOrder<impl::container_length_binary_t>(impl::container_length_byte_order), len))
+                throw std::runtime_error(input.GetExceptionPrefix() + "The string is too long.");
+            return len;
+        }
     };
 
     namespace impl::StdContainer
@@ -190,6 +205,9 @@ namespace Refl
         template <typename T> using has_push_back =
             decltype(std::declval<T &>().push_back(std::declval<const typename ContainerElem<T>::type &>()));
 
+        template <typename T> using has_data_and_resize =
+            decltype(void(std::declval<T &>().data()), std::declval<T &>().resize(std::size_t{}));
+
         template <typename T> using has_single_arg_insert =
             decltype(std::declval<T &>().insert(std::declval<const typename ContainerElem<T>::type &>()));
 
@@ -218,6 +236,11 @@ namespace Refl
 
       public:
         using typename Interface_BasicContainer<T>::elem_t;
+        using typename Interface_BasicContainer<T>::mutable_elem_t;
+
+        // If true, the elements are [de]serialized to binary with a single copy. The result is the same as with per-element calls.
+        static constexpr bool bulk_binary = impl::BulkBinaryRepresentation<mutable_elem_t>::value && std::is_same_v<elem_t, mutable_elem_t> &&
+            std::contiguous_iterator<impl::StdContainer::iter_t<T>> && Meta::is_detected<impl::StdContainer::has_data_and_resize, T>;
 
         [[nodiscard]] virtual std::size_t Size(const T &object) const override
         {
@@ -250,6 +273,51 @@ namespace Refl
             for (auto it = object.begin(); it != object.end(); it++)
                 func(*it);
         }
+
+        void ToBinary(const T &object, Stream::Output &output, const ToBinaryOptions &options, impl::ToBinaryState state) const override
+        {
+            if constexpr (!bulk_binary)
+            {
+                Interface_BasicContainer<T>::ToBinary(object, output, options, state);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < object.size(); i++)
+                {
+                    if (!impl::BulkBinaryRepresentation<elem_t>::IsValid(object.data()[i]))
+                        throw std::runtime_error(FMT("{}Unable to serialize element #{}: Invalid value.", output.GetExceptionPrefix(), i));
+                }
+
+                this->WriteBinaryLength(object.size(), output);
+                output.WriteBytes(reinterpret_cast<const std::uint8_t *>(object.data()), object.size() * sizeof(elem_t));
+            }
+        }
+
+        void FromBinary(T &object, Stream::Input &input, const FromBinaryOptions &options, impl::FromBinaryState state) const override
+        {
+            if constexpr (!bulk_binary)
+            {
+                Interface_BasicContainer<T>::FromBinary(object, input, options, state);
+            }
+            else
+            {
+                std::size_t len = this->ReadBinaryLength(input);
+
+                // Check this before allocating anything, the length can be bogus.
+                if (len > input.RemainingBytes() / sizeof(elem_t))
+                    throw std::runtime_error(input.GetExceptionPrefix() + "Unexpected end of data.");
+
+                this->Clear(object);
+                object.resize(len);
+                input.Read(reinterpret_cast<std::uint8_t *>(object.data()), len * sizeof(elem_t));
+
+                for (std::size_t i = 0; i < len; i++)
+                {
+                    if (!impl::BulkBinaryRepresentation<elem_t>::IsValid(object.data()[i]))
+                        throw std::runtime_error(FMT("{}Invalid value of element #{}.", input.GetExceptionPrefix(), i));
+                }
+            }
+        }
     };
 
     template <typename T>
@@ -52,6 +52,7 @@ namespace Refl
             std::vector<ValueNamePair<T>> values_to_names;
             std::vector<NameValuePair<T>> names_to_values;
             bool is_relaxed = false;
+            bool values_are_contiguous = false; // If true, the values are exactly `values_to_names.front() ... values_to_names.back()`.
 
           public:
             Helper(std::initializer_list<ValueNamePair<T>> list, bool is_relaxed)
@@ -59,6 +60,9 @@ namespace Refl
             {
                 values_to_names = std::vector<ValueNamePair<T>>(list.begin(), list.end());
                 std::sort(values_to_names.begin(), values_to_names.end());
+                values_are_contiguous = !values_to_names.empty() &&
+                    std::size_t(underlying(values_to_names.back().value)) - std::size_t(underlying(values_to_names.front().value)) == values_to_names.size() - 1 &&
+                    std::adjacent_find(values_to_names.begin(), values_to_names.end(), [](const auto &a, const auto &b){return a.value == b.value;}) == values_to_names.end();
 
                 names_to_values.reserve(list.size());
                 for (const auto &elem : list)
@@ -77,6 +81,14 @@ namespace Refl
                 return is_relaxed;
             }
 
+            // Returns true if the value has a name. Same as `ValueToName(value) != nullptr`, but faster for the typical enums.
+            bool IsNamedValue(T value) const
+            {
+                if (values_are_contiguous)
+                    return underlying(value) >= underlying(values_to_names.front().value) && underlying(value) <= underlying(values_to_names.back().value);
+                return ValueToName(value) != nullptr;
+            }
+
             // Returns nullptr on failure.
             const char *ValueToName(T value) const
             {
@@ -200,6 +212,19 @@ namespace Refl
 
     template <typename T>
     struct impl::HasShortStringRepresentation<T, Meta::void_type<impl::Enum::detect_enum<T>>> : std::true_type {};
+
+    template <typename T>
+    struct impl::BulkBinaryRepresentation<T, Meta::void_type<impl::Enum::detect_enum<T>>>
+    {
+        static constexpr bool value = BulkBinaryRepresentation<std::underlying_type_t<T>>::value;
+
+        // Same check as in `Interface_Enum`.
+        [[nodiscard]] static bool IsValid(const T &object)
+        {
+            const auto &helper = Enum::GetHelper<T>();
+            return helper.IsRelaxed() || helper.IsNamedValue(object);
+        }
+    };
 }
 
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <exception>
+#include <string>
+#include <string_view>
 #include <type_traits>
 
 #include "reflection/interface_basic.h"
@@ -42,7 +44,21 @@ namespace Refl
                 return ok;
             });
 
-            std::string str = input.Extract(category);
+            std::string str_storage;
+            std::string_view str;
+            if (const std::uint8_t *memory = input.ContiguousData())
+            {
+                // Parse in place, without copying the characters.
+                std::size_t begin = input.Position();
+                input.Discard<Stream::at_least_one>(category);
+                str = std::string_view(reinterpret_cast<const char *>(memory) + begin, input.Position() - begin);
+            }
+            else
+            {
+                str_storage = input.Extract(category);
+                str = str_storage;
+            }
+
             try
             {
                 object = Strings::FromString<T>(str);
@@ -78,4 +94,17 @@ namespace Refl
 
     template <typename T>
     struct impl::HasShortStringRepresentation<T, std::enable_if_t<std::is_arithmetic_v<T>>> : std::true_type {};
+
+    template <typename T>
+    struct impl::BulkBinaryRepresentation<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+    {
+        // Not every byte is a valid `bool`, and `long double` can have padding.
+        static constexpr bool value = scalar_byte_order == ByteOrder::native && !std::is_same_v<T, bool> && !std::is_same_v<T, long double>;
+
+        [[nodiscard]] static constexpr bool IsValid(const T &object)
+        {
+            (void)object;
+            return true;
+        }
+    };
 }
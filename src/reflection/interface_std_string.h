@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <exception>
 #include <string>
+#include <string_view>
 #include <type_traits>
 
 #include "reflection/interface_basic.h"
@@ -36,20 +37,44 @@ namespace Refl
 
             input.Discard('"');
             std::string temp_str;
-            while (true)
+            std::string_view str;
+            if (const std::uint8_t *memory = input.ContiguousData())
             {
-                char ch = input.ReadChar();
-                if (ch == '"')
-                    break;
-
-                temp_str += ch;
-                if (ch == '\\')
-                    temp_str += input.ReadChar();
+                // Find the closing quote in place, without copying the characters.
+                const char *begin = reinterpret_cast<const char *>(memory) + input.Position();
+                const char *end = reinterpret_cast<const char *>(memory) + input.Size();
+                const char *cur = begin;
+                while (cur != end && *cur != '"')
+                {
+                    if (*cur++ == '\\' && cur != end)
+                        cur++;
+                }
+                if (cur == end)
+                {
+                    input.Seek(0, Stream::end);
+                    throw std::runtime_error(input.GetExceptionPrefix() + "Unexpected end of input.");
+                }
+                str = std::string_view(begin, cur);
+                input.Skip(cur - begin + 1);
+            }
+            else
+            {
+                while (true)
+                {
+                    char ch = input.ReadChar();
+                    if (ch == '"')
+                        break;
+
+                    temp_str += ch;
+                    if (ch == '\\')
+                        temp_str += input.ReadChar();
+                }
+                str = temp_str;
             }
 
             try
             {
-                object = Strings::Unescape(temp_str, Strings::UnescapeFlags::strip_cr_bytes);
+                object = Strings::Unescape(str, Strings::UnescapeFlags::strip_cr_bytes);
             }
             catch (std::exception &e)
             {
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <exception>
 #include <limits>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <variant>
 
@@ -61,10 +63,11 @@ namespace Refl
 
         void FromString(T &object, Stream::Input &input, const FromStringOptions &options, impl::FromStringState state) const override
         {
-            std::string name = input.Extract(Stream::Char::SeqIdentifier{});
-            std::size_t index = Utils::GetStringIndex<ElemNames>(name.c_str());
+            std::string name_storage;
+            std::string_view name = Utils::ExtractIdentifier(input, name_storage);
+            std::size_t index = Utils::GetStringIndex<ElemNames>(name);
             if (index == std::size_t(-1))
-                throw std::runtime_error(input.GetExceptionPrefix() + "Unknown variant alternative name: `" + name + "`.");
+                throw std::runtime_error(input.GetExceptionPrefix() + "Unknown variant alternative name: `" + std::string(name) + "`.");
 
             Utils::SkipWhitespaceAndComments(input);
 
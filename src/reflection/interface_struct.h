@@ -259,6 +259,8 @@ namespace Refl
 
                 input.Discard('{');
 
+                std::string name_storage;
+
                 while (true)
                 {
                     // Skip whitespace before the entry.
@@ -269,7 +271,7 @@ namespace Refl
                         break;
 
                     // Get member or base name.
-                    std::string name = input.Extract(Stream::Char::SeqIdentifier{});
+                    std::string_view name = Utils::ExtractIdentifier(input, name_storage);
                     Utils::SkipWhitespaceAndComments(input);
 
                     char first_char = input.PeekChar();
@@ -280,22 +282,22 @@ namespace Refl
                         // We got a base class.
                         std::size_t base_index = Class::CombinedBaseIndex<T>(name);
                         if (base_index == std::size_t(-1))
-                            throw std::runtime_error(input.GetExceptionPrefix() + "Unknown base class: `" + name + "`.");
+                            throw std::runtime_error(input.GetExceptionPrefix() + "Unknown base class: `" + std::string(name) + "`.");
 
                         Meta::with_cexpr_value<combined_base_count>(base_index, [&](auto index)
                         {
                             constexpr auto i = index.value;
                             if (!state.NeedVirtualBases() && i >= Meta::list_size<Class::regular_bases<T>>)
-                                throw std::runtime_error(input.GetExceptionPrefix() + "Virtual base class `" + name + "` must be mentioned in the most derived class, not here.");
+                                throw std::runtime_error(input.GetExceptionPrefix() + "Virtual base class `" + std::string(name) + "` must be mentioned in the most derived class, not here.");
 
                             if (obtained_bases[i])
-                                throw std::runtime_error(input.GetExceptionPrefix() + "Base class mentioned more than once: `" + name + "`.");
+                                throw std::runtime_error(input.GetExceptionPrefix() + "Base class mentioned more than once: `" + std::string(name) + "`.");
 
                             using this_base = Meta::list_type_at<combined_bases, i>;
 
                             if constexpr (impl::Class::skip_base<this_base>)
                             {
-                                throw std::runtime_error(input.GetExceptionPrefix() + "Empty base class is mentioned: `" + name + "`.");
+                                throw std::runtime_error(input.GetExceptionPrefix() + "Empty base class is mentioned: `" + std::string(name) + "`.");
                             }
                             else
                             {
@@ -315,17 +317,17 @@ namespace Refl
 
                         std::size_t member_index = Class::MemberIndex<T>(name);
                         if (member_index == std::size_t(-1))
-                            throw std::runtime_error(input.GetExceptionPrefix() + "Unknown field: `" + name + "`.");
+                            throw std::runtime_error(input.GetExceptionPrefix() + "Unknown field: `" + std::string(name) + "`.");
 
                         Meta::with_cexpr_value<Class::member_count<T>>(member_index, [&](auto index)
                         {
                             constexpr auto i = index.value;
                             if (obtained_members[i])
-                                throw std::runtime_error(input.GetExceptionPrefix() + "Field mentioned more than once: `" + name + "`.");
+                                throw std::runtime_error(input.GetExceptionPrefix() + "Field mentioned more than once: `" + std::string(name) + "`.");
 
                             if constexpr (impl::Class::skip_member<Class::member_type<T, i>>)
                             {
-                                throw std::runtime_error(input.GetExceptionPrefix() + "Empty field is mentioned: `" + name + "`.");
+                                throw std::runtime_error(input.GetExceptionPrefix() + "Empty field is mentioned: `" + std::string(name) + "`.");
                             }
                             else
                             {
@@ -617,4 +619,46 @@ namespace Refl
             }
         }();
     };
+
+    template <typename T>
+    struct impl::BulkBinaryRepresentation<T, std::enable_if_t<Class::members_known<T>>>
+    {
+        static constexpr bool value = []{
+            if constexpr (!Refl::Class::members_in_memory_order<T> || !std::is_trivially_copyable_v<T> || Meta::list_size<Refl::Class::combined_bases<T>> > 0)
+            {
+                return false;
+            }
+            else
+            {
+                // The callbacks would be skipped.
+                if (&StructCallbacks<T>::PreSerialize != &DefaultStructCallbacks<T>::PreSerialize || &StructCallbacks<T>::PostSerialize != &DefaultStructCallbacks<T>::PostSerialize ||
+                    &StructCallbacks<T>::PreDeserialize != &DefaultStructCallbacks<T>::PreDeserialize || &StructCallbacks<T>::PostDeserialize != &DefaultStructCallbacks<T>::PostDeserialize)
+                    return false;
+
+                // All members must be bulk-serializable, with no padding between them.
+                bool value = true;
+                std::size_t size = 0;
+                Meta::cexpr_for<Refl::Class::member_count<T>>([&](auto index)
+                {
+                    using type = std::remove_const_t<Refl::Class::member_type<T, index.value>>;
+                    if (!BulkBinaryRepresentation<type>::value)
+                        value = false;
+                    size += sizeof(type);
+                });
+                return value && size == sizeof(T);
+            }
+        }();
+
+        [[nodiscard]] static bool IsValid(const T &object)
+        {
+            bool ret = true;
+            Meta::cexpr_for<Refl::Class::member_count<T>>([&](auto index)
+            {
+                using type = std::remove_const_t<Refl::Class::member_type<T, index.value>>;
+                if (ret && !BulkBinaryRepresentation<type>::IsValid(Refl::Class::Member<index.value>(object)))
+                    ret = false;
+            });
+            return ret;
+        }
+    };
 }
@@ -7,17 +7,17 @@
 
 template <int D, typename T, typename Index> struct MultiArray<D, T, Index>::ReflHelper
 {
-    static auto &GetSizeVec(MultiArray<D, T> &array)
+    static auto &GetSizeVec(MultiArray<D, T, Index> &array)
     {
         return array.size_vec;
     }
 
-    static auto &GetStorage(MultiArray<D, T> &array)
+    static auto &GetStorage(MultiArray<D, T, Index> &array)
     {
         return array.storage;
     }
 
-    static void CheckInvariant(const MultiArray<D, T> &object)
+    static void CheckInvariant(const MultiArray<D, T, Index> &object)
     {
         if ((object.size_vec < 0).any())
             throw std::runtime_error("Multiarray can't have a negative size.");
@@ -29,32 +29,32 @@ template <int D, typename T, typename Index> struct MultiArray<D, T, Index>::Ref
 
 namespace Refl::Class::Custom
 {
-    template <int D, typename T> struct name<MultiArray<D, T>>
+    template <int D, typename T, typename Index> struct name<MultiArray<D, T, Index>>
     {
         static constexpr const char *value = "MultiArray";
     };
-    template <int D, typename T> struct members<MultiArray<D, T>>
+    template <int D, typename T, typename Index> struct members<MultiArray<D, T, Index>>
     {
         static constexpr std::size_t count = 2;
-        template <std::size_t I> static constexpr auto &at(MultiArray<D, T> &object)
+        template <std::size_t I> static constexpr auto &at(MultiArray<D, T, Index> &object)
         {
             if constexpr (I == 0)
-                return MultiArray<D, T>::ReflHelper::GetSizeVec(object);
+                return MultiArray<D, T, Index>::ReflHelper::GetSizeVec(object);
             else
-                return MultiArray<D, T>::ReflHelper::GetStorage(object);
+                return MultiArray<D, T, Index>::ReflHelper::GetStorage(object);
         }
     };
 }
 
-template <int D, typename T>
-struct Refl::StructCallbacks<MultiArray<D, T>> : Refl::DefaultStructCallbacks<MultiArray<D, T>>
+template <int D, typename T, typename Index>
+struct Refl::StructCallbacks<MultiArray<D, T, Index>> : Refl::DefaultStructCallbacks<MultiArray<D, T, Index>>
 {
-    static void PreSerialize(const MultiArray<D, T> &object)
+    static void PreSerialize(const MultiArray<D, T, Index> &object)
     {
-        MultiArray<D, T>::ReflHelper::CheckInvariant(object);
+        MultiArray<D, T, Index>::ReflHelper::CheckInvariant(object);
     }
-    static void PostDeserialize(MultiArray<D, T> &object)
+    static void PostDeserialize(MultiArray<D, T, Index> &object)
     {
-        MultiArray<D, T>::ReflHelper::CheckInvariant(object);
+        MultiArray<D, T, Index>::ReflHelper::CheckInvariant(object);
     }
 };
@@ -4,6 +4,7 @@
 #include <array>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -238,6 +239,12 @@ namespace Refl
                 }
             };
 
+            // Whether the members listed by `members` have increasing addresses.
+            // Together with the absence of padding, this lets the structs be serialized to binary with a single copy.
+            template <typename T, typename Void = void> struct members_in_memory_order : std::false_type {}; // Note that tuples are often stored backwards.
+            template <typename T> struct members_in_memory_order<T, Meta::void_type<Macro::member_ptrs<T>>> : std::true_type {}; // The macros list them in the declaration order.
+            template <typename M, std::size_t N> struct members_in_memory_order<M[N]> : std::true_type {};
+
             namespace impl
             {
                 // Converts a member index to the index of the corresponding `REFL_DECL`.
@@ -318,6 +325,7 @@ namespace Refl
             using member_cvref_t = std::conditional_t<std::is_reference_v<T>, member_cv_t &, member_cv_t &&>;
             return static_cast<member_cvref_t>(ref);
         }
+        template <typename T> inline constexpr bool members_in_memory_order = Custom::members_in_memory_order<std::remove_const_t<T>>::value;
 
         // Member attributes.
         // Returns a `Meta::type_list`.
@@ -431,19 +439,12 @@ namespace Refl
         // Those convert names of members/bases to their indices.
         // If there is no such entry, -1 is returned.
         // If a class has several entries with the same name, using the corresponding function will cause a static assertion.
-        template <typename T> [[nodiscard]] std::size_t MemberIndex               (const char *name) {return Utils::GetStringIndex<impl::StringList_Members<std::remove_const_t<T>>>(name);} // Note that `remove_const_t` is necessary here, but not in the other three functions.
-        template <typename T> [[nodiscard]] std::size_t RegularBaseIndex          (const char *name) {return Utils::GetStringIndex<impl::StringList_Classes<regular_bases           <T>>>(name);}
-        template <typename T> [[nodiscard]] std::size_t VirtualBaseIndex          (const char *name) {return Utils::GetStringIndex<impl::StringList_Classes<virtual_bases           <T>>>(name);}
-        template <typename T> [[nodiscard]] std::size_t CombinedBaseIndex         (const char *name) {return Utils::GetStringIndex<impl::StringList_Classes<combined_bases          <T>>>(name);}
-        template <typename T> [[nodiscard]] std::size_t RecursiveRegularBaseIndex (const char *name) {return Utils::GetStringIndex<impl::StringList_Classes<recursive_regular_bases <T>>>(name);}
-        template <typename T> [[nodiscard]] std::size_t RecursiveCombinedBaseIndex(const char *name) {return Utils::GetStringIndex<impl::StringList_Classes<recursive_combined_bases<T>>>(name);}
-
-        template <typename T> [[nodiscard]] std::size_t MemberIndex               (const std::string &name) {return MemberIndex               <T>(name.c_str());}
-        template <typename T> [[nodiscard]] std::size_t RegularBaseIndex          (const std::string &name) {return RegularBaseIndex          <T>(name.c_str());}
-        template <typename T> [[nodiscard]] std::size_t VirtualBaseIndex          (const std::string &name) {return VirtualBaseIndex          <T>(name.c_str());}
-        template <typename T> [[nodiscard]] std::size_t CombinedBaseIndex         (const std::string &name) {return CombinedBaseIndex         <T>(name.c_str());}
-        template <typename T> [[nodiscard]] std::size_t RecursiveRegularBaseIndex (const std::string &name) {return RecursiveRegularBaseIndex <T>(name.c_str());}
-        template <typename T> [[nodiscard]] std::size_t RecursiveCombinedBaseIndex(const std::string &name) {return RecursiveCombinedBaseIndex<T>(name.c_str());}
+        template <typename T> [[nodiscard]] std::size_t MemberIndex               (std::string_view name) {return Utils::GetStringIndex<impl::StringList_Members<std::remove_const_t<T>>>(name);} // Note that `remove_const_t` is necessary here, but not in the other three functions.
+        template <typename T> [[nodiscard]] std::size_t RegularBaseIndex          (std::string_view name) {return Utils::GetStringIndex<impl::StringList_Classes<regular_bases           <T>>>(name);}
+        template <typename T> [[nodiscard]] std::size_t VirtualBaseIndex          (std::string_view name) {return Utils::GetStringIndex<impl::StringList_Classes<virtual_bases           <T>>>(name);}
+        template <typename T> [[nodiscard]] std::size_t CombinedBaseIndex         (std::string_view name) {return Utils::GetStringIndex<impl::StringList_Classes<combined_bases          <T>>>(name);}
+        template <typename T> [[nodiscard]] std::size_t RecursiveRegularBaseIndex (std::string_view name) {return Utils::GetStringIndex<impl::StringList_Classes<recursive_regular_bases <T>>>(name);}
+        template <typename T> [[nodiscard]] std::size_t RecursiveCombinedBaseIndex(std::string_view name) {return Utils::GetStringIndex<impl::StringList_Classes<recursive_combined_bases<T>>>(name);}
     }
 
     namespace Polymorphic::impl
@@ -22,6 +22,7 @@ namespace Refl::Class::Custom
             return object.template get<I>();
         }
     };
+    template <int D, typename M> struct members_in_memory_order<Math::vec<D, M>> : std::true_type {};
 
     template <int W, int H, typename M> struct name<Math::mat<W, H, M>>
     {
@@ -2,9 +2,15 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "meta/constexpr_hash.h"
 #include "stream/input.h"
 
 namespace Refl::Utils
@@ -89,6 +95,23 @@ namespace Refl::Utils
     }
 
 
+    // Reads an identifier. If the stream is contiguous, returns a view of its memory without copying.
+    // Otherwise copies it to `storage` and returns a view of that.
+    [[nodiscard]] inline std::string_view ExtractIdentifier(Stream::Input &input, std::string &storage)
+    {
+        if (const std::uint8_t *memory = input.ContiguousData())
+        {
+            std::size_t begin = input.Position();
+            input.Discard<Stream::at_least_one>(Stream::Char::SeqIdentifier{});
+            return std::string_view(reinterpret_cast<const char *>(memory) + begin, input.Position() - begin);
+        }
+
+        storage.clear();
+        input.Extract(Stream::Char::SeqIdentifier{}, &storage);
+        return storage;
+    }
+
+
     // Constexpr alternative to `std::strcmp`.
     constexpr int cexpr_strcmp(const char *a, const char *b)
     {
@@ -102,49 +125,142 @@ namespace Refl::Utils
         return (unsigned char)*a - (unsigned char)*b;
     }
 
-    struct NameIndexPair
+    namespace impl
     {
-        const char *name = nullptr;
-        std::size_t index = 0;
+        // A perfect hash table for a fixed list of strings: each string gets its own slot.
+        template <std::size_t Size>
+        struct PerfectHashTable
+        {
+            static_assert(std::has_single_bit(Size));
+            Meta::hash_t seed = 0;
+            std::array<std::uint16_t, Size> slots{}; // String indices, or `-1` for the unused slots.
+        };
 
-        constexpr bool operator==(const NameIndexPair &other) const
+        // Returns true if the strings have no duplicates.
+        template <std::size_t N>
+        constexpr bool StringsAreUnique(std::array<const char *, N> names)
         {
-            return *this <=> other == 0;
+            std::sort(names.begin(), names.end(), [](const char *a, const char *b){return cexpr_strcmp(a, b) < 0;});
+            return std::adjacent_find(names.begin(), names.end(), [](const char *a, const char *b){return cexpr_strcmp(a, b) == 0;}) == names.end();
         }
 
-        constexpr std::weak_ordering operator<=>(const NameIndexPair &other) const
+        // Mixes a string hash with a seed. Different seeds give unrelated slot assignments, without rehashing the string.
+        [[nodiscard]] constexpr Meta::hash_t MixHash(Meta::hash_t hash, Meta::hash_t seed)
         {
-            return *this <=> other.name;
+            // The finalizer from MurmurHash3.
+            hash ^= seed * 0x9e3779b9;
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6b;
+            hash ^= hash >> 13;
+            hash *= 0xc2b2ae35;
+            hash ^= hash >> 16;
+            return hash;
         }
 
-        constexpr std::weak_ordering operator<=>(const char *other_name) const
+        // Finds the smallest table size (a power of two, at least `2 * N`) and a seed that give each of the `names` a different slot.
+        // The names must be unique. Returns size 0 if the table would need more than `16 * N` slots, then a binary search should be used instead.
+        // Random slot assignments stay collision-free only if the table size is roughly `N^2`, so this is mostly useful for short lists.
+        template <std::size_t N>
+        constexpr std::pair<std::size_t, Meta::hash_t> FindPerfectHash(const std::array<const char *, N> &names)
         {
-            return cexpr_strcmp(name, other_name) <=> 0;
+            std::array<Meta::hash_t, N> hashes{};
+            for (std::size_t i = 0; i < N; i++)
+                hashes[i] = Meta::cexpr_hash(std::string_view(names[i]));
+
+            const std::size_t max_size = std::bit_ceil(N) * 16;
+
+            // The slot is used in the current attempt if it's equal to `attempt`, so this doesn't need to be cleared between the attempts.
+            std::vector<std::uint32_t> used(max_size);
+            std::uint32_t attempt = 0;
+
+            for (std::size_t size = std::bit_ceil(N * 2); size <= max_size; size *= 2)
+            {
+                // The probability of a seed working drops quickly with the load factor, so don't try too hard before enlarging the table.
+                for (Meta::hash_t seed = 0; seed < 256; seed++)
+                {
+                    attempt++;
+                    bool ok = true;
+                    for (Meta::hash_t hash : hashes)
+                    {
+                        std::uint32_t &slot = used[MixHash(hash, seed) & (size - 1)];
+                        if (slot == attempt)
+                        {
+                            ok = false;
+                            break;
+                        }
+                        slot = attempt;
+                    }
+                    if (ok)
+                        return {size, seed};
+                }
+            }
+
+            return {0, 0};
         }
-    };
+
+        template <std::size_t Size, std::size_t N>
+        constexpr PerfectHashTable<Size> MakePerfectHashTable(const std::array<const char *, N> &names, Meta::hash_t seed)
+        {
+            static_assert(N < 0xffff, "Too many strings.");
+            PerfectHashTable<Size> ret;
+            ret.seed = seed;
+            ret.slots.fill(0xffff);
+            for (std::size_t i = 0; i < N; i++)
+                ret.slots[MixHash(Meta::cexpr_hash(std::string_view(names[i])), seed) & (Size - 1)] = std::uint16_t(i);
+            return ret;
+        }
+    }
 
     // An universal function to look up strings in immutable lists.
     // `F` is a pointer to a constexpr function that returns an array of names: `std::array<const char *, N> (*)(auto index)`.
     // `name` is a name that we're looking for. If it's not found, -1 is returned.
     // Avoid using lambdas as `F`. If you do that in a header, you will most likely get an ODR violation.
-    template <auto F> std::size_t GetStringIndex(const char *name)
+    // Short lists use a perfect hash built at compile-time, so the lookup costs one hash and one string comparison. Long lists use a binary search.
+    template <auto F> std::size_t GetStringIndex(std::string_view name)
     {
-        static constexpr auto array = []
+        static constexpr auto names = F();
+        static_assert(impl::StringsAreUnique(names), "Duplicate string in a static list.");
+
+        if constexpr (names.size() == 0)
+        {
+            (void)name;
+            return -1;
+        }
+        else
         {
-            auto name_array = F();
-            std::array<NameIndexPair, name_array.size()> array{};
-            for (std::size_t i = 0; i < array.size(); i++)
+            static constexpr auto hash_params = impl::FindPerfectHash(names);
+
+            if constexpr (hash_params.first != 0)
             {
-                array[i].name = name_array[i];
-                array[i].index = i;
+                static constexpr auto table = impl::MakePerfectHashTable<hash_params.first>(names, hash_params.second);
+                static constexpr auto name_views = []
+                {
+                    std::array<std::string_view, names.size()> ret;
+                    std::copy(names.begin(), names.end(), ret.begin());
+                    return ret;
+                }();
+
+                std::uint16_t index = table.slots[impl::MixHash(Meta::cexpr_hash(name), table.seed) & (table.slots.size() - 1)];
+                if (index == 0xffff || name_views[index] != name)
+                    return -1;
+                return index;
             }
-            std::sort(array.begin(), array.end());
-            return array;
-        }();
-        static_assert(std::adjacent_find(array.begin(), array.end()) == array.end(), "Duplicate string in a static list.");
-        auto it = std::lower_bound(array.begin(), array.end(), name);
-        if (it == array.end() || *it != NameIndexPair{name, 0})
-            return -1;
-        return it->index;
+            else
+            {
+                static constexpr auto sorted = []
+                {
+                    std::array<std::pair<std::string_view, std::size_t>, names.size()> ret;
+                    for (std::size_t i = 0; i < names.size(); i++)
+                        ret[i] = {names[i], i};
+                    std::sort(ret.begin(), ret.end());
+                    return ret;
+                }();
+
+                auto it = std::lower_bound(sorted.begin(), sorted.end(), name, [](const auto &a, std::string_view b){return a.first < b;});
+                if (it == sorted.end() || it->first != name)
+                    return -1;
+                return it->second;
+            }
+        }
     }
 }
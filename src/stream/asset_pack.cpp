@@ -0,0 +1,305 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "macros/finally.h"
+#include "stream/better_fopen.h"
+#include "stream/input.h"
+#include "stream/output.h"
+#include "utils/filesystem.h"
+#include "utils/hash.h"
+
+namespace Stream
+{
+    static constexpr char pack_magic[4] = {'I', 'M', 'P', 'K'};
+    static constexpr std::uint32_t pack_version = 1;
+
+    // FNV-1a. Unlike `std::hash`, this is the same on all platforms.
+    [[nodiscard]] static std::uint64_t HashName(std::string_view name)
+    {
+        std::uint64_t ret = 0xcbf29ce484222325;
+        for (char ch : name)
+        {
+            ret ^= std::uint8_t(ch);
+            ret *= 0x100000001b3;
+        }
+        return ret;
+    }
+
+    // Hashes the size and the modification time of a file on disk. Returns null if it doesn't exist.
+    [[nodiscard]] static std::optional<std::uint64_t> DiskFileStamp(const std::string &file_name)
+    {
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::file_size(file_name, error);
+        if (error)
+            return {};
+        auto time = std::filesystem::last_write_time(file_name, error);
+        if (error)
+            return {};
+        return Hash::Combine(std::size_t(size), std::size_t(time.time_since_epoch().count()));
+    }
+
+    struct MountedPack
+    {
+        std::string prefix;
+        AssetPack pack;
+        std::uint64_t stamp = 0; // The stamp of the pack file, see `FileStamp()`.
+    };
+
+    [[nodiscard]] static std::vector<MountedPack> &GetMountedPacks()
+    {
+        static std::vector<MountedPack> ret;
+        return ret;
+    }
+
+    AssetPack::AssetPack(ReadOnlyData new_data)
+    {
+        Input input(new_data);
+
+        try
+        {
+            char magic[sizeof pack_magic];
+            input.Read(magic, sizeof magic);
+            if (!std::equal(magic, magic + sizeof magic, pack_magic))
+                throw std::runtime_error("This is not an asset pack.");
+            if (auto version = input.ReadLittle<std::uint32_t>(); version != pack_version)
+                throw std::runtime_error(FMT("The asset pack has version {}, but expected {}. Repack the assets.", version, pack_version));
+
+            std::uint32_t num_entries = input.ReadLittle<std::uint32_t>();
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> name_ranges;
+            for (std::uint32_t i = 0; i < num_entries; i++)
+            {
+                Entry &entry = entries.emplace_back();
+                entry.hash = input.ReadLittle<std::uint64_t>();
+                auto &[name_offset, name_size] = name_ranges.emplace_back();
+                name_offset = input.ReadLittle<std::uint32_t>();
+                name_size = input.ReadLittle<std::uint32_t>();
+                entry.offset = input.ReadLittle<std::uint64_t>();
+                entry.stored_size = input.ReadLittle<std::uint64_t>();
+                entry.size = input.ReadLittle<std::uint64_t>();
+                entry.codec = input.ReadLittle<std::uint8_t>();
+
+                if (entry.offset > new_data.size() || entry.stored_size > new_data.size() - entry.offset)
+                    throw std::runtime_error(FMT("The data of entry #{} is out of bounds.", i));
+                if (entry.codec != stored_codec && entry.codec > std::uint8_t(Archive::Codec::zstd))
+                    throw std::runtime_error(FMT("Unknown compression codec of entry #{}: {}.", i, int(entry.codec)));
+                if (entry.codec == stored_codec && entry.stored_size != entry.size)
+                    throw std::runtime_error(FMT("The sizes of uncompressed entry #{} don't match.", i));
+            }
+
+            std::size_t names_offset = input.Position();
+            for (std::uint32_t i = 0; i < num_entries; i++)
+            {
+                auto [name_offset, name_size] = name_ranges[i];
+                if (name_offset > new_data.size() - names_offset || name_size > new_data.size() - names_offset - name_offset)
+                    throw std::runtime_error(FMT("The name of entry #{} is out of bounds.", i));
+                entries[i].name = std::string_view(new_data.data_char() + names_offset + name_offset, name_size);
+                if (HashName(entries[i].name) != entries[i].hash)
+                    throw std::runtime_error(FMT("The hash of entry #{} (`{}`) is wrong.", i, entries[i].name));
+            }
+
+            if (!std::is_sorted(entries.begin(), entries.end(), [](const Entry &a, const Entry &b){return a.hash < b.hash;}))
+                throw std::runtime_error("The index isn't sorted.");
+        }
+        catch (std::exception &e)
+        {
+            throw std::runtime_error(FMT("{}{}", input.GetExceptionPrefix(), e.what()));
+        }
+
+        data = std::move(new_data);
+    }
+
+    const AssetPack::Entry *AssetPack::FindEntry(std::string_view name) const
+    {
+        std::uint64_t hash = HashName(name);
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const Entry &entry, std::uint64_t hash){return entry.hash < hash;});
+        for (; it != entries.end() && it->hash == hash; ++it)
+        {
+            if (it->name == name)
+                return &*it;
+        }
+        return nullptr;
+    }
+
+    std::optional<ReadOnlyData> AssetPack::ReadEntry(std::string_view name, std::string result_name) const
+    {
+        const Entry *entry = FindEntry(name);
+        if (!entry)
+            return {};
+
+        if (entry->codec == stored_codec)
+            return data.subrange(entry->offset, entry->size, std::move(result_name));
+
+        return ReadOnlyData::copy_from_function(std::move(result_name), entry->size, [&](std::uint8_t *dst)
+        {
+            const std::uint8_t *src = data.data() + entry->offset;
+            try
+            {
+                Archive::Uncompress(Archive::Codec(entry->codec), src, src + entry->stored_size, dst, dst + entry->size);
+            }
+            catch (std::exception &e)
+            {
+                throw std::runtime_error(FMT("Unable to read `{}` from asset pack `{}`: {}", name, data.name(), e.what()));
+            }
+        });
+    }
+
+    void AssetPack::Create(std::string dir, const std::string &file_name, Archive::Codec codec)
+    {
+        while (dir.ends_with('/'))
+            dir.pop_back();
+
+        struct NewEntry
+        {
+            Entry entry;
+            std::string name;
+            std::vector<std::uint8_t> stored_data;
+        };
+        std::vector<NewEntry> new_entries;
+
+        // Like when copying the assets, ignore the files starting with `_`.
+        Filesystem::ForEachObject(Filesystem::GetObjectTree(dir, -1), [&](const Filesystem::TreeNode &node)
+        {
+            if (node.info.category != Filesystem::file || node.name.starts_with('_') || node.name.starts_with('.'))
+                return;
+
+            NewEntry &new_entry = new_entries.emplace_back();
+            new_entry.name = node.path.substr(dir.size() + 1);
+            new_entry.entry.hash = HashName(new_entry.name);
+
+            // Bypass the mounted packs, they could have stale copies of those files.
+            FILE *file = better_fopen(node.path.c_str(), "rb");
+            if (!file)
+                throw std::runtime_error(FMT("Unable to open `{}` for reading.", node.path));
+            FINALLY{std::fclose(file);};
+            Input input(node.path, file);
+            new_entry.entry.size = input.Size();
+            std::vector<std::uint8_t> file_data(input.Size());
+            input.Read(file_data.data(), file_data.size());
+
+            std::vector<std::uint8_t> compressed(Archive::MaxCompressedSize(codec, file_data.size()));
+            compressed.resize(Archive::Compress(codec, file_data.data(), file_data.data() + file_data.size(), compressed.data(), compressed.data() + compressed.size()) - compressed.data());
+            if (compressed.size() <= file_data.size() - file_data.size() / 8)
+            {
+                new_entry.entry.codec = std::uint8_t(codec);
+                new_entry.stored_data = std::move(compressed);
+            }
+            else
+            {
+                new_entry.entry.codec = stored_codec;
+                new_entry.stored_data = std::move(file_data);
+            }
+            new_entry.entry.stored_size = new_entry.stored_data.size();
+        });
+
+        std::sort(new_entries.begin(), new_entries.end(), [](const NewEntry &a, const NewEntry &b){return a.entry.hash < b.entry.hash;});
+
+        constexpr std::size_t header_size = sizeof pack_magic + 4 + 4, entry_size = 8 + 4 + 4 + 8 + 8 + 8 + 1;
+        std::size_t names_size = 0;
+        for (const NewEntry &new_entry : new_entries)
+            names_size += new_entry.name.size();
+        std::size_t data_offset = header_size + entry_size * new_entries.size() + names_size;
+
+        Output output(file_name);
+        output.WriteString(pack_magic, sizeof pack_magic);
+        output.WriteLittle<std::uint32_t>(pack_version);
+        output.WriteLittle<std::uint32_t>(std::uint32_t(new_entries.size()));
+
+        std::size_t name_offset = 0;
+        for (const NewEntry &new_entry : new_entries)
+        {
+            output.WriteLittle<std::uint64_t>(new_entry.entry.hash);
+            output.WriteLittle<std::uint32_t>(std::uint32_t(name_offset));
+            output.WriteLittle<std::uint32_t>(std::uint32_t(new_entry.name.size()));
+            output.WriteLittle<std::uint64_t>(data_offset);
+            output.WriteLittle<std::uint64_t>(new_entry.entry.stored_size);
+            output.WriteLittle<std::uint64_t>(new_entry.entry.size);
+            output.WriteLittle<std::uint8_t>(new_entry.entry.codec);
+
+            name_offset += new_entry.name.size();
+            data_offset += new_entry.entry.stored_size;
+        }
+
+        for (const NewEntry &new_entry : new_entries)
+            output.WriteString(new_entry.name);
+        for (const NewEntry &new_entry : new_entries)
+            output.WriteBytes(new_entry.stored_data.data(), new_entry.stored_data.size());
+
+        output.Flush();
+    }
+
+    void AssetPack::Mount(std::string prefix, AssetPack pack)
+    {
+        if (!pack)
+            throw std::runtime_error("Attempt to mount a null asset pack.");
+        // Packs that aren't loaded from files are identified by their size.
+        std::uint64_t stamp = DiskFileStamp(pack.Name()).value_or(pack.data.size());
+        GetMountedPacks().push_back({std::move(prefix), std::move(pack), stamp});
+    }
+
+    bool AssetPack::MountIfExists(std::string prefix, const std::string &file_name)
+    {
+        bool exists = true;
+        (void)Filesystem::GetObjectInfo(file_name, &exists);
+        if (!exists)
+            return false;
+
+        Mount(std::move(prefix), ReadOnlyData::file_mapped(file_name));
+        return true;
+    }
+
+    void AssetPack::UnmountAll()
+    {
+        GetMountedPacks().clear();
+    }
+
+    std::optional<ReadOnlyData> AssetPack::FindMounted(const std::string &file_name)
+    {
+        for (const MountedPack &mounted : GetMountedPacks())
+        {
+            if (!file_name.starts_with(mounted.prefix))
+                continue;
+            if (std::optional<ReadOnlyData> ret = mounted.pack.ReadEntry(std::string_view(file_name).substr(mounted.prefix.size()), file_name))
+            {
+                GetCounters().pack_reads++;
+                return ret;
+            }
+        }
+        return {};
+    }
+
+    bool AssetPack::FileExists(const std::string &file_name)
+    {
+        for (const MountedPack &mounted : GetMountedPacks())
+        {
+            if (file_name.starts_with(mounted.prefix) && mounted.pack.FindEntry(std::string_view(file_name).substr(mounted.prefix.size())))
+                return true;
+        }
+
+        bool exists = true;
+        (void)Filesystem::GetObjectInfo(file_name, &exists);
+        return exists;
+    }
+
+    std::optional<std::uint64_t> AssetPack::FileStamp(const std::string &file_name)
+    {
+        for (const MountedPack &mounted : GetMountedPacks())
+        {
+            if (!file_name.starts_with(mounted.prefix))
+                continue;
+            if (const Entry *entry = mounted.pack.FindEntry(std::string_view(file_name).substr(mounted.prefix.size())))
+                return Hash::Combine({std::size_t(mounted.stamp), entry->offset, entry->stored_size, entry->size});
+        }
+
+        return DiskFileStamp(file_name);
+    }
+
+    AssetPack::Counters &AssetPack::GetCounters()
+    {
+        static Counters ret;
+        return ret;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stream/readonly_data.h"
+#include "utils/archive.h"
+
+namespace Stream
+{
+    // A single file containing many assets, with a hashed index. Each entry is compressed separately, or stored as is if compression doesn't help.
+    // The format is: "IMPK", the version (4 bytes), the number of entries (4 bytes), the entries sorted by the name hash, the names, then the data.
+    // Each entry is: the name hash (8 bytes), the name offset and size relative to the beginning of the names (4 bytes each),
+    // the data offset from the beginning of the file (8 bytes), the stored size and the uncompressed size (8 bytes each), the codec (1 byte, `stored_codec` if uncompressed).
+    // The numbers are little-endian.
+    //
+    // A pack can be mounted at a path prefix. Then `ReadOnlyData::file()`, `ReadOnlyData::file_mapped()` and `Input` (when constructed from a file name)
+    // read the files with this prefix from the pack, and fall back to the disk for the files that aren't in it.
+    // Mounting isn't thread-safe, do it before starting any threads that load files.
+    class AssetPack
+    {
+      public:
+        static constexpr std::uint8_t stored_codec = 0xff;
+
+        struct Entry
+        {
+            std::uint64_t hash = 0;
+            std::string_view name; // Points into the pack data.
+            std::size_t offset = 0;
+            std::size_t stored_size = 0;
+            std::size_t size = 0; // Uncompressed.
+            std::uint8_t codec = stored_codec; // Either `stored_codec` or an `Archive::Codec`.
+        };
+
+        // The number of files opened since the program start. Those are incremented by `ReadOnlyData` and `Input`.
+        struct Counters
+        {
+            std::size_t pack_reads = 0; // Files read from the mounted packs.
+            std::size_t disk_reads = 0; // Files opened by name, including the packs themselves.
+        };
+
+      private:
+        ReadOnlyData data;
+        std::vector<Entry> entries; // Sorted by hash.
+
+      public:
+        AssetPack() {}
+
+        // Reads the index. Throws if this isn't a valid pack. The entries are read lazily.
+        AssetPack(ReadOnlyData new_data);
+
+        [[nodiscard]] explicit operator bool() const
+        {
+            return bool(data);
+        }
+
+        [[nodiscard]] std::string Name() const
+        {
+            return data.name();
+        }
+
+        [[nodiscard]] const std::vector<Entry> &GetEntries() const
+        {
+            return entries;
+        }
+
+        // Returns null if there's no such entry. The names are relative to the packed directory, with `/` as the separator.
+        [[nodiscard]] const Entry *FindEntry(std::string_view name) const;
+
+        // Returns the entry contents, or nothing if there's no such entry.
+        // If the entry isn't compressed, the result references the pack data without copying and isn't null-terminated.
+        // Otherwise it's uncompressed into a new null-terminated buffer. `result_name` becomes the name of the result.
+        [[nodiscard]] std::optional<ReadOnlyData> ReadEntry(std::string_view name, std::string result_name) const;
+
+        // Packs all files in `dir` recursively, and writes the pack to `file_name`.
+        // The entries are compressed with `codec` if that saves at least 1/8 of their size.
+        static void Create(std::string dir, const std::string &file_name, Archive::Codec codec = Archive::fast_codec);
+
+        // Mounts `pack` at `prefix`, which is normally a directory with a trailing slash.
+        static void Mount(std::string prefix, AssetPack pack);
+        // Same, but does nothing and returns false if the file doesn't exist. The file is memory-mapped.
+        static bool MountIfExists(std::string prefix, const std::string &file_name);
+        static void UnmountAll();
+
+        // If the file is in a mounted pack, returns its contents, see `ReadEntry()`.
+        [[nodiscard]] static std::optional<ReadOnlyData> FindMounted(const std::string &file_name);
+        // Checks the mounted packs, then the disk. Use this instead of probing the filesystem for assets.
+        [[nodiscard]] static bool FileExists(const std::string &file_name);
+        // Returns a number that changes when the file changes, without reading the file. Returns null if the file doesn't exist.
+        // For the files on disk, it's computed from the size and the modification time. For the files in the mounted packs, from the pack file and the entry location.
+        [[nodiscard]] static std::optional<std::uint64_t> FileStamp(const std::string &file_name);
+
+        [[nodiscard]] static Counters &GetCounters();
+    };
+}
@@ -15,6 +15,7 @@
 
 #include "meta/common.h"
 #include "program/errors.h"
+#include "stream/asset_pack.h"
 #include "stream/better_fopen.h"
 #include "stream/readonly_data.h"
 #include "stream/utils.h"
@@ -244,6 +245,7 @@ namespace Stream
             std::string name;
 
             ReadOnlyData readonly_data_storage; // Optional. Set if the stream is based on a ReadOnlyData.
+            const std::uint8_t *memory = nullptr; // Set together with `readonly_data_storage`. Then the reads bypass the buffers and access this directly.
         };
         Data data;
 
@@ -388,6 +390,7 @@ namespace Stream
             data.buffer_capacity = std::numeric_limits<std::size_t>::max() / 2 + 1;
             data.buffer_a.position = 0;
             data.buffer_a.storage = const_cast<std::uint8_t *>(source.data()); // Since our functor is a null, this is safe.
+            data.memory = source.data();
 
             data.readonly_data_storage = std::move(source);
         }
@@ -419,8 +422,15 @@ namespace Stream
         }
 
         // Attaches the stream to a file.
+        // If the file is in a mounted `AssetPack`, reads it from there instead.
         Input(std::string file_name, capacity_t buffer_capacity = default_capacity)
         {
+            if (std::optional<ReadOnlyData> packed = AssetPack::FindMounted(file_name))
+            {
+                *this = Input(std::move(*packed));
+                return;
+            }
+
             auto deleter = [](FILE *file)
             {
                 // We don't check for errors here, since there is nothing we could do.
@@ -431,6 +441,7 @@ namespace Stream
             std::unique_ptr<FILE, decltype(deleter)> handle(better_fopen(file_name.c_str(), "rb"));
             if (!handle)
                 throw std::runtime_error(FMT("Unable to open `{}` for reading.", file_name));
+            AssetPack::GetCounters().disk_reads++;
 
             // This function can fail, but it doesn't report errors in any way.
             // Even if it did, we would still ignore it.
@@ -629,6 +640,13 @@ namespace Stream
             return readonly_data;
         }
 
+        // If the stream was created from a `ReadOnlyData` (or after `CacheToMemory()`), returns a pointer to the whole contents, `Size()` bytes long.
+        // Otherwise returns null. Parsers can read from `ContiguousData() + Position()` directly, and then `Skip()` the consumed bytes.
+        [[nodiscard]] const std::uint8_t *ContiguousData() const
+        {
+            return data.memory;
+        }
+
         // File size. This should always be representable as `ptrdiff_t`.
         [[nodiscard]] std::size_t Size() const
         {
@@ -683,6 +701,8 @@ namespace Stream
         [[nodiscard]] std::uint8_t PeekByte()
         {
             ThrowIfNoData(1);
+            if (data.memory)
+                return data.memory[data.position];
             return NeedSegment(PositionToSegmentOffset(data.position)).ReadByte(data.position);
         }
         [[nodiscard]] char PeekChar()
@@ -753,6 +773,13 @@ namespace Stream
                 return;
             ThrowIfNoData(size);
 
+            if (data.memory)
+            {
+                std::copy_n(data.memory + data.position, size, buffer);
+                data.position += size;
+                return;
+            }
+
             std::size_t first_segment = PositionToSegmentOffset(data.position);
             std::size_t last_segment = PositionToSegmentOffset(data.position + size - 1);
 
@@ -769,7 +796,8 @@ namespace Stream
                 std::size_t first_size = second_segment - data.position;
                 NeedSegment(first_segment).Read(data.position, first_size, buffer);
 
-                data.read(*this, second_segment, last_segment - second_segment, buffer + first_size);
+                if (last_segment != second_segment) // File readers don't like zero-sized reads.
+                    data.read(*this, second_segment, last_segment - second_segment, buffer + first_size);
 
                 std::size_t last_size = data.position + size - last_segment;
                 NeedSegment(last_segment).Read(last_segment, last_size, buffer + size - last_size);
@@ -855,20 +883,50 @@ namespace Stream
 
             std::size_t count = 0;
 
-            do
+            if (data.memory)
             {
-                if (!MoreData())
-                    break;
-                std::uint8_t byte = PeekByte();
-                if (!category(byte))
-                    break;
-                SkipOne();
+                // Scan the memory directly, then append everything at once.
+                const std::uint8_t *begin = data.memory + data.position, *end = data.memory + data.size, *cur = begin;
+                if constexpr (several)
+                {
+                    while (cur != end && category(*cur))
+                        cur++;
+                }
+                else
+                {
+                    if (cur != end && category(*cur))
+                        cur++;
+                }
+
                 if constexpr (!std::is_null_pointer_v<T>)
+                {
                     if (append_to)
-                        append_to->push_back(byte);
-                count++;
+                    {
+                        for (const std::uint8_t *ptr = begin; ptr != cur; ptr++)
+                            append_to->push_back(*ptr);
+                    }
+                }
+
+                count = cur - begin;
+                data.position += count;
+            }
+            else
+            {
+                do
+                {
+                    if (!MoreData())
+                        break;
+                    std::uint8_t byte = PeekByte();
+                    if (!category(byte))
+                        break;
+                    SkipOne();
+                    if constexpr (!std::is_null_pointer_v<T>)
+                        if (append_to)
+                            append_to->push_back(byte);
+                    count++;
+                }
+                while (several);
             }
-            while (several);
 
             if (throw_if_none && count == 0)
                 throw std::runtime_error(GetExceptionPrefix() + "Expected " + category.name() + ".");
@@ -939,23 +997,40 @@ namespace Stream
         requires (mode == one) || (mode == if_present)
         bool DiscardBytes(const std::uint8_t *bytes, std::size_t count)
         {
-            auto pos = Position();
-            for (std::size_t i = 0; i < count; i++)
+            bool ok = true;
+            if (data.memory)
             {
-                if (!MoreData() || PeekByte() != bytes[i])
+                // Compare everything at once.
+                ok = RemainingBytes() >= count && std::equal(bytes, bytes + count, data.memory + data.position);
+                if (ok)
+                    data.position += count;
+            }
+            else
+            {
+                auto pos = Position();
+                for (std::size_t i = 0; i < count; i++)
                 {
-                    Seek(pos, absolute);
-                    if constexpr (mode == one)
+                    if (!MoreData() || PeekByte() != bytes[i])
                     {
-                        // If the amount of characters is small, include them in the exception message.
-                        if (count <= 16)
-                            throw std::runtime_error(GetExceptionPrefix() + "Expected \"" + Strings::Escape(std::string_view(reinterpret_cast<const char *>(bytes), count)) + "\".");
-                        else
-                            throw std::runtime_error(GetExceptionPrefix() + "Unexpected sequence of bytes.");
+                        Seek(pos, absolute);
+                        ok = false;
+                        break;
                     }
-                    return false;
+                    SkipOne();
                 }
-                SkipOne();
+            }
+
+            if (!ok)
+            {
+                if constexpr (mode == one)
+                {
+                    // If the amount of characters is small, include them in the exception message.
+                    if (count <= 16)
+                        throw std::runtime_error(GetExceptionPrefix() + "Expected \"" + Strings::Escape(std::string_view(reinterpret_cast<const char *>(bytes), count)) + "\".");
+                    else
+                        throw std::runtime_error(GetExceptionPrefix() + "Unexpected sequence of bytes.");
+                }
+                return false;
             }
             return true;
         }
@@ -0,0 +1,163 @@
+#include "output.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Stream
+{
+    struct Output::AsyncState
+    {
+        Output target;
+
+        std::mutex mutex;
+        std::condition_variable cond_var;
+
+        // There are two buffers. One is always in `Output::Data::buffer`, the other one is in one of the following places.
+        std::unique_ptr<std::uint8_t[]> pending_buffer; // Waiting for the writer thread.
+        std::size_t pending_size = 0;
+        std::unique_ptr<std::uint8_t[]> free_buffer; // Already written, the producer can take it. If null, the writer is busy.
+
+        std::exception_ptr exception; // Set if `target` threw.
+        bool stop = false;
+
+        AsyncCounters counters;
+
+        std::thread thread;
+
+        AsyncState(Output new_target, std::size_t capacity)
+            : target(std::move(new_target)), free_buffer(std::make_unique<std::uint8_t[]>(capacity))
+        {
+            thread = std::thread([this]{WriterThread();});
+        }
+
+        ~AsyncState()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stop = true;
+            }
+            cond_var.notify_all();
+            thread.join();
+        }
+
+        void WriterThread()
+        {
+            while (true)
+            {
+                std::unique_ptr<std::uint8_t[]> buffer;
+                std::size_t size = 0;
+                bool failed = false;
+
+                {
+                    std::unique_lock lock(mutex);
+                    cond_var.wait(lock, [&]{return pending_buffer || stop;});
+                    if (!pending_buffer)
+                        return;
+                    buffer = std::move(pending_buffer);
+                    size = pending_size;
+                    failed = bool(exception);
+                }
+
+                std::exception_ptr new_exception;
+                if (!failed)
+                {
+                    try
+                    {
+                        // Flushing here makes `target` report the errors as soon as possible.
+                        target.WriteBytes(buffer.get(), size);
+                        target.Flush();
+                    }
+                    catch (...)
+                    {
+                        new_exception = std::current_exception();
+                        target.data.buffer_pos = 0; // Discard the data, so that `target` doesn't try to write it again.
+                    }
+                }
+
+                {
+                    std::lock_guard lock(mutex);
+                    free_buffer = std::move(buffer);
+                    if (new_exception)
+                        exception = new_exception;
+                    else if (!failed)
+                        counters.buffers_written++;
+                }
+                cond_var.notify_all();
+            }
+        }
+    };
+
+    Output Output::Async(Output target, capacity_t capacity)
+    {
+        if (!target)
+            throw std::runtime_error("Attempt to create an async output stream for a null stream.");
+
+        std::string name = target.GetTarget();
+        Output ret(std::move(name), nullptr, capacity);
+        ret.data.async = std::make_shared<AsyncState>(std::move(target), std::size_t(capacity));
+        return ret;
+    }
+
+    Output::AsyncCounters Output::GetAsyncCounters() const
+    {
+        if (!data.async)
+            return {};
+
+        std::lock_guard lock(data.async->mutex);
+        return data.async->counters;
+    }
+
+    void Output::SubmitAsyncBuffer()
+    {
+        if (data.buffer_pos == 0)
+            return;
+
+        AsyncState &state = *data.async;
+
+        std::unique_lock lock(state.mutex);
+
+        if (!state.free_buffer)
+        {
+            auto start = std::chrono::steady_clock::now();
+            state.cond_var.wait(lock, [&]{return bool(state.free_buffer);});
+            state.counters.stalls++;
+            state.counters.stall_time += std::chrono::steady_clock::now() - start;
+        }
+
+        if (state.exception)
+        {
+            data.buffer_pos = 0; // Discard the data, it would never be written anyway.
+            std::rethrow_exception(state.exception);
+        }
+
+        state.pending_buffer = std::exchange(data.buffer, std::move(state.free_buffer));
+        state.pending_size = std::exchange(data.buffer_pos, 0);
+
+        lock.unlock();
+        state.cond_var.notify_all();
+    }
+
+    void Output::FlushAsync()
+    {
+        AsyncState &state = *data.async;
+
+        auto WaitForWriter = [&]
+        {
+            std::unique_lock lock(state.mutex);
+            state.cond_var.wait(lock, [&]{return bool(state.free_buffer);});
+            if (state.exception)
+            {
+                data.buffer_pos = 0; // Discard the data, it would never be written anyway.
+                std::rethrow_exception(state.exception);
+            }
+            return lock;
+        };
+
+        // Wait before submitting, so that it's not counted as a stall.
+        WaitForWriter().unlock();
+        SubmitAsyncBuffer();
+        WaitForWriter(); // The writer thread flushes `target` after each buffer.
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -36,7 +37,17 @@ namespace Stream
         // Will never be copied. If your functor is non-copyable, consider using `Meta::fake_copyable`.
         using flush_func_t = std::function<void(Output &, const std::uint8_t *, std::size_t)>;
 
+        // See `Async()`.
+        struct AsyncCounters
+        {
+            std::size_t buffers_written = 0;
+            std::size_t stalls = 0; // How many times a full buffer had to wait for the writer thread. Waiting in `Flush()` isn't counted.
+            std::chrono::nanoseconds stall_time{}; // The total time spent in those stalls.
+        };
+
       private:
+        struct AsyncState; // Defined in `output.cpp`.
+
         struct Data
         {
             std::unique_ptr<std::uint8_t[]> buffer;
@@ -47,13 +58,26 @@ namespace Stream
             std::optional<ExceptionPrefixStyle> exception_prefix_style;
 
             std::string name;
+
+            std::shared_ptr<AsyncState> async; // Set if the stream was created with `Async()`. Then `flush` is unused.
         };
         Data data;
 
+        // Hands the full buffer to the writer thread, and takes the other buffer, waiting for it if necessary.
+        // Only for async streams. Rethrows the exceptions from the writer thread.
+        void SubmitAsyncBuffer();
+        // Submits the buffer and waits until everything is written.
+        void FlushAsync();
+
         void NeedBufferSpace()
         {
             if (data.buffer_pos == data.buffer_capacity)
-                Flush();
+            {
+                if (data.async)
+                    SubmitAsyncBuffer();
+                else
+                    Flush();
+            }
         }
 
       public:
@@ -117,6 +141,13 @@ namespace Stream
                 capacity);
         }
 
+        // Constructs a stream that writes to `target` on a background thread, which owns `target` from now on.
+        // There are two buffers of size `capacity`: while one of them is being written by the thread, the other one is filled.
+        // If both are full, the writes wait for the thread (see `GetAsyncCounters()` for the time spent waiting).
+        // The thread flushes `target` after each buffer, and `Flush()` waits for the thread to finish. The exceptions thrown by `target` are rethrown
+        // by the next write that needs a new buffer, or by `Flush()`. After that, everything written to the stream is discarded.
+        [[nodiscard]] static Output Async(Output target, capacity_t capacity = capacity_t(1 << 16));
+
         // Constructs a stream bound to a C file handle.
         // The stream doesn't own the handle.
         [[nodiscard]] static Output FileHandle(FILE *handle, capacity_t capacity = default_capacity)
@@ -159,6 +190,14 @@ namespace Stream
             return data.name;
         }
 
+        // Whether this stream was created with `Async()`.
+        [[nodiscard]] bool IsAsync() const
+        {
+            return bool(data.async);
+        }
+        // Returns zeros if the stream is not async.
+        [[nodiscard]] AsyncCounters GetAsyncCounters() const;
+
         // Does nothing if a style is already selected of if the parameter is null. Unless `force` is true.
         Output &WantExceptionPrefixStyle(std::optional<ExceptionPrefixStyle> style, bool force = false)
         {
@@ -203,6 +242,12 @@ namespace Stream
         // in a release build it's flushed automatically, ignoring any possible exceptions.
         void Flush()
         {
+            if (data.async)
+            {
+                FlushAsync();
+                return;
+            }
+
             if (data.buffer_pos > 0)
             {
                 data.flush(*this, data.buffer.get(), data.buffer_pos);
@@ -262,6 +307,21 @@ namespace Stream
             if (size == 0)
                 return *this;
 
+            // The writer thread can't read from `ptr` after we return, so copy everything to the buffers.
+            if (data.async)
+            {
+                while (size > 0)
+                {
+                    SubmitAsyncBuffer();
+                    segment_size = std::min(data.buffer_capacity, size);
+                    std::copy_n(ptr, segment_size, data.buffer.get());
+                    data.buffer_pos = segment_size;
+                    ptr += segment_size;
+                    size -= segment_size;
+                }
+                return *this;
+            }
+
             Flush();
 
             // If the remaining data fits in the buffer, put it there and stop.
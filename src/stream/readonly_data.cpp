@@ -0,0 +1,92 @@
+#include "readonly_data.h"
+
+#include <stdexcept>
+
+#include "stream/asset_pack.h"
+
+#if IMP_PLATFORM_IS(linux)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Stream
+{
+    ReadOnlyData ReadOnlyData::file(std::string file_name)
+    {
+        // The packed files are not null-terminated unless they are compressed, so this copies the rest.
+        if (std::optional<ReadOnlyData> packed = AssetPack::FindMounted(file_name))
+            return packed->null_terminate();
+
+        ReadOnlyData ret;
+        ret.ref = std::make_shared<Data>();
+
+        FILE *file = better_fopen(file_name.c_str(), "rb");
+        if (!file)
+            throw std::runtime_error(FMT("Unable to open file `{}`.", file_name));
+        FINALLY{std::fclose(file);};
+        AssetPack::GetCounters().disk_reads++;
+
+        std::setbuf(file, 0); // This can fail, but we don't care about it.
+
+        std::fseek(file, 0, SEEK_END);
+        auto size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+
+        if (std::ferror(file) || size == EOF)
+            throw std::runtime_error(FMT("Unable to get size of file `{}`.", file_name));
+
+        ret.ref->storage = std::make_unique<std::uint8_t[]>(size+1); // 1 extra byte for the null-terminator.
+        if (size > 0 && !std::fread(ret.ref->storage.get(), size, 1, file))
+            throw std::runtime_error(FMT("Unable to read from file `{}`.", file_name));
+        ret.ref->storage[size] = '\0';
+
+        ret.ref->begin = ret.ref->storage.get();
+        ret.ref->end = ret.ref->begin + size;
+        ret.ref->extra_null_terminator = true;
+        ret.ref->name = std::move(file_name);
+
+        return ret;
+    }
+
+    ReadOnlyData ReadOnlyData::file_mapped(std::string file_name, std::size_t min_size)
+    {
+        if (std::optional<ReadOnlyData> packed = AssetPack::FindMounted(file_name))
+            return std::move(*packed);
+
+        #if IMP_PLATFORM_IS(linux)
+        int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw std::runtime_error(FMT("Unable to open file `{}`.", file_name));
+        FINALLY{close(fd);}; // The mapping remains valid after this.
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+            throw std::runtime_error(FMT("Unable to get size of file `{}`.", file_name));
+        std::size_t size = info.st_size;
+
+        // Empty files can't be mapped.
+        if (size == 0 || size < min_size)
+            return file(std::move(file_name));
+
+        void *pointer = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pointer == MAP_FAILED)
+            throw std::runtime_error(FMT("Unable to map file `{}` to memory.", file_name));
+        AssetPack::GetCounters().disk_reads++;
+
+        ReadOnlyData ret;
+        ret.ref = std::make_shared<Data>();
+        ret.ref->mapping = std::shared_ptr<const void>(pointer, [size](const void *pointer){munmap(const_cast<void *>(pointer), size);});
+
+        ret.ref->begin = static_cast<const std::uint8_t *>(pointer);
+        ret.ref->end = ret.ref->begin + size;
+        ret.ref->name = std::move(file_name);
+
+        return ret;
+        #else
+        (void)min_size;
+        return file(std::move(file_name));
+        #endif
+    }
+}
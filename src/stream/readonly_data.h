@@ -26,6 +26,7 @@ namespace Stream
         struct Data
         {
             std::unique_ptr<std::uint8_t[]> storage;
+            std::shared_ptr<const void> mapping; // If the data is a memory-mapped file, this unmaps it when destroyed. For subranges, this owns the parent data.
 
             const std::uint8_t *begin = 0, *end = 0;
             bool extra_null_terminator = false; // If this is `true`, there is an extra null terminator past the `end`.
@@ -129,34 +130,33 @@ namespace Stream
         }
 
         // Loads an entire file to memory, adds a null-terminator.
-        [[nodiscard]] static ReadOnlyData file(std::string file_name)
+        // If the file is in a mounted `AssetPack`, reads it from there instead.
+        [[nodiscard]] static ReadOnlyData file(std::string file_name);
+
+        // Maps a file to memory, instead of reading it. Doesn't add a null-terminator, call `null_terminate()` or `string()` if you need one.
+        // This is faster for large files, and the pages are shared with the OS file cache. `Input` reads from this without copying.
+        // The file must not be truncated while the data is alive, otherwise reading it can crash.
+        // Files smaller than `min_size` are read with `file()` instead, since for them mapping is slower than copying, if the whole file is read
+        //   (by 2x for 4 KB files, breaks even somewhere between 128 KB and 512 KB; for a 32 MB file mapping is 2x faster).
+        // Also falls back to `file()` on platforms other than Linux, and for empty files.
+        // If the file is in a mounted `AssetPack`, returns it from there instead (without copying, unless it's compressed).
+        [[nodiscard]] static ReadOnlyData file_mapped(std::string file_name, std::size_t min_size = 512 * 1024);
+
+        // Returns a reference to a part of this data, which keeps this data alive. Doesn't add a null-terminator.
+        [[nodiscard]] ReadOnlyData subrange(std::size_t offset, std::size_t size, std::string new_name) const
         {
+            if (!ref)
+                throw std::runtime_error("Attempt to get a subrange of a null ReadOnlyData.");
+            if (offset > this->size() || size > this->size() - offset)
+                throw std::runtime_error(FMT("Subrange of {} bytes at offset {} is out of bounds of `{}`, which has {} bytes.", size, offset, name(), this->size()));
+
             ReadOnlyData ret;
             ret.ref = std::make_shared<Data>();
+            ret.ref->mapping = std::shared_ptr<const void>(ref, ref->begin); // Shares the ownership of `ref`.
 
-            FILE *file = better_fopen(file_name.c_str(), "rb");
-            if (!file)
-                throw std::runtime_error(FMT("Unable to open file `{}`.", file_name));
-            FINALLY{std::fclose(file);};
-
-            std::setbuf(file, 0); // This can fail, but we don't care about it.
-
-            std::fseek(file, 0, SEEK_END);
-            auto size = std::ftell(file);
-            std::fseek(file, 0, SEEK_SET);
-
-            if (std::ferror(file) || size == EOF)
-                throw std::runtime_error(FMT("Unable to get size of file `{}`.", file_name));
-
-            ret.ref->storage = std::make_unique<std::uint8_t[]>(size+1); // 1 extra byte for the null-terminator.
-            if (size > 1 && !std::fread(ret.ref->storage.get(), size, 1, file))
-                throw std::runtime_error(FMT("Unable to read from file `{}`.", file_name));
-            ret.ref->storage[size] = '\0';
-
-            ret.ref->begin = ret.ref->storage.get();
+            ret.ref->begin = ref->begin + offset;
             ret.ref->end = ret.ref->begin + size;
-            ret.ref->extra_null_terminator = true;
-            ret.ref->name = std::move(file_name);
+            ret.ref->name = std::move(new_name);
 
             return ret;
         }
@@ -0,0 +1,154 @@
+#include "asset_pack.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <doctest/doctest.h>
+
+#include "macros/finally.h"
+#include "program/exe_path.h"
+#include "stream/input.h"
+#include "utils/filesystem.h"
+
+namespace
+{
+    [[nodiscard]] std::string MakeTempDir(const std::string &name)
+    {
+        std::string dir = (std::filesystem::temp_directory_path() / name).string();
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    void WriteFile(const std::string &file_name, const std::string &contents)
+    {
+        std::filesystem::create_directories(std::filesystem::path(file_name).parent_path());
+        std::ofstream(file_name, std::ios::binary) << contents;
+    }
+}
+
+TEST_CASE("asset_pack")
+{
+    std::string dir = MakeTempDir("imp_test_asset_pack");
+    std::string compressible(10000, 'x');
+    std::string incompressible;
+    std::uint32_t state = 1;
+    for (int i = 0; i < 1000; i++)
+    {
+        state = state * 1664525 + 1013904223;
+        incompressible += char(state >> 24);
+    }
+
+    WriteFile(dir + "/assets/a.txt", "hello");
+    WriteFile(dir + "/assets/maps/big.json", compressible);
+    WriteFile(dir + "/assets/images/noise.png", incompressible);
+    WriteFile(dir + "/assets/_ignored.txt", "ignored");
+    WriteFile(dir + "/assets/empty", "");
+
+    std::string pack_file_name = dir + "/assets.pack";
+    Stream::AssetPack::Create(dir + "/assets/", pack_file_name);
+
+    Stream::AssetPack pack = Stream::ReadOnlyData::file(pack_file_name);
+    REQUIRE(pack.GetEntries().size() == 4);
+    REQUIRE(pack.FindEntry("maps/big.json")->codec == std::uint8_t(Archive::fast_codec));
+    REQUIRE(pack.FindEntry("images/noise.png")->codec == Stream::AssetPack::stored_codec);
+    REQUIRE(pack.FindEntry("_ignored.txt") == nullptr);
+    REQUIRE(pack.FindEntry("maps") == nullptr);
+    REQUIRE(pack.ReadEntry("empty", "empty")->size() == 0);
+    REQUIRE_FALSE(pack.ReadEntry("missing", "missing"));
+
+    // Uncompressed entries reference the pack without copying.
+    Stream::ReadOnlyData noise = *pack.ReadEntry("images/noise.png", "noise");
+    REQUIRE(std::string(noise.data_char(), noise.size()) == incompressible);
+    REQUIRE(noise.name() == "noise");
+
+    // Now mount the pack, and remove the loose files.
+    std::filesystem::remove_all(dir + "/assets");
+    Stream::AssetPack::Mount(dir + "/assets/", pack);
+    FINALLY{Stream::AssetPack::UnmountAll();};
+
+    auto counters = Stream::AssetPack::GetCounters();
+    REQUIRE(Stream::ReadOnlyData::file(dir + "/assets/a.txt").string() == std::string("hello"));
+    REQUIRE(Stream::ReadOnlyData::file_mapped(dir + "/assets/maps/big.json").data_char() == compressible);
+    Stream::Input input(dir + "/assets/images/noise.png");
+    REQUIRE(input.ContiguousData() == noise.data());
+    REQUIRE(input.ReadByte() == std::uint8_t(incompressible[0]));
+    REQUIRE(Stream::AssetPack::GetCounters().pack_reads == counters.pack_reads + 3);
+    REQUIRE(Stream::AssetPack::GetCounters().disk_reads == counters.disk_reads);
+
+    REQUIRE(Stream::AssetPack::FileExists(dir + "/assets/maps/big.json"));
+    REQUIRE(Stream::AssetPack::FileExists(pack_file_name)); // Not in the pack, but on the disk.
+    REQUIRE_FALSE(Stream::AssetPack::FileExists(dir + "/assets/maps/missing.json"));
+    REQUIRE_THROWS(Stream::ReadOnlyData::file(dir + "/assets/maps/missing.json"));
+
+    // The stamps of the packed files come from the pack, and differ between the files.
+    REQUIRE(Stream::AssetPack::FileStamp(dir + "/assets/a.txt"));
+    REQUIRE(Stream::AssetPack::FileStamp(dir + "/assets/a.txt") != Stream::AssetPack::FileStamp(dir + "/assets/maps/big.json"));
+    REQUIRE(Stream::AssetPack::FileStamp(pack_file_name));
+    REQUIRE_FALSE(Stream::AssetPack::FileStamp(dir + "/assets/maps/missing.json"));
+
+    // The stamps of the loose files change with their contents.
+    WriteFile(dir + "/loose.txt", "abc");
+    std::optional<std::uint64_t> loose_stamp = Stream::AssetPack::FileStamp(dir + "/loose.txt");
+    REQUIRE(loose_stamp);
+    REQUIRE(Stream::AssetPack::FileStamp(dir + "/loose.txt") == loose_stamp);
+    WriteFile(dir + "/loose.txt", "abcd");
+    REQUIRE(Stream::AssetPack::FileStamp(dir + "/loose.txt") != loose_stamp);
+
+    // Corrupted packs.
+    std::string pack_data(Stream::ReadOnlyData::file(pack_file_name).data_char(), std::filesystem::file_size(pack_file_name));
+    REQUIRE_THROWS(Stream::AssetPack(Stream::ReadOnlyData::mem_reference(pack_data.substr(0, pack_data.size() / 2))));
+    pack_data[12] ^= 1; // The hash of the first entry.
+    REQUIRE_THROWS(Stream::AssetPack(Stream::ReadOnlyData::mem_reference(pack_data)));
+    REQUIRE_THROWS(Stream::AssetPack(Stream::ReadOnlyData::mem_reference(std::string("not a pack"))));
+
+    std::filesystem::remove_all(dir);
+}
+
+// Needs the assets next to the executable. Loads every asset once, like the game does on startup.
+TEST_CASE("bench.asset_pack" * doctest::skip())
+{
+    std::string assets_dir = Program::ExeDir() + "assets";
+    std::string pack_file_name = (std::filesystem::temp_directory_path() / "imp_bench_assets.pack").string();
+    Stream::AssetPack::Create(assets_dir, pack_file_name);
+
+    std::vector<std::string> file_names;
+    Filesystem::ForEachObject(Filesystem::GetObjectTree(assets_dir, -1), [&](const Filesystem::TreeNode &node)
+    {
+        if (node.info.category == Filesystem::file && !node.name.starts_with('_'))
+            file_names.push_back(node.path);
+    });
+
+    for (bool packed : {false, true})
+    {
+        // The best time of several runs.
+        double seconds = 1e9;
+        Stream::AssetPack::Counters counters;
+        std::size_t total_size = 0;
+        for (int i = 0; i < 20; i++)
+        {
+            Stream::AssetPack::UnmountAll();
+            Stream::AssetPack::Counters old_counters = Stream::AssetPack::GetCounters();
+
+            auto start = std::chrono::steady_clock::now();
+            if (packed)
+                Stream::AssetPack::MountIfExists(assets_dir + "/", pack_file_name);
+            total_size = 0;
+            for (const std::string &file_name : file_names)
+                total_size += Stream::ReadOnlyData::file_mapped(file_name).size();
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+            counters.disk_reads = Stream::AssetPack::GetCounters().disk_reads - old_counters.disk_reads;
+            counters.pack_reads = Stream::AssetPack::GetCounters().pack_reads - old_counters.pack_reads;
+        }
+
+        std::cout << FMT("{}: {} files, {} bytes, {} opened from the disk, {} read from the pack, {:.3f} ms\n",
+            packed ? "packed" : "loose", file_names.size(), total_size, counters.disk_reads, counters.pack_reads, seconds * 1000);
+    }
+
+    Stream::AssetPack::UnmountAll();
+    std::filesystem::remove(pack_file_name);
+}
@@ -0,0 +1,221 @@
+#include "input.h"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "reflection/full.h"
+#include "reflection/short_macros.h"
+
+namespace
+{
+    // Reads from `source` through the two small buffers, like a file would.
+    [[nodiscard]] Stream::Input MakeBufferedInput(const std::string &source, Stream::capacity_t capacity = Stream::capacity_t(16))
+    {
+        return Stream::Input("buffered", source.size(), [&source](Stream::Input &, std::size_t offset, std::size_t size, std::uint8_t *dst)
+        {
+            std::copy_n(source.data() + offset, size, dst);
+        }, capacity);
+    }
+
+    SIMPLE_STRUCT( BenchElem
+        DECL(int INIT{}) id
+        DECL(std::string) name
+        DECL(std::vector<int>) values
+    )
+
+    // A wide struct, like a settings file.
+    SIMPLE_STRUCT( BenchConfig
+        DECL(int INIT{}) window_width, window_height, max_fps, language_id, difficulty, autosave_interval, max_undo_steps, particle_count
+        DECL(int INIT{}) shadow_quality, texture_quality, anti_aliasing, key_repeat_delay, key_repeat_rate, level_index, seed, version
+        DECL(float INIT{}) master_volume, music_volume, sfx_volume, mouse_sensitivity, camera_speed, camera_zoom, ui_scale, gamma
+        DECL(bool INIT{}) fullscreen, vsync, invert_mouse, show_fps, show_hints, show_tooltips, pause_on_focus_loss, skip_intro
+    )
+
+    // `N` names of the form `name_<i>`, for testing the lookup in long lists.
+    template <std::size_t N>
+    constexpr auto numbered_names = []
+    {
+        std::array<std::array<char, 12>, N> ret{};
+        for (std::size_t i = 0; i < N; i++)
+        {
+            std::string_view prefix = "name_";
+            std::copy(prefix.begin(), prefix.end(), ret[i].begin());
+            std::size_t len = 1;
+            for (std::size_t j = i; j >= 10; j /= 10)
+                len++;
+            for (std::size_t j = i, k = 0; k < len; j /= 10, k++)
+                ret[i][prefix.size() + len - 1 - k] = char('0' + j % 10);
+        }
+        return ret;
+    }();
+
+    template <std::size_t N>
+    constexpr std::array<const char *, N> NumberedNames()
+    {
+        std::array<const char *, N> ret{};
+        for (std::size_t i = 0; i < N; i++)
+            ret[i] = numbered_names<N>[i].data();
+        return ret;
+    }
+}
+
+TEST_CASE("input.contiguous")
+{
+    std::string source = "  hello, world 12345678 abcdefghijklmnopqrstuvwxyz end";
+
+    Stream::Input memory = Stream::ReadOnlyData::mem_reference(source);
+    Stream::Input buffered = MakeBufferedInput(source);
+    REQUIRE(memory.ContiguousData() == reinterpret_cast<const std::uint8_t *>(source.data()));
+    REQUIRE(buffered.ContiguousData() == nullptr);
+
+    // Both kinds of streams must behave the same.
+    for (Stream::Input *input : {&memory, &buffered})
+    {
+        REQUIRE(input->Discard<Stream::any>(Stream::Char::IsWhitespace{}) == 2);
+        REQUIRE(input->Discard<Stream::any>(Stream::Char::IsWhitespace{}) == 0);
+        REQUIRE_THROWS(input->Discard<Stream::at_least_one>(Stream::Char::IsWhitespace{}));
+        REQUIRE(input->Extract(Stream::Char::IsAlpha{}) == "hello");
+        REQUIRE(input->Extract<Stream::one>(Stream::Char::IsPunctuation{}) == ',');
+        REQUIRE(input->Extract<Stream::if_present>(Stream::Char::IsPunctuation{}) == std::nullopt);
+        REQUIRE(input->Position() == 9); // `if_present` consumes the character even on failure.
+        REQUIRE(input->Extract(Stream::Char::IsAlpha{}) == "world");
+        input->SkipOne();
+
+        std::vector<std::uint8_t> digits;
+        REQUIRE(input->Extract<Stream::any>(Stream::Char::IsDigit{}, &digits) == 8);
+        REQUIRE(digits.size() == 8);
+        REQUIRE(input->ReadChar() == ' ');
+
+        // Reading across the buffer boundaries.
+        char letters[26];
+        input->Read(letters, 26);
+        REQUIRE(std::string_view(letters, 26) == "abcdefghijklmnopqrstuvwxyz");
+
+        REQUIRE_FALSE(input->DiscardChars<Stream::if_present>(" ens"));
+        REQUIRE(input->Position() == source.size() - 4);
+        REQUIRE_THROWS(input->DiscardChars(" ens"));
+        REQUIRE(input->DiscardChars(" end"));
+        REQUIRE_FALSE(input->MoreData());
+        REQUIRE_FALSE(input->DiscardChars<Stream::if_present>("x"));
+        REQUIRE(input->Discard<Stream::any>(Stream::Char::IsWhitespace{}) == 0);
+        REQUIRE_THROWS(input->ReadChar());
+        REQUIRE_THROWS(input->Read(letters, 1));
+    }
+
+    // Refl parses in place from contiguous streams.
+    for (bool buffered : {false, true})
+    {
+        auto MakeInput = [&](const std::string &str) {return buffered ? MakeBufferedInput(str) : Stream::Input(Stream::ReadOnlyData::mem_reference(str));};
+
+        std::string str = R"( ["a\"b\\", "", "x"] )";
+        REQUIRE(Refl::FromString<std::vector<std::string>>(MakeInput(str)) == std::vector<std::string>{"a\"b\\", "", "x"});
+        str = R"( [12, -34] )";
+        REQUIRE(Refl::FromString<std::vector<int>>(MakeInput(str)) == std::vector<int>{12, -34});
+        str = R"( [12, 1x] )";
+        REQUIRE_THROWS(Refl::FromString<std::vector<int>>(MakeInput(str)));
+        str = R"("abc\")";
+        REQUIRE_THROWS(Refl::FromString<std::string>(MakeInput(str)));
+        str = R"("abc)";
+        REQUIRE_THROWS(Refl::FromString<std::string>(MakeInput(str)));
+
+        // Field names are looked up in place too.
+        str = R"({skip_intro=true, window_height=2, gamma=0.5, window_width=1})";
+        BenchConfig config = Refl::FromString<BenchConfig>(MakeInput(str), {.ignore_missing_fields = true});
+        REQUIRE(config.window_width == 1);
+        REQUIRE(config.window_height == 2);
+        REQUIRE(config.gamma == 0.5f);
+        REQUIRE(config.skip_intro);
+        str = R"({window_width=1, window_widt=2})";
+        REQUIRE_THROWS(Refl::FromString<BenchConfig>(MakeInput(str), {.ignore_missing_fields = true}));
+        str = R"({window_width=1, window_width=2})";
+        REQUIRE_THROWS(Refl::FromString<BenchConfig>(MakeInput(str), {.ignore_missing_fields = true}));
+    }
+
+    // Caching a file-like stream switches it to the contiguous mode.
+    Stream::Input cached = MakeBufferedInput(source);
+    cached.Seek(2, Stream::absolute);
+    Stream::ReadOnlyData cached_data = cached.CacheToMemory();
+    REQUIRE(cached.ContiguousData() == cached_data.data());
+    REQUIRE(cached.Extract(Stream::Char::IsAlpha{}) == "hello");
+}
+
+TEST_CASE("input.string_index")
+{
+    // Short lists use a perfect hash, long ones fall back to a binary search.
+    auto Check = [&]<std::size_t N>
+    {
+        for (std::size_t i = 0; i < N; i++)
+            REQUIRE(Refl::Utils::GetStringIndex<NumberedNames<N>>(numbered_names<N>[i].data()) == i);
+        REQUIRE(Refl::Utils::GetStringIndex<NumberedNames<N>>("name_") == std::size_t(-1));
+        REQUIRE(Refl::Utils::GetStringIndex<NumberedNames<N>>("name_0 ") == std::size_t(-1));
+        REQUIRE(Refl::Utils::GetStringIndex<NumberedNames<N>>(FMT("name_{}", N)) == std::size_t(-1));
+        REQUIRE(Refl::Utils::GetStringIndex<NumberedNames<N>>("") == std::size_t(-1));
+    };
+    Check.operator()<1>();
+    Check.operator()<32>();
+    Check.operator()<100>();
+    Check.operator()<1000>();
+
+    static_assert(Refl::Utils::impl::FindPerfectHash(NumberedNames<32>()).first != 0);
+    static_assert(Refl::Utils::impl::FindPerfectHash(NumberedNames<100>()).first != 0);
+    static_assert(Refl::Utils::impl::FindPerfectHash(NumberedNames<1000>()).first == 0);
+}
+
+TEST_CASE("bench.input.parse" * doctest::skip())
+{
+    std::vector<BenchElem> elems;
+    for (int i = 0; i < 20000; i++)
+    {
+        BenchElem &elem = elems.emplace_back();
+        elem.id = i;
+        elem.name = FMT("elem_{}", i);
+        elem.values = {i * 2, -i, 42};
+    }
+    std::string source = Refl::ToString(elems, Refl::ToStringOptions::Pretty());
+
+    for (bool buffered : {false, true})
+    {
+        // The best time of several runs, since the other ones are noisy.
+        double seconds = std::numeric_limits<double>::infinity();
+        std::size_t checksum = 0;
+        for (int i = 0; i < 20; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Stream::Input input = buffered ? MakeBufferedInput(source, Stream::Input::default_capacity) : Stream::Input(Stream::ReadOnlyData::mem_reference(source));
+            checksum += Refl::FromString<std::vector<BenchElem>>(input).size();
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::cout << FMT("Refl::FromString, {} ({} bytes): {:.2f} ms per parse, {:.1f} MB/s (checksum {})\n", buffered ? "buffered" : "contiguous", source.size(), seconds * 1000, source.size() / seconds / 1e6, checksum);
+    }
+}
+
+TEST_CASE("bench.input.parse_config" * doctest::skip())
+{
+    std::vector<BenchConfig> configs(5000);
+    for (std::size_t i = 0; i < configs.size(); i++)
+    {
+        configs[i].window_width = int(i);
+        configs[i].gamma = i / 8.f;
+        configs[i].vsync = i % 2;
+    }
+    std::string source = Refl::ToString(configs, Refl::ToStringOptions::Pretty());
+
+    // The best time of several runs.
+    double seconds = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 20; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(Refl::FromString<std::vector<BenchConfig>>(Stream::ReadOnlyData::mem_reference(source)).size() == configs.size());
+        seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::cout << FMT("Refl::FromString, {} structs with {} fields ({} bytes): {:.2f} ms per parse, {:.1f} MB/s, {:.0f} ns per field\n",
+        configs.size(), Refl::Class::member_count<BenchConfig>, source.size(), seconds * 1000, source.size() / seconds / 1e6, seconds * 1e9 / configs.size() / Refl::Class::member_count<BenchConfig>);
+}
@@ -0,0 +1,95 @@
+#include "output.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "utils/archive.h"
+
+TEST_CASE("output.async")
+{
+    std::vector<std::uint8_t> expected;
+    std::vector<std::uint8_t> result;
+
+    Stream::Output output = Stream::Output::Async(Stream::Output::Container(result), Stream::capacity_t(64));
+    REQUIRE(output.IsAsync());
+    REQUIRE(output.GetTarget() == Stream::Output::Container(result).GetTarget());
+
+    for (int i = 0; i < 1000; i++)
+    {
+        output.WriteByte(i % 256);
+        expected.push_back(i % 256);
+
+        // Larger than the buffer.
+        if (i % 100 == 0)
+        {
+            std::vector<std::uint8_t> block(150, std::uint8_t(i));
+            output.WriteBytes(block.data(), block.size());
+            expected.insert(expected.end(), block.begin(), block.end());
+        }
+    }
+
+    output.Flush();
+    REQUIRE(result == expected);
+    REQUIRE(output.GetAsyncCounters().buffers_written == (expected.size() + 63) / 64);
+
+    // Flushing again does nothing.
+    output.Flush();
+    REQUIRE(result == expected);
+
+    // The exceptions are rethrown on the producer thread.
+    Stream::Output failing = Stream::Output::Async(Stream::Output("failing", [](Stream::Output &, const std::uint8_t *, std::size_t)
+    {
+        throw std::runtime_error("Disk is full.");
+    }), Stream::capacity_t(16));
+    failing.WriteString("Hello!");
+    REQUIRE_THROWS_WITH(failing.Flush(), "Disk is full.");
+    REQUIRE_THROWS(failing.WriteString(std::string(100, 'x')));
+}
+
+// The producer does some work per record, like a game tick. The records are compressed and written to a file, like a replay recorder would do.
+TEST_CASE("bench.output.async" * doctest::skip())
+{
+    std::string file_name = (std::filesystem::temp_directory_path() / "imp_bench_output.bin").string();
+    constexpr int num_records = 1'000'000;
+
+    for (bool async : {false, true})
+    {
+        Stream::Output compressed_file(file_name, Meta::fake_copyable([file = Stream::Output(file_name), compressed = std::vector<std::uint8_t>{}](Stream::Output &, const std::uint8_t *data, std::size_t size) mutable
+        {
+            compressed.resize(Archive::Raw::MaxCompressedSize(data, data + size));
+            std::uint8_t *end = Archive::Raw::Compress(data, data + size, compressed.data(), compressed.data() + compressed.size());
+            file.WriteBytes(compressed.data(), end - compressed.data());
+            file.Flush();
+        }), Stream::capacity_t(1 << 16));
+        Stream::Output output = async ? Stream::Output::Async(std::move(compressed_file)) : std::move(compressed_file);
+
+        std::uint64_t state = 1;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_records; i++)
+        {
+            // Some fake work, similar to a game tick.
+            for (int j = 0; j < 600; j++)
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+
+            char record[64];
+            for (std::size_t j = 0; j < sizeof record; j++)
+                record[j] = char(state >> (j % 8 * 8)) & 15;
+            output.WriteString(record, sizeof record);
+        }
+        double write_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        output.Flush();
+        double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto counters = output.GetAsyncCounters();
+        std::cout << FMT("{}: {} MB, producer {:.1f} ms, with the final flush {:.1f} ms, {} stalls for {:.1f} ms total\n",
+            async ? "async" : "sync", num_records * 64 / 1'000'000, write_seconds * 1000, total_seconds * 1000, counters.stalls, std::chrono::duration<double>(counters.stall_time).count() * 1000);
+    }
+
+    std::filesystem::remove(file_name);
+}
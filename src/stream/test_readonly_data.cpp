@@ -0,0 +1,80 @@
+#include "readonly_data.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <doctest/doctest.h>
+
+#include "stream/input.h"
+
+namespace
+{
+    [[nodiscard]] std::string WriteTempFile(const std::string &name, const std::string &contents)
+    {
+        std::string file_name = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream(file_name, std::ios::binary) << contents;
+        return file_name;
+    }
+}
+
+TEST_CASE("readonly_data.file_mapped")
+{
+    std::string contents("hello\0world", 11);
+    contents += std::string(10000, 'x'); // More than one page.
+    std::string file_name = WriteTempFile("imp_test_readonly_data.txt", contents);
+
+    // This is smaller than the default `min_size`, so it's read normally.
+    REQUIRE(Stream::ReadOnlyData::file_mapped(file_name).is_null_terminated());
+
+    Stream::ReadOnlyData data = Stream::ReadOnlyData::file_mapped(file_name, 0);
+    REQUIRE(data.name() == file_name);
+    REQUIRE(std::string(data.data_char(), data.size()) == contents);
+
+    // Unlike `file()`, there's no null-terminator, unless we ask for one.
+    if (IMP_PLATFORM_IS(linux))
+        REQUIRE_FALSE(data.is_null_terminated());
+    Stream::ReadOnlyData terminated = data.null_terminate();
+    REQUIRE(terminated.is_null_terminated());
+    REQUIRE(terminated.data() != data.data());
+    REQUIRE(std::string(terminated.data_char(), terminated.size()) == contents);
+
+    // The input reads straight from the mapping.
+    Stream::Input input = data;
+    REQUIRE(input.ReadLittle<std::uint8_t>() == 'h');
+    REQUIRE(input.ReadLittle<std::uint8_t>() == 'e');
+
+    // Empty files fall back to `file()`.
+    Stream::ReadOnlyData empty = Stream::ReadOnlyData::file_mapped(WriteTempFile("imp_test_readonly_data_empty.txt", ""), 0);
+    REQUIRE(empty.size() == 0);
+    REQUIRE(empty.is_null_terminated());
+
+    REQUIRE_THROWS(Stream::ReadOnlyData::file_mapped(file_name + ".missing", 0));
+}
+
+TEST_CASE("bench.readonly_data.file_mapped" * doctest::skip())
+{
+    for (std::size_t size : {std::size_t(4) << 10, std::size_t(16) << 10, std::size_t(64) << 10, std::size_t(128) << 10, std::size_t(256) << 10, std::size_t(512) << 10, std::size_t(1) << 20, std::size_t(32) << 20})
+    {
+        std::string file_name = WriteTempFile("imp_bench_readonly_data.bin", std::string(size, 'x'));
+
+        for (bool mapped : {false, true})
+        {
+            int num_reps = std::max(1, int((std::size_t(1) << 30) / size / 4));
+            std::size_t checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_reps; i++)
+            {
+                Stream::ReadOnlyData data = mapped ? Stream::ReadOnlyData::file_mapped(file_name, 0) : Stream::ReadOnlyData::file(file_name);
+                // Read all of the data, like a parser would. Both to be fair to `file()`, and because the mapping is lazy.
+                for (std::size_t j = 0; j < data.size(); j++)
+                    checksum += data.data()[j];
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << FMT("{} bytes, {}: {:.1f} us per load (checksum {})\n", size, mapped ? "file_mapped" : "file", seconds / num_reps * 1e6, checksum);
+        }
+    }
+}
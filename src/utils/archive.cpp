@@ -1,9 +1,20 @@
 #include "archive.h"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <zlib.h>
+#if IMP_PLATFORM_IS(extra_codecs)
+#include <lz4.h>
+#include <zstd.h>
+#endif
 
+#include "meta/common.h"
+#include "stream/input.h"
+#include "stream/output.h"
 #include "utils/robust_math.h"
 
 namespace Archive
@@ -24,11 +35,32 @@ namespace Archive
             return dst_begin + dst_size;
         }
 
-        void Uncompress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end)
+        void Uncompress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end, Format format)
         {
-            uLong dst_size = dst_end - dst_begin; // uncompress() changes this value.
-            int status = uncompress(dst_begin, &dst_size, src_begin, src_end - src_begin);
-            if (status != Z_OK || dst_size != uLong(dst_end - dst_begin))
+            if (format == Format::zlib)
+            {
+                uLong dst_size = dst_end - dst_begin; // uncompress() changes this value.
+                int status = uncompress(dst_begin, &dst_size, src_begin, src_end - src_begin);
+                if (status != Z_OK || dst_size != uLong(dst_end - dst_begin))
+                    throw std::runtime_error("Uncompression failure.");
+                return;
+            }
+
+            z_stream stream{};
+            if (Robust::conversion_fails(src_end - src_begin, stream.avail_in) || Robust::conversion_fails(dst_end - dst_begin, stream.avail_out))
+                throw std::runtime_error("Unable to uncompress: The object is too large.");
+            stream.next_in = const_cast<uint8_t *>(src_begin);
+            stream.next_out = dst_begin;
+
+            // Adding 16 to the window size makes zlib expect the gzip header.
+            if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+                throw std::runtime_error("Uncompression failure.");
+            // This fails with `Z_BUF_ERROR` if the output buffer is too small.
+            int status = inflate(&stream, Z_FINISH);
+            bool ok = status == Z_STREAM_END && stream.avail_out == 0;
+            inflateEnd(&stream);
+
+            if (!ok)
                 throw std::runtime_error("Uncompression failure.");
         }
     }
@@ -79,4 +111,282 @@ namespace Archive
         std::size_t size = UncompressedSize(src_begin, src_end);
         Raw::Uncompress(src_begin + sizeof(size_type), src_end, dst_begin, dst_begin + size);
     }
+
+
+    std::string_view CodecName(Codec codec)
+    {
+        switch (codec)
+        {
+            case Codec::zlib: return "zlib";
+            case Codec::lz4:  return "lz4";
+            case Codec::zstd: return "zstd";
+        }
+        return "??";
+    }
+
+    [[noreturn]] static void ThrowCodecUnavailable(Codec codec)
+    {
+        throw std::runtime_error(FMT("The `{}` compression isn't available in this build, rebuild with `EXTRA_CODECS=1`.", CodecName(codec)));
+    }
+
+    #if IMP_PLATFORM_IS(extra_codecs)
+    // The compression level for zstd. 3 is their default, higher levels are noticeably slower.
+    static constexpr int zstd_level = 3;
+    #endif
+
+    std::size_t MaxCompressedSize(Codec codec, std::size_t size)
+    {
+        switch (codec)
+        {
+          case Codec::zlib:
+            return compressBound(size);
+          #if IMP_PLATFORM_IS(extra_codecs)
+          case Codec::lz4:
+            if (size > LZ4_MAX_INPUT_SIZE)
+                throw std::runtime_error("Unable to compress: The object is too large.");
+            return LZ4_compressBound(int(size));
+          case Codec::zstd:
+            return ZSTD_compressBound(size);
+          #else
+          case Codec::lz4:
+          case Codec::zstd:
+            ThrowCodecUnavailable(codec);
+          #endif
+        }
+        throw std::runtime_error("Unknown compression codec.");
+    }
+
+    uint8_t *Compress(Codec codec, const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end)
+    {
+        switch (codec)
+        {
+          case Codec::zlib:
+            return Raw::Compress(src_begin, src_end, dst_begin, dst_end);
+          #if IMP_PLATFORM_IS(extra_codecs)
+          case Codec::lz4:
+            {
+                int src_size = 0;
+                if (Robust::conversion_fails(src_end - src_begin, src_size))
+                    throw std::runtime_error("Unable to compress: The object is too large.");
+                int dst_size = int(std::min(dst_end - dst_begin, std::ptrdiff_t(std::numeric_limits<int>::max())));
+                int result = LZ4_compress_default(reinterpret_cast<const char *>(src_begin), reinterpret_cast<char *>(dst_begin), src_size, dst_size);
+                if (result <= 0)
+                    throw std::runtime_error("Compression failure.");
+                return dst_begin + result;
+            }
+          case Codec::zstd:
+            {
+                // Reusing the context is noticeably faster for small chunks.
+                thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+                if (!context)
+                    throw std::runtime_error("Compression failure.");
+                std::size_t result = ZSTD_compressCCtx(context.get(), dst_begin, dst_end - dst_begin, src_begin, src_end - src_begin, zstd_level);
+                if (ZSTD_isError(result))
+                    throw std::runtime_error(FMT("Compression failure: {}", ZSTD_getErrorName(result)));
+                return dst_begin + result;
+            }
+          #else
+          case Codec::lz4:
+          case Codec::zstd:
+            ThrowCodecUnavailable(codec);
+          #endif
+        }
+        throw std::runtime_error("Unknown compression codec.");
+    }
+
+    void Uncompress(Codec codec, const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end)
+    {
+        switch (codec)
+        {
+          case Codec::zlib:
+            Raw::Uncompress(src_begin, src_end, dst_begin, dst_end);
+            return;
+          #if IMP_PLATFORM_IS(extra_codecs)
+          case Codec::lz4:
+            {
+                int src_size = 0, dst_size = 0;
+                if (Robust::conversion_fails(src_end - src_begin, src_size) || Robust::conversion_fails(dst_end - dst_begin, dst_size))
+                    throw std::runtime_error("Unable to uncompress: The object is too large.");
+                int result = LZ4_decompress_safe(reinterpret_cast<const char *>(src_begin), reinterpret_cast<char *>(dst_begin), src_size, dst_size);
+                if (result != dst_size)
+                    throw std::runtime_error("Uncompression failure.");
+                return;
+            }
+          case Codec::zstd:
+            {
+                thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+                if (!context)
+                    throw std::runtime_error("Uncompression failure.");
+                std::size_t result = ZSTD_decompressDCtx(context.get(), dst_begin, dst_end - dst_begin, src_begin, src_end - src_begin);
+                if (ZSTD_isError(result) || result != std::size_t(dst_end - dst_begin))
+                    throw std::runtime_error("Uncompression failure.");
+                return;
+            }
+          #else
+          case Codec::lz4:
+          case Codec::zstd:
+            ThrowCodecUnavailable(codec);
+          #endif
+        }
+        throw std::runtime_error("Unknown compression codec.");
+    }
+
+
+    static constexpr char chunked_magic[4] = {'I', 'M', 'P', 'Z'};
+    static constexpr std::size_t max_chunk_size = std::size_t(1) << 30;
+
+    Stream::Output CompressingOutput(Stream::Output target, Codec codec, std::size_t chunk_size)
+    {
+        if (chunk_size == 0 || chunk_size > max_chunk_size)
+            throw std::runtime_error(FMT("Invalid compression chunk size: {}.", chunk_size));
+
+        (void)MaxCompressedSize(codec, chunk_size); // Validate the codec.
+
+        target.WriteString(chunked_magic, sizeof chunked_magic);
+        target.WriteLittle<std::uint8_t>(std::uint8_t(codec));
+        target.WriteLittle<std::uint32_t>(std::uint32_t(chunk_size));
+        target.Flush();
+
+        std::string name = FMT("Compressing with {}: {}", CodecName(codec), target.GetTarget());
+
+        auto flush = [target = std::move(target), codec, chunk_size, compressed = std::vector<uint8_t>{}](Stream::Output &, const uint8_t *data, std::size_t size) mutable
+        {
+            // This receives more than one chunk at a time when a large block is written directly.
+            while (size > 0)
+            {
+                std::size_t this_size = std::min(size, chunk_size);
+                compressed.resize(MaxCompressedSize(codec, this_size));
+                std::size_t compressed_size = Compress(codec, data, data + this_size, compressed.data(), compressed.data() + compressed.size()) - compressed.data();
+
+                target.WriteLittle<std::uint32_t>(std::uint32_t(this_size));
+                target.WriteLittle<std::uint32_t>(std::uint32_t(compressed_size));
+                target.WriteBytes(compressed.data(), compressed_size);
+
+                data += this_size;
+                size -= this_size;
+            }
+            target.Flush();
+        };
+
+        return Stream::Output(std::move(name), Meta::fake_copyable(std::move(flush)), Stream::capacity_t(chunk_size));
+    }
+
+    Stream::Input UncompressingInput(Stream::Input source)
+    {
+        std::string name = source.GetTarget();
+
+        struct Chunk
+        {
+            std::size_t offset = 0; // Uncompressed.
+            std::size_t size = 0;
+            std::size_t compressed_offset = 0; // In `source`.
+            std::size_t compressed_size = 0;
+        };
+
+        std::vector<Chunk> chunks;
+        Codec codec{};
+        std::size_t chunk_size = 0;
+        std::size_t total_size = 0;
+
+        // Read the header and the chunk sizes.
+        try
+        {
+            char magic[sizeof chunked_magic];
+            source.Read(magic, sizeof magic);
+            if (!std::equal(magic, magic + sizeof magic, chunked_magic))
+                throw std::runtime_error("This is not a compressed stream.");
+
+            codec = Codec(source.ReadLittle<std::uint8_t>());
+            if (codec != Codec::zlib && codec != Codec::lz4 && codec != Codec::zstd)
+                throw std::runtime_error(FMT("Unknown compression codec: {}.", int(codec)));
+            if (!CodecAvailable(codec))
+                ThrowCodecUnavailable(codec);
+
+            chunk_size = source.ReadLittle<std::uint32_t>();
+            if (chunk_size == 0 || chunk_size > max_chunk_size)
+                throw std::runtime_error(FMT("Invalid chunk size: {}.", chunk_size));
+
+            while (source.MoreData())
+            {
+                Chunk &chunk = chunks.emplace_back();
+                chunk.offset = total_size;
+                chunk.size = source.ReadLittle<std::uint32_t>();
+                chunk.compressed_size = source.ReadLittle<std::uint32_t>();
+                chunk.compressed_offset = source.Position();
+                if (chunk.size == 0 || chunk.size > chunk_size)
+                    throw std::runtime_error(FMT("Invalid size of chunk #{}: {}.", chunks.size() - 1, chunk.size));
+                source.Skip(chunk.compressed_size);
+                total_size += chunk.size;
+            }
+        }
+        catch (std::exception &e)
+        {
+            throw std::runtime_error(FMT("{}{}", source.GetExceptionPrefix(), e.what()));
+        }
+
+        auto read = [source = std::move(source), codec, chunks = std::move(chunks), compressed = std::vector<uint8_t>{}, cached = std::vector<uint8_t>{}, cached_index = std::size_t(-1)]
+            (Stream::Input &stream, std::size_t offset, std::size_t size, uint8_t *dst) mutable
+        {
+            // Decompresses a chunk to `dst`, which must have the right size.
+            auto UncompressChunk = [&](std::size_t index, uint8_t *dst)
+            {
+                const Chunk &chunk = chunks[index];
+                const uint8_t *src = source.ContiguousData();
+                if (src)
+                {
+                    src += chunk.compressed_offset;
+                }
+                else
+                {
+                    compressed.resize(chunk.compressed_size);
+                    source.Seek(chunk.compressed_offset, Stream::absolute);
+                    source.Read(compressed.data(), compressed.size());
+                    src = compressed.data();
+                }
+
+                try
+                {
+                    Uncompress(codec, src, src + chunk.compressed_size, dst, dst + chunk.size);
+                }
+                catch (std::exception &e)
+                {
+                    throw std::runtime_error(FMT("{}In chunk #{}: {}", stream.GetExceptionPrefix(), index, e.what()));
+                }
+            };
+
+            // The last chunk that starts at or before `offset`.
+            std::size_t index = std::upper_bound(chunks.begin(), chunks.end(), offset, [](std::size_t offset, const Chunk &chunk){return offset < chunk.offset;}) - chunks.begin() - 1;
+
+            while (size > 0)
+            {
+                const Chunk &chunk = chunks[index];
+                std::size_t offset_in_chunk = offset - chunk.offset;
+                std::size_t this_size = std::min(size, chunk.size - offset_in_chunk);
+
+                if (this_size == chunk.size)
+                {
+                    // The whole chunk is needed, decompress it in place.
+                    UncompressChunk(index, dst);
+                }
+                else
+                {
+                    if (cached_index != index)
+                    {
+                        cached.resize(chunk.size);
+                        cached_index = std::size_t(-1); // In case this throws.
+                        UncompressChunk(index, cached.data());
+                        cached_index = index;
+                    }
+                    std::copy_n(cached.data() + offset_in_chunk, this_size, dst);
+                }
+
+                offset += this_size;
+                size -= this_size;
+                dst += this_size;
+                index++;
+            }
+        };
+
+        return Stream::Input(std::move(name), total_size, Meta::fake_copyable(std::move(read)), Stream::capacity_t(chunk_size));
+    }
 }
@@ -2,14 +2,30 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string_view>
+
+#include "program/platform.h"
+
+// Those are only used by the chunked streams below. We can't include the headers, since they include this one.
+namespace Stream
+{
+    class Input;
+    class Output;
+}
 
 namespace Archive
 {
     namespace Raw // Those are thin wrappers around zlib.
     {
+        enum class Format
+        {
+            zlib, // Zlib header and checksum. This is what `Compress()` produces.
+            gzip, // Gzip header and checksum, as in `.gz` files.
+        };
+
         [[nodiscard]] std::size_t MaxCompressedSize(const uint8_t *src_begin, const uint8_t *src_end); // Determines max destination buffer size.
         [[nodiscard]] uint8_t *Compress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end); // Compresses and returns compressed data end. Throws on failure.
-        void Uncompress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end); // Decompresses. Throws on failure. Also throws if buffer is too large.
+        void Uncompress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end, Format format = Format::zlib); // Decompresses. Throws on failure. Also throws if buffer is too large.
     }
 
     // Those functions prefix compressed data with size.
@@ -18,4 +34,37 @@ namespace Archive
     [[nodiscard]] uint8_t *Compress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end); // Compresses and returns compressed data end. Throws on failure.
     [[nodiscard]] std::size_t UncompressedSize(const uint8_t *src_begin, const uint8_t *src_end); // Extracts size from decompressed data. Throws on failure.
     void Uncompress(const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin); // Decompresses. Throws on failure. The buffer must have size returned by `UncompressedSize()`.
+
+
+    // Compression algorithms. The non-streaming functions above always use zlib.
+    enum class Codec : std::uint8_t
+    {
+        zlib, // Slow, with a decent ratio.
+        lz4, // Very fast, especially when decompressing, with a worse ratio. Good for assets loaded at runtime.
+        zstd, // Fast, with the best ratio. Good for snapshots and replays.
+    };
+    [[nodiscard]] std::string_view CodecName(Codec codec);
+    // Only zlib is always available. The other codecs need `IMP_PLATFORM_FLAG_extra_codecs`, otherwise the functions below throw when given them.
+    [[nodiscard]] constexpr bool CodecAvailable(Codec codec) {return codec == Codec::zlib || IMP_PLATFORM_IS(extra_codecs);}
+    // The fastest available codec to decompress. Good for assets loaded at runtime.
+    inline constexpr Codec fast_codec = CodecAvailable(Codec::lz4) ? Codec::lz4 : Codec::zlib;
+
+    // Those compress a single block of data, without storing its size.
+    [[nodiscard]] std::size_t MaxCompressedSize(Codec codec, std::size_t size); // Determines max destination buffer size.
+    [[nodiscard]] uint8_t *Compress(Codec codec, const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end); // Compresses and returns compressed data end. Throws on failure.
+    void Uncompress(Codec codec, const uint8_t *src_begin, const uint8_t *src_end, uint8_t *dst_begin, uint8_t *dst_end); // Decompresses. Throws on failure, or if the buffer size doesn't match the data.
+
+    // Chunked streams. The data is split into chunks that are compressed independently, so the whole thing never needs to be in memory,
+    // and `UncompressingInput()` can seek without decompressing everything before the cursor.
+    // The format is: "IMPZ", the codec (1 byte), the chunk size (4 bytes), then the chunks: the uncompressed size (4 bytes), the compressed size (4 bytes) and the data.
+    // The numbers are little-endian. The chunks are smaller than the chunk size if the stream was flushed before filling them.
+
+    inline constexpr std::size_t default_chunk_size = 1 << 16;
+
+    // Returns a stream that compresses everything written to it and writes the result to `target`.
+    // The header is written immediately. Flushing the returned stream also flushes `target`.
+    [[nodiscard]] Stream::Output CompressingOutput(Stream::Output target, Codec codec, std::size_t chunk_size = default_chunk_size);
+    // Returns a stream that decompresses `source`, which must contain data written by `CompressingOutput()`.
+    // Reads all the chunk headers immediately. The last decompressed chunk is cached, and if `source` is based on a `ReadOnlyData`, the compressed data isn't copied.
+    [[nodiscard]] Stream::Input UncompressingInput(Stream::Input source);
 }
@@ -0,0 +1,212 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if IMP_PLATFORM_IS(linux)
+#include <cerrno>
+#include <climits>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "strings/format.h"
+
+namespace Filesystem
+{
+    struct FileWatcher::State
+    {
+        std::vector<std::string> dirs; // With trailing slashes.
+
+        // The polling backend.
+        struct FileStamp
+        {
+            std::filesystem::file_time_type time;
+            std::uintmax_t size = 0;
+            friend bool operator==(const FileStamp &, const FileStamp &) = default;
+        };
+        std::map<std::string, FileStamp> stamps;
+        std::chrono::milliseconds poll_interval{};
+        std::chrono::steady_clock::time_point last_poll{};
+
+        // The inotify backend. If `fd` is -1, polling is used.
+        int fd = -1;
+        std::map<int, std::size_t> watch_to_dir; // Watch descriptors to indices in `dirs`.
+
+        State() {}
+        State(const State &) = delete;
+        State &operator=(const State &) = delete;
+
+        ~State()
+        {
+            #if IMP_PLATFORM_IS(linux)
+            if (fd != -1)
+                close(fd);
+            #endif
+        }
+
+        // Scans the directories, and returns the files that changed since the previous scan.
+        std::vector<std::string> Rescan()
+        {
+            std::vector<std::string> ret;
+            std::map<std::string, FileStamp> new_stamps;
+
+            for (const std::string &dir : dirs)
+            {
+                std::error_code ec;
+                for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+                {
+                    if (!entry.is_regular_file(ec))
+                        continue;
+
+                    FileStamp stamp;
+                    stamp.time = entry.last_write_time(ec);
+                    if (ec)
+                        continue; // The file was probably just removed.
+                    stamp.size = entry.file_size(ec);
+                    if (ec)
+                        continue;
+
+                    std::string path = dir + entry.path().filename().string();
+                    auto it = stamps.find(path);
+                    if (it == stamps.end() || it->second != stamp)
+                        ret.push_back(path);
+                    new_stamps.try_emplace(std::move(path), stamp);
+                }
+            }
+
+            stamps = std::move(new_stamps);
+            return ret;
+        }
+
+        #if IMP_PLATFORM_IS(linux)
+        bool InitInotify()
+        {
+            fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd == -1)
+                return false;
+
+            for (std::size_t i = 0; i < dirs.size(); i++)
+            {
+                int watch = inotify_add_watch(fd, dirs[i].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (watch == -1)
+                {
+                    // Most likely the directory doesn't exist. Let the polling backend report the error.
+                    close(fd);
+                    fd = -1;
+                    watch_to_dir.clear();
+                    return false;
+                }
+                watch_to_dir.try_emplace(watch, i);
+            }
+
+            return true;
+        }
+
+        std::vector<std::string> ReadInotifyEvents()
+        {
+            std::vector<std::string> ret;
+
+            alignas(inotify_event) char buffer[sizeof(inotify_event) + NAME_MAX + 1];
+            while (true)
+            {
+                ssize_t len = read(fd, buffer, sizeof buffer);
+                if (len <= 0)
+                {
+                    if (len < 0 && errno == EINTR)
+                        continue;
+                    break; // `EAGAIN` means there are no more events.
+                }
+
+                for (ssize_t pos = 0; pos < len;)
+                {
+                    const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + pos);
+                    pos += sizeof(inotify_event) + event->len;
+
+                    if (event->len == 0 || (event->mask & IN_ISDIR))
+                        continue;
+                    auto it = watch_to_dir.find(event->wd);
+                    if (it == watch_to_dir.end())
+                        continue;
+                    ret.push_back(dirs[it->second] + event->name);
+                }
+            }
+
+            return ret;
+        }
+        #endif
+    };
+
+    FileWatcher::FileWatcher() {}
+
+    FileWatcher::FileWatcher(std::vector<std::string> dirs, Backend backend, std::chrono::milliseconds poll_interval)
+        : state(std::make_unique<State>())
+    {
+        for (std::string &dir : dirs)
+        {
+            if (!dir.empty() && !dir.ends_with('/'))
+                dir += '/';
+        }
+        state->dirs = std::move(dirs);
+        state->poll_interval = poll_interval;
+
+        #if IMP_PLATFORM_IS(linux)
+        if (backend == Backend::automatic && state->InitInotify())
+            return;
+        #else
+        (void)backend;
+        #endif
+
+        for (const std::string &dir : state->dirs)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_directory(dir, ec))
+                throw std::runtime_error(FMT("Unable to watch directory `{}`.", dir));
+        }
+
+        (void)state->Rescan();
+        state->last_poll = std::chrono::steady_clock::now();
+    }
+
+    FileWatcher::FileWatcher(FileWatcher &&) noexcept = default;
+    FileWatcher &FileWatcher::operator=(FileWatcher &&) noexcept = default;
+    FileWatcher::~FileWatcher() = default;
+
+    bool FileWatcher::IsPolling() const
+    {
+        return state && state->fd == -1;
+    }
+
+    std::vector<std::string> FileWatcher::Poll()
+    {
+        if (!state)
+            return {};
+
+        std::vector<std::string> ret;
+
+        #if IMP_PLATFORM_IS(linux)
+        if (state->fd != -1)
+        {
+            ret = state->ReadInotifyEvents();
+        }
+        else
+        #endif
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now - state->last_poll < state->poll_interval)
+                return {};
+            state->last_poll = now;
+            ret = state->Rescan();
+        }
+
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Filesystem
+{
+    // Reports the files that were modified or created in a set of directories. Nested directories are not watched.
+    // Uses inotify on Linux, and polls the modification times elsewhere (or if inotify is unavailable).
+    class FileWatcher
+    {
+        struct State;
+        std::unique_ptr<State> state;
+
+      public:
+        enum class Backend
+        {
+            automatic, // inotify if available, otherwise polling.
+            polling,
+        };
+
+        FileWatcher();
+        // Throws if a directory can't be watched.
+        // `poll_interval` is only used by the polling backend, and limits how often `Poll()` actually rescans the directories.
+        FileWatcher(std::vector<std::string> dirs, Backend backend = Backend::automatic, std::chrono::milliseconds poll_interval = std::chrono::milliseconds(250));
+        FileWatcher(FileWatcher &&other) noexcept;
+        FileWatcher &operator=(FileWatcher &&other) noexcept;
+        ~FileWatcher();
+
+        [[nodiscard]] explicit operator bool() const {return bool(state);}
+
+        // Whether the polling backend is used.
+        [[nodiscard]] bool IsPolling() const;
+
+        // Returns the files that changed since the last call, sorted and without duplicates.
+        // Each path is the directory as passed to the constructor (with a trailing slash added if missing), followed by the file name.
+        // Doesn't block. Deleted files are not reported.
+        [[nodiscard]] std::vector<std::string> Poll();
+    };
+}
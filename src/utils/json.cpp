@@ -1,366 +1,525 @@
 #include "json.h"
 
+#include <algorithm>
+#include <charconv>
 #include <cstring>
 #include <limits>
+#include <numeric>
 #include <ostream>
+#include <vector>
 
 #include "strings/format.h"
 #include "strings/symbol_position.h"
 
-void Json::ParseSkipWhitespace(const char *&cur)
+struct Json::Parser
 {
-    while (*cur > '\0' && *cur <= ' ')
-        cur++;
-}
+    Storage::MonotonicPool &arena;
+    const char *cur = nullptr;
 
-std::string Json::ParseStringLow(const char *&cur)
-{
-    ParseSkipWhitespace(cur);
+    // The elements of the arrays and objects that are being parsed. They're moved to the arena when the array or object is complete,
+    // so that the elements of each one are contiguous.
+    std::vector<Node> element_stack;
+    std::vector<std::string_view> key_stack;
+    std::vector<std::uint32_t> sort_order; // Scratch space for sorting the object keys.
 
-    if (*cur != '"')
-        throw std::runtime_error("Expected `\"`.");
-    cur++;
+    Parser(Storage::MonotonicPool &arena, const char *cur) : arena(arena), cur(cur) {}
 
-    const char *begin = cur;
-    bool backslash_preceding = false;
+    void SkipWhitespace()
+    {
+        while (*cur > '\0' && *cur <= ' ')
+            cur++;
+    }
 
-    while (true)
+    // Returns a view into the source data if the string has no escape sequences, otherwise unescapes it into the arena.
+    std::string_view ParseString()
     {
-        // Stop on `"`.
-        if (*cur == '"' && !backslash_preceding)
-            break;
+        SkipWhitespace();
 
-        // Handle `\`.
-        backslash_preceding = (*cur == '\\' && !backslash_preceding);
+        if (*cur != '"')
+            throw std::runtime_error("Expected `\"`.");
+        cur++;
+
+        const char *begin = cur;
+        bool backslash_preceding = false;
+        bool has_escapes = false;
 
-        // Error if no more data.
-        if (*cur == '\0')
+        while (true)
         {
-            cur = begin; // We do this to get a better error message.
-            throw std::runtime_error("This string lacks a terminating `\"` character.");
-        }
+            // Stop on `"`.
+            if (*cur == '"' && !backslash_preceding)
+                break;
 
-        // Error on non-printable character.
-        if (*cur > '\0' && *cur < ' ')
-            throw std::runtime_error(STR("Invalid character in a string: 0x", ((unsigned char)*cur)"02x", "."));
+            // Handle `\`.
+            backslash_preceding = (*cur == '\\' && !backslash_preceding);
+            has_escapes |= backslash_preceding;
 
-        cur++;
-    }
+            // Error if no more data.
+            if (*cur == '\0')
+            {
+                cur = begin; // We do this to get a better error message.
+                throw std::runtime_error("This string lacks a terminating `\"` character.");
+            }
 
-    const char *end = cur;
+            // Error on non-printable character.
+            if (*cur > '\0' && *cur < ' ')
+                throw std::runtime_error(STR("Invalid character in a string: 0x", ((unsigned char)*cur)"02x", "."));
 
-    std::string ret;
-    for (cur = begin; cur != end; cur++)
-    {
-        if (*cur != '\\')
-        {
-            ret += *cur;
+            cur++;
         }
-        else
+
+        const char *end = cur;
+        cur++; // Skip the `"`.
+
+        if (!has_escapes)
+            return std::string_view(begin, end);
+
+        // The unescaped string is never longer than the escaped one.
+        char *const ret_begin = reinterpret_cast<char *>(arena.AllocateRawMemory(end - begin));
+        char *ret = ret_begin;
+
+        for (const char *ch = begin; ch != end; ch++)
         {
-            cur++;
-            if (cur == end)
+            if (*ch != '\\')
+            {
+                *ret++ = *ch;
+                continue;
+            }
+
+            ch++;
+            if (ch == end)
                 throw std::runtime_error("Expected an escape character before `\"`.");
-            switch (*cur)
+            switch (*ch)
             {
               case '\\':
               case '/':
               case '"':
-                ret += *cur;
+                *ret++ = *ch;
                 break;
               case 'b':
-                ret += '\b';
+                *ret++ = '\b';
                 break;
               case 'f':
-                ret += '\f';
+                *ret++ = '\f';
                 break;
               case 'n':
-                ret += '\n';
+                *ret++ = '\n';
                 break;
               case 'r':
-                ret += '\r';
+                *ret++ = '\r';
                 break;
               case 't':
-                ret += '\t';
+                *ret++ = '\t';
                 break;
               case 'u':
                 {
-                    cur++;
-                    if (end - cur < 4)
+                    ch++;
+                    if (end - ch < 4)
                         throw std::runtime_error("Expected four hex digits after `\\u`.");
                     int value = 0;
                     for (int i = 0; i < 4; i++)
                     {
                         int digit;
-                        if (*cur >= '0' && *cur <= '9')
-                            digit = *cur - '0';
-                        else if (*cur >= 'a' && *cur <= 'f')
-                            digit = *cur - 'a' + 10;
-                        else if (*cur >= 'A' && *cur <= 'F')
-                            digit = *cur - 'A' + 10;
+                        if (*ch >= '0' && *ch <= '9')
+                            digit = *ch - '0';
+                        else if (*ch >= 'a' && *ch <= 'f')
+                            digit = *ch - 'a' + 10;
+                        else if (*ch >= 'A' && *ch <= 'F')
+                            digit = *ch - 'A' + 10;
                         else
                             throw std::runtime_error("Expected four hex digits after `\\u`.");
                         value = value * 16 + digit;
-                        cur++;
+                        ch++;
                     }
                     if (value < 128)
                     {
-                        ret += char(value);
+                        *ret++ = char(value);
                     }
                     else if (value < 2048) // 2048 = 2^11
                     {
-                        ret += char(0b1100'0000 + (value >> 6));
-                        ret += char(0b1000'0000 + (value & 0b0011'1111));
+                        *ret++ = char(0b1100'0000 + (value >> 6));
+                        *ret++ = char(0b1000'0000 + (value & 0b0011'1111));
                     }
                     else
                     {
-                        ret += char(0b1110'0000 + (value >> 12));
-                        ret += char(0b1000'0000 + ((value >> 6) & 0b0011'1111));
-                        ret += char(0b1000'0000 + (value & 0b0011'1111));
+                        *ret++ = char(0b1110'0000 + (value >> 12));
+                        *ret++ = char(0b1000'0000 + ((value >> 6) & 0b0011'1111));
+                        *ret++ = char(0b1000'0000 + (value & 0b0011'1111));
                     }
-                    cur--; // This is needed because of the auto increment at the end of loop.
+                    ch--; // This is needed because of the auto increment at the end of loop.
                 }
+                break;
             }
         }
-    }
 
-    cur++; // Skip the `"`.
-    return ret;
-}
-
-Json Json::ParseLow(const char *&cur, int allowed_depth)
-{
-    if (allowed_depth < 0)
-        throw std::runtime_error("Too many nested elements.");
+        return std::string_view(ret_begin, ret);
+    }
 
-    auto TryGetString = [&](std::string string) -> bool
+    // Copies the elements from the top of `element_stack` to the arena.
+    const Node *MoveElementsToArena(std::size_t stack_pos, std::size_t count)
     {
-        if (std::strncmp(string.c_str(), cur, string.size()) == 0)
-        {
-            cur += string.size();
-            return true;
-        }
-        else
-        {
-            return false;
-        }
-    };
-
-    ParseSkipWhitespace(cur);
+        if (count == 0)
+            return nullptr;
+        // `Node` is trivially copyable, so we don't need to default-construct the elements first.
+        Node *ret = reinterpret_cast<Node *>(arena.AllocateRawMemory<alignof(Node)>(sizeof(Node) * count));
+        std::memcpy(ret, element_stack.data() + stack_pos, sizeof(Node) * count);
+        return ret;
+    }
 
-    switch (*cur)
+    Node ParseValue(int allowed_depth)
     {
-      case 'n': // null
-        if (TryGetString("null"))
-            return FromVariant(std::monostate{});
-        break;
-
-      case 'f': // boolean, false
-        if (TryGetString("false"))
-            return FromVariant(false);
-        break;
+        if (allowed_depth < 0)
+            throw std::runtime_error("Too many nested elements.");
 
-      case 't': // boolean, true
-        if (TryGetString("true"))
-            return FromVariant(true);
-        break;
-
-      default: // number
+        auto TryGetString = [&](std::string_view string) -> bool
         {
-            std::string str;
-            bool real = false;
-
-            if (*cur == '-')
+            if (std::strncmp(string.data(), cur, string.size()) == 0)
             {
-                str += '-';
-                cur++;
+                cur += string.size();
+                return true;
             }
+            else
+            {
+                return false;
+            }
+        };
 
-            while (*cur >= '0' && *cur <= '9')
-                str += *cur++;
+        SkipWhitespace();
 
-            if (str.empty())
-                break;
+        switch (*cur)
+        {
+          case 'n': // null
+            if (TryGetString("null"))
+                return {.type = null};
+            break;
 
-            if (*cur == '.')
+          case 'f': // boolean, false
+            if (TryGetString("false"))
+                return {.type = boolean, .size = 0};
+            break;
+
+          case 't': // boolean, true
+            if (TryGetString("true"))
+                return {.type = boolean, .size = 1};
+            break;
+
+          default: // number
             {
-                cur++;
+                // Only validate the number here, it's parsed when accessed.
+                const char *begin = cur;
+                bool real = false;
 
-                real = true;
-                str += '.';
+                if (*cur == '-')
+                    cur++;
 
+                const char *digits_begin = cur;
                 while (*cur >= '0' && *cur <= '9')
-                    str += *cur++;
+                    cur++;
 
-                if (str.back() == '.')
-                    throw std::runtime_error("Expected a digit after decimal point.");
-            }
+                if (cur == digits_begin)
+                {
+                    if (cur == begin)
+                        break;
+                    throw std::runtime_error("Unable to parse a number.");
+                }
 
-            if (*cur == 'e' || *cur == 'E')
-            {
-                cur++;
+                if (*cur == '.')
+                {
+                    cur++;
+                    real = true;
 
-                real = true;
-                str += 'e';
+                    if (!(*cur >= '0' && *cur <= '9'))
+                        throw std::runtime_error("Expected a digit after decimal point.");
+                    while (*cur >= '0' && *cur <= '9')
+                        cur++;
+                }
 
-                if (*cur == '+' || *cur == '-')
-                    str += *cur++;
+                if (*cur == 'e' || *cur == 'E')
+                {
+                    cur++;
+                    real = true;
 
-                while (*cur >= '0' && *cur <= '9')
-                    str += *cur++;
+                    if (*cur == '+' || *cur == '-')
+                        cur++;
+
+                    if (!(*cur >= '0' && *cur <= '9'))
+                        throw std::runtime_error("Expected a digit after `e`, possibly after a sign.");
+                    while (*cur >= '0' && *cur <= '9')
+                        cur++;
+                }
 
-                if (str.back() == 'e' || str.back() == '+' || str.back() == '-')
-                    throw std::runtime_error("Expected a digit after `e`, possibly after a sign.");
+                return {.type = real ? num_real : num_int, .size = std::uint32_t(cur - begin), .data = begin};
             }
+            break;
 
-            if (real)
+          case '"': // string
             {
-                char *end = 0;
-                double num = std::strtod(str.c_str(), &end);
-                if (end == str.c_str())
-                    throw std::runtime_error("Unable to parse a number.");
-
-                return FromVariant(num);
+                std::string_view str = ParseString();
+                return {.type = string, .size = std::uint32_t(str.size()), .data = str.data()};
             }
-            else
+            break;
+
+          case '[': // array
             {
-                char *end = 0;
-                long num = std::strtol(str.c_str(), &end, 10);
-                if (end == str.c_str())
-                    throw std::runtime_error("Unable to parse a number.");
+                const char *begin = cur;
+                cur++; // Skip `[`.
 
-                if constexpr (sizeof(int) < sizeof(long))
-                    if (num < std::numeric_limits<int>::min() || num > std::numeric_limits<int>::max())
-                        throw std::runtime_error("Overflow in integral constant.");
+                std::size_t stack_pos = element_stack.size();
 
-                return FromVariant(int(num));
-            }
-        }
-        break;
+                bool first = true;
+                while (true)
+                {
+                    SkipWhitespace();
 
-      case '"': // string
-        return FromVariant(ParseStringLow(cur));
-        break;
+                    if (*cur == ']')
+                        break;
 
-      case '[': // array
-        {
-            const char *begin = cur;
-            cur++; // Skip `[`.
+                    if (first)
+                    {
+                        first = false;
+                    }
+                    else
+                    {
+                        if (*cur != ',')
+                            throw std::runtime_error("Expected `,`.");
+                        cur++;
+                        SkipWhitespace();
 
-            array_t vec;
+                        if (*cur == ']')
+                            break;
+                    }
 
-            bool first = true;
-            while (true)
+                    if (*cur == '\0')
+                    {
+                        cur = begin; // We do this to get a better error message.
+                        throw std::runtime_error("This array lacks a terminating `]` character.");
+                    }
+
+                    Node elem = ParseValue(allowed_depth-1);
+                    element_stack.push_back(elem);
+                }
+
+                cur++; // Skip `]`.
+
+                std::size_t count = element_stack.size() - stack_pos;
+                Node ret = {.type = array, .size = std::uint32_t(count), .data = MoveElementsToArena(stack_pos, count)};
+                element_stack.resize(stack_pos);
+                return ret;
+            }
+            break;
+
+          case '{': // object
             {
-                ParseSkipWhitespace(cur);
+                const char *begin = cur;
+                cur++; // Skip `{`.
 
-                if (*cur == ']')
-                    break;
+                std::size_t stack_pos = element_stack.size();
+                std::size_t key_stack_pos = key_stack.size();
 
-                if (first)
+                bool first = true;
+                while (true)
                 {
-                    first = false;
-                }
-                else
-                {
-                    if (*cur != ',')
-                        throw std::runtime_error("Expected `,`.");
-                    cur++;
-                    ParseSkipWhitespace(cur);
+                    SkipWhitespace();
 
-                    if (*cur == ']')
+                    if (*cur == '}')
                         break;
-                }
 
-                if (*cur == '\0')
-                {
-                    cur = begin; // We do this to get a better error message.
-                    throw std::runtime_error("This array lacks a terminating `]` character.");
-                }
+                    if (first)
+                    {
+                        first = false;
+                    }
+                    else
+                    {
+                        if (*cur != ',')
+                            throw std::runtime_error("Expected `,`.");
+                        cur++;
+                        SkipWhitespace();
 
-                vec.push_back(ParseLow(cur, allowed_depth-1));
-            }
+                        if (*cur == '}')
+                            break;
+                    }
 
-            cur++; // Skip `]`.
-            return FromVariant(std::move(vec));
-        }
-        break;
+                    if (*cur == '\0')
+                    {
+                        cur = begin; // We do this to get a better error message.
+                        throw std::runtime_error("This object lacks a terminating `}` character.");
+                    }
 
-      case '{': // object
-        {
-            const char *begin = cur;
-            cur++; // Skip `{`.
+                    key_stack.push_back(ParseString());
 
-            object_t map;
+                    SkipWhitespace();
 
-            bool first = true;
-            while (true)
-            {
-                ParseSkipWhitespace(cur);
+                    if (*cur != ':')
+                        throw std::runtime_error("Expected `:`.");
+                    cur++;
 
-                if (*cur == '}')
-                    break;
+                    // No need to skip whitespace here, nested ParseValue() will do that.
 
-                if (first)
-                {
-                    first = false;
+                    Node elem = ParseValue(allowed_depth-1);
+                    element_stack.push_back(elem);
                 }
-                else
-                {
-                    if (*cur != ',')
-                        throw std::runtime_error("Expected `,`.");
-                    cur++;
-                    ParseSkipWhitespace(cur);
 
-                    if (*cur == '}')
-                        break;
-                }
+                cur++; // Skip `}`.
+
+                // Sort the keys. For duplicate keys, the first one wins.
+                std::size_t count = element_stack.size() - stack_pos;
+                sort_order.resize(count);
+                std::iota(sort_order.begin(), sort_order.end(), std::uint32_t(0));
+                std::stable_sort(sort_order.begin(), sort_order.end(), [&](std::uint32_t a, std::uint32_t b)
+                {
+                    return key_stack[key_stack_pos + a] < key_stack[key_stack_pos + b];
+                });
+                sort_order.erase(std::unique(sort_order.begin(), sort_order.end(), [&](std::uint32_t a, std::uint32_t b)
+                {
+                    return key_stack[key_stack_pos + a] == key_stack[key_stack_pos + b];
+                }), sort_order.end());
+                count = sort_order.size();
 
-                if (*cur == '\0')
+                Node ret = {.type = object, .size = std::uint32_t(count)};
+                if (count > 0)
                 {
-                    cur = begin; // We do this to get a better error message.
-                    throw std::runtime_error("This array lacks a terminating `]` character.");
+                    static_assert(alignof(Node) >= alignof(std::string_view) && sizeof(Node) % alignof(std::string_view) == 0);
+                    std::uint8_t *memory = arena.AllocateRawMemory<alignof(Node)>((sizeof(Node) + sizeof(std::string_view)) * count);
+                    Node *elements = reinterpret_cast<Node *>(memory);
+                    std::string_view *keys = reinterpret_cast<std::string_view *>(elements + count);
+                    for (std::size_t i = 0; i < count; i++)
+                    {
+                        ::new((void *)(elements + i)) Node(element_stack[stack_pos + sort_order[i]]);
+                        ::new((void *)(keys + i)) std::string_view(key_stack[key_stack_pos + sort_order[i]]);
+                    }
+                    ret.data = elements;
                 }
 
-                std::string name = ParseStringLow(cur);
+                element_stack.resize(stack_pos);
+                key_stack.resize(key_stack_pos);
+                return ret;
+            }
+            break;
+        }
 
-                ParseSkipWhitespace(cur);
+        throw std::runtime_error("Unknown entity.");
+    }
+};
 
-                if (*cur != ':')
-                    throw std::runtime_error("Expected `:`.");
-                cur++;
+Json::Json(const char *string, int allowed_depth)
+    : Json(Stream::ReadOnlyData::mem_copy(string, string + std::strlen(string)), allowed_depth)
+{}
 
-                // No need to skip whitespace here, nested ParseLow() will do that.
+Json::Json(Stream::ReadOnlyData data, int allowed_depth)
+    : source(std::move(data))
+{
+    if (source.size() > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("JSON parsing failed: the input is too large.");
 
-                map.insert({name, ParseLow(cur, allowed_depth-1)});
-            }
+    const char *begin = source.string();
 
-            cur++; // Skip `}`.
-            return FromVariant(std::move(map));
-        }
-        break;
+    // Every element except the root follows a `[`, `{`, or `,`, so this is an upper bound on the number of elements.
+    // It's larger if those appear in strings, but that's rare. This is much tighter than estimating from the source size,
+    // which matters on Windows, where even the untouched memory counts towards the commit charge.
+    std::size_t max_elements = 1;
+    for (std::size_t pos = 0; pos < source.size();)
+    {
+        // Counting in blocks into a byte lets the compiler vectorize this loop.
+        std::size_t block_end = std::min(pos + 255, source.size());
+        std::uint8_t block_count = 0;
+        for (; pos < block_end; pos++)
+            block_count += (begin[pos] == ',') + (begin[pos] == '[') + (begin[pos] == '{');
+        max_elements += block_count;
     }
 
-    throw std::runtime_error("Unknown entity.");
-}
+    // This is enough to never grow the arena, unless some strings need unescaping.
+    arena = Storage::MonotonicPool(max_elements * (sizeof(Node) + sizeof(std::string_view)));
 
-Json::Json(const char *string, int allowed_depth)
-{
-    const char *begin = string;
+    Parser parser(arena, begin);
+    parser.element_stack.reserve(std::min(max_elements, source.size() / 8)); // Growing this is surprisingly expensive because of the page faults.
     try
     {
-        *this = ParseLow(string, allowed_depth);
-        ParseSkipWhitespace(string);
-        if (*string != '\0')
+        root = parser.ParseValue(allowed_depth);
+        parser.SkipWhitespace();
+        if (*parser.cur != '\0')
             throw std::runtime_error("Unexpected data after JSON.");
     }
     catch (std::exception &e)
     {
-        auto pos = Strings::GetSymbolPosition(begin, string);
+        auto pos = Strings::GetSymbolPosition(begin, parser.cur);
         throw std::runtime_error(FMT("JSON parsing failed, at {}: {}", pos.ToString(), e.what()));
     }
 }
 
+std::string Json::View::Path() const
+{
+    std::string ret;
+    if (!json)
+        return ret;
+
+    // Search the document for our node.
+    auto Find = [&](auto &Find, const Node &cur) -> bool
+    {
+        if (&cur == node)
+            return true;
+        if (cur.type != array && cur.type != object)
+            return false;
+
+        for (std::uint32_t i = 0; i < cur.size; i++)
+        {
+            std::size_t old_size = ret.size();
+            if (cur.type == array)
+            {
+                ret += '[';
+                ret += std::to_string(i);
+                ret += ']';
+            }
+            else
+            {
+                if (!ret.empty())
+                    ret += '.';
+                ret += cur.Keys()[i];
+            }
+
+            if (Find(Find, cur.Elements()[i]))
+                return true;
+            ret.resize(old_size);
+        }
+        return false;
+    };
+    (void)Find(Find, json->root);
+
+    return ret;
+}
+
+int Json::View::FindKey(std::string_view key) const
+{
+    if (!IsObject())
+        ThrowExpectedType("an object");
+    const std::string_view *keys_begin = node->Keys();
+    const std::string_view *keys_end = keys_begin + node->size;
+    const std::string_view *it = std::lower_bound(keys_begin, keys_end, key);
+    if (it == keys_end || *it != key)
+        return -1;
+    return int(it - keys_begin);
+}
+
+int Json::View::GetInt() const
+{
+    if (!IsInt())
+        ThrowExpectedType("an integer");
+    int ret = 0;
+    auto [ptr, ec] = std::from_chars(node->Text(), node->Text() + node->size, ret);
+    if (ec == std::errc::result_out_of_range)
+        throw std::runtime_error(FMT("Overflow in integral constant `{}`.", Path()));
+    return ret;
+}
+
+double Json::View::GetReal() const
+{
+    if (!IsReal())
+        ThrowExpectedType("a real number");
+    double ret = 0;
+    auto [ptr, ec] = std::from_chars(node->Text(), node->Text() + node->size, ret);
+    if (ec == std::errc::result_out_of_range)
+        throw std::runtime_error(FMT("Overflow in real constant `{}`.", Path()));
+    return ret;
+}
+
 void Json::View::DebugPrint(std::ostream &stream) const
 {
     switch (Type())
@@ -372,43 +531,36 @@ void Json::View::DebugPrint(std::ostream &stream) const
         stream << (GetBool() ? "true" : "false");
         break;
       case num_int:
-        stream << GetInt();
-        break;
       case num_real:
-        stream << GetReal();
+        stream << std::string_view(node->Text(), node->size);
         break;
       case string:
-        stream << '"' << GetString() << '"';
+        stream << '"' << GetStringView() << '"';
         break;
       case array:
         {
-            const array_t &obj = *std::get_if<int(array)>(&ptr->variant);
             bool first = true;
             stream << '[';
-            for (const auto &it : obj)
+            ForEachArrayElement([&](const View &elem)
             {
                 if (first)
                     first = false;
                 else
                     stream << ',';
-                it.GetView().DebugPrint(stream);
-            }
+                elem.DebugPrint(stream);
+            });
             stream << ']';
         }
         break;
       case object:
         {
-            const object_t &obj = *std::get_if<int(object)>(&ptr->variant);
-            bool first = true;
             stream << '{';
-            for (const auto &it : obj)
+            for (std::uint32_t i = 0; i < node->size; i++)
             {
-                if (first)
-                    first = false;
-                else
+                if (i > 0)
                     stream << ',';
-                stream << "\"" << it.first << "\":";
-                it.second.GetView().DebugPrint(stream);
+                stream << "\"" << node->Keys()[i] << "\":";
+                View(json, node->Elements() + i).DebugPrint(stream);
             }
             stream << '}';
         }
@@ -1,159 +1,137 @@
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
 #include <exception>
-#include <map>
 #include <string>
-#include <variant>
-#include <vector>
+#include <string_view>
 
+#include "stream/readonly_data.h"
 #include "strings/format.h"
+#include "utils/monotonic_pool.h"
 
+// An immutable JSON document.
+// All nodes are stored in a single arena. Strings and object keys point directly into the source data when possible,
+// so the source is kept alive by the document. Numbers are stored as text, and are parsed when accessed.
 class Json
 {
   public:
-    // Sync order with `variant_t`.
     enum type_t {null, boolean, num_int, num_real, string, array, object};
 
   private:
-    using array_t = std::vector<Json>;
-    using object_t = std::map<std::string, Json>;
-
-    // Sync order with `enum type_t`.
-    using variant_t = std::variant<
-        std::monostate, // type_t::null
-        bool,           // type_t::boolean
-        int,            // type_t::num_int
-        double,         // type_t::num_real
-        std::string,    // type_t::string
-        array_t,        // type_t::array
-        object_t        // type_t::object
-    >;
-
-    variant_t variant;
-
-    static Json FromVariant(const variant_t &var)
+    struct Node
     {
-        Json ret;
-        ret.variant = var;
-        return ret;
-    }
+        type_t type = null;
+        // The length of a string or a number, or the number of elements in an array or object, or 0/1 for booleans.
+        std::uint32_t size = 0;
+        // For strings and numbers, points to the text. For arrays and objects, points to the elements.
+        // For objects, the elements are followed by the same number of sorted keys, in the same order as the elements.
+        const void *data = nullptr;
+
+        [[nodiscard]] const char *Text() const {return static_cast<const char *>(data);}
+        [[nodiscard]] const Node *Elements() const {return static_cast<const Node *>(data);}
+        [[nodiscard]] const std::string_view *Keys() const {return reinterpret_cast<const std::string_view *>(Elements() + size);}
+    };
 
-    static void ParseSkipWhitespace(const char *&cur);
-    static std::string ParseStringLow(const char *&cur);
-    static Json ParseLow(const char *&cur, int allowed_depth);
+    struct Parser;
+
+    Stream::ReadOnlyData source;
+    Storage::MonotonicPool arena;
+    Node root;
 
   public:
     Json() {}
+    // Copies the string.
     Json(const char *string, int allowed_depth);
+    // Doesn't copy the data, unless it's not null-terminated.
+    Json(Stream::ReadOnlyData data, int allowed_depth);
+
+    Json(Json &&) = default;
+    Json &operator=(Json &&) = default;
 
     class View
     {
-        const Json *ptr = 0;
-        std::string path;
+        const Json *json = nullptr;
+        const Node *node = nullptr;
 
-        void ThrowExpectedType(std::string type) const
-        {
-            throw std::runtime_error(FMT("Expected JSON element `{}` to be {}.", path, type));
-        }
+        View(const Json *json, const Node *node) : json(json), node(node) {}
 
-        std::string AppendElementIndexToPath(int index) const
-        {
-            std::string ret = path;
-            ret += '[';
-            ret += std::to_string(index);
-            ret += ']';
-            return ret;
-        }
-        std::string AppendElementNameToPath(std::string name) const
+        // Returns the path to this element, e.g. `foo.bar[42]`. This is slow, and is only used in error messages.
+        [[nodiscard]] std::string Path() const;
+
+        [[noreturn]] void ThrowExpectedType(std::string_view type) const
         {
-            if (path.empty())
-                return name;
-            std::string ret = path;
-            ret += '.';
-            ret += name;
-            return ret;
+            throw std::runtime_error(FMT("Expected JSON element `{}` to be {}.", Path(), type));
         }
+
+        // Returns the index of the key, or -1 if not found.
+        [[nodiscard]] int FindKey(std::string_view key) const;
+
       public:
         View() {}
 
-        // Passed object has to remain alive.
-        View(const Json &json, std::string name = "") : ptr(&json), path(std::move(name)) {}
-        View(Json &&, std::string = "") = delete;
+        // Passed object has to remain alive, and must not be moved.
+        View(const Json &json) : json(&json), node(&json.root) {}
+        View(Json &&) = delete;
 
         explicit operator bool() const
         {
-            return bool(ptr);
-        }
-
-        const Json &Target() const
-        {
-            return *ptr;
+            return bool(node);
         }
 
         type_t Type() const
         {
-            return type_t(ptr->variant.index());
+            return node->type;
         }
 
-        bool IsNull()   const {return !ptr || Type() == null;}
-        bool IsBool()   const {return ptr && Type() == boolean;}
-        bool IsInt()    const {return ptr && Type() == num_int;}
-        bool IsReal()   const {return ptr && (Type() == num_real || IsInt());}
-        bool IsString() const {return ptr && Type() == string;}
-        bool IsArray()  const {return ptr && Type() == array;}
-        bool IsObject() const {return ptr && Type() == object;}
+        bool IsNull()   const {return !node || Type() == null;}
+        bool IsBool()   const {return node && Type() == boolean;}
+        bool IsInt()    const {return node && Type() == num_int;}
+        bool IsReal()   const {return node && (Type() == num_real || IsInt());}
+        bool IsString() const {return node && Type() == string;}
+        bool IsArray()  const {return node && Type() == array;}
+        bool IsObject() const {return node && Type() == object;}
 
         bool GetBool() const
         {
             if (!IsBool())
                 ThrowExpectedType("a boolean");
-            return *std::get_if<int(boolean)>(&ptr->variant);
-        }
-        int GetInt() const
-        {
-            if (!IsInt())
-                ThrowExpectedType("an integer");
-            return *std::get_if<int(num_int)>(&ptr->variant);
+            return node->size;
         }
-        double GetReal() const
+        int GetInt() const;
+        double GetReal() const;
+        // Points into the document.
+        std::string_view GetStringView() const
         {
-            if (IsInt())
-                return GetInt();
-
-            if (!IsReal())
-                ThrowExpectedType("a real number");
-            return *std::get_if<int(num_real)>(&ptr->variant);
+            if (!IsString())
+                ThrowExpectedType("a string");
+            return std::string_view(node->Text(), node->size);
         }
         std::string GetString() const
         {
-            if (!IsString())
-                ThrowExpectedType("a string");
-            return *std::get_if<int(string)>(&ptr->variant);
+            return std::string(GetStringView());
         }
 
         int GetArraySize() const
         {
             if (!IsArray())
                 ThrowExpectedType("an array");
-            return std::get_if<int(array)>(&ptr->variant)->size();
+            return node->size;
         }
         View GetElement(int index) const
         {
             if (!IsArray())
                 ThrowExpectedType("an array");
-            const array_t &arr = *std::get_if<int(array)>(&ptr->variant);
-            if (index < 0 || decltype(arr.size())(index) >= arr.size())
-                throw std::runtime_error(FMT("Attempt to access element #{} of JSON object `{}`, but it only contains {} elements.", index, path, arr.size()));
-            return View(arr[index], AppendElementIndexToPath(index));
+            if (index < 0 || std::uint32_t(index) >= node->size)
+                throw std::runtime_error(FMT("Attempt to access element #{} of JSON object `{}`, but it only contains {} elements.", index, Path(), node->size));
+            return View(json, node->Elements() + index);
         }
         template <typename F> void ForEachArrayElement(F &&func) const // `func` should be `void func(const View &elem)`.
         {
             if (!IsArray())
                 ThrowExpectedType("an array");
-            const array_t &arr = *std::get_if<int(array)>(&ptr->variant);
-            for (array_t::size_type i = 0; i < arr.size(); i++)
-                func(View(arr[i], AppendElementIndexToPath(i)));
+            for (std::uint32_t i = 0; i < node->size; i++)
+                func(View(json, node->Elements() + i));
         }
         bool HasElement(int index) const
         {
@@ -164,33 +142,25 @@ class Json
         {
             if (!IsObject())
                 ThrowExpectedType("an object");
-            return std::get_if<int(object)>(&ptr->variant)->size();
+            return node->size;
         }
-        View GetElement(std::string key) const
+        View GetElement(std::string_view key) const
         {
-            if (!IsObject())
-                ThrowExpectedType("an object");
-            const object_t &obj = *std::get_if<int(object)>(&ptr->variant);
-            auto it = obj.find(key);
-            if (it == obj.end())
-                throw std::runtime_error(FMT("Attempt to access nonexistent element `{}` of JSON object `{}`.", key, path));
-            return View(it->second, AppendElementNameToPath(key));
+            int index = FindKey(key);
+            if (index == -1)
+                throw std::runtime_error(FMT("Attempt to access nonexistent element `{}` of JSON object `{}`.", key, Path()));
+            return View(json, node->Elements() + index);
         }
-        template <typename F> void ForEachObjectElement(F &&func) const // `func` should be `void func(const std::string &name, const View &elem)`.
+        template <typename F> void ForEachObjectElement(F &&func) const // `func` should be `void func(const View &elem)`. The elements are sorted by key.
         {
             if (!IsObject())
                 ThrowExpectedType("an object");
-            const object_t &obj = *std::get_if<int(object)>(&ptr->variant);
-            for (const auto &elem : obj)
-                func(View(elem.second, AppendElementNameToPath(elem.first)));
+            for (std::uint32_t i = 0; i < node->size; i++)
+                func(View(json, node->Elements() + i));
         }
-        bool HasElement(std::string key) const
+        bool HasElement(std::string_view key) const
         {
-            if (!IsObject())
-                ThrowExpectedType("an object");
-            const object_t &obj = *std::get_if<int(object)>(&ptr->variant);
-            auto it = obj.find(key);
-            return it != obj.end();
+            return FindKey(key) != -1;
         }
 
         View operator[](int index) const // Same as GetElement(int).
@@ -198,7 +168,7 @@ class Json
             return GetElement(index);
         }
 
-        View operator[](std::string key) const // Same as GetElement(std::string).
+        View operator[](std::string_view key) const // Same as GetElement(std::string_view).
         {
             return GetElement(key);
         }
@@ -1,52 +1,360 @@
 #include "packing.h"
 
 #include <algorithm>
+#include <iterator>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 #include <stb_rect_pack.h>
 
+#include "program/errors.h"
+#include "utils/parallel.h"
+
 namespace Packing
 {
     int PackRects(ivec2 target_size, Rect *data, int count, int inner_gaps, int outer_gaps)
     {
-        // Adjust size.
-        target_size -= 2 * outer_gaps;
-        target_size += inner_gaps;
+        return RectPacker(target_size, Heuristic::skyline_bottom_left, inner_gaps, outer_gaps).Add(data, count);
+    }
 
-        // Make rectangle vector.
-        std::vector<stbrp_rect> rects(count);
-        for (int i = 0; i < count; i++)
+    struct RectPacker::State
+    {
+        Heuristic heuristic{};
+        ivec2 padded_size; // The target size, adjusted for the gaps.
+        int inner_gaps = 0;
+        int outer_gaps = 0;
+        Stats stats;
+
+        // For the skyline heuristics.
+        std::unique_ptr<stbrp_node[]> nodes;
+        stbrp_context context{};
+
+        // For `max_rects`. The maximal free rectangles, none of them contains another one.
+        std::vector<irect2> free_rects;
+
+        State(ivec2 target_size, Heuristic heuristic, int inner_gaps, int outer_gaps)
+            : heuristic(heuristic), inner_gaps(inner_gaps), outer_gaps(outer_gaps)
         {
-            ivec2 rect_size = data[i].size + inner_gaps;
-            rects[i].w = rect_size.x;
-            rects[i].h = rect_size.y;
+            // Adjust size.
+            padded_size = target_size - 2 * outer_gaps + inner_gaps;
+            stats.size = target_size - 2 * outer_gaps;
+
+            if (heuristic == Heuristic::max_rects)
+            {
+                if ((padded_size > 0).all())
+                    free_rects.push_back(ivec2().rect_size(padded_size));
+            }
+            else
+            {
+                // Allocate a buffer.
+                // Comments on `stb_rect_pack` say we need the amount of elements equal to target width.
+                int buffer_size = std::max(padded_size.x, 1);
+                nodes = std::make_unique<stbrp_node[]>(buffer_size);
+
+                // Make a context. No cleanup is needed.
+                stbrp_init_target(&context, padded_size.x, padded_size.y, nodes.get(), buffer_size);
+                stbrp_setup_heuristic(&context, heuristic == Heuristic::skyline_best_fit ? STBRP_HEURISTIC_Skyline_BF_sortHeight : STBRP_HEURISTIC_Skyline_BL_sortHeight);
+            }
         }
 
-        // Allocate a buffer.
-        // Comments on `stb_rect_pack` say we need the amount of elements equal to target width.
-        int buffer_size = target_size.x;
-        auto packing_buffer = std::make_unique<stbrp_node[]>(buffer_size);
+        int AddSkyline(Rect *data, int count)
+        {
+            // Make rectangle vector.
+            std::vector<stbrp_rect> rects(count);
+            for (int i = 0; i < count; i++)
+            {
+                ivec2 rect_size = data[i].size + inner_gaps;
+                rects[i].w = rect_size.x;
+                rects[i].h = rect_size.y;
+            }
+
+            // Try packing.
+            bool ok = stbrp_pack_rects(&context, rects.data(), rects.size());
+
+            // Counts rectangles that weren't packed.
+            int rects_not_packed = 0;
+            if (!ok)
+                rects_not_packed = std::count_if(rects.begin(), rects.end(), [](const stbrp_rect &rect){return !rect.was_packed;});
+
+            // Output data.
+            for (int i = 0; i < count; i++)
+            {
+                data[i].pos = ivec2(rects[i].x, rects[i].y) + outer_gaps;
+                data[i].was_packed = rects[i].was_packed;
+            }
+
+            return rects_not_packed;
+        }
+
+        int AddMaxRects(Rect *data, int count)
+        {
+            // Pack the larger rectangles first.
+            std::vector<int> order(count);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+            {
+                return data[a].size.max() > data[b].size.max() || (data[a].size.max() == data[b].size.max() && data[a].size.min() > data[b].size.min());
+            });
+
+            int rects_not_packed = 0;
+            std::vector<irect2> new_free_rects;
+
+            for (int index : order)
+            {
+                Rect &rect = data[index];
+                ivec2 rect_size = rect.size + inner_gaps;
+
+                // Empty rectangles need no space, same as in `stb_rect_pack`.
+                if (rect_size.x <= 0 || rect_size.y <= 0)
+                {
+                    rect.pos = ivec2(outer_gaps);
+                    rect.was_packed = true;
+                    continue;
+                }
+
+                // Find the free rectangle with the smallest leftover on the short side.
+                const irect2 *best = nullptr;
+                ivec2 best_leftover;
+                for (const irect2 &free_rect : free_rects)
+                {
+                    ivec2 free_size = free_rect.size();
+                    if ((free_size < rect_size).any())
+                        continue;
+                    ivec2 leftover = free_size - rect_size;
+                    leftover = ivec2(leftover.min(), leftover.max());
+                    if (!best || leftover.x < best_leftover.x || (leftover.x == best_leftover.x && leftover.y < best_leftover.y))
+                    {
+                        best = &free_rect;
+                        best_leftover = leftover;
+                    }
+                }
 
-        // Make a context.
-        stbrp_context context;
-        stbrp_init_target(&context, target_size.x, target_size.y, packing_buffer.get(), buffer_size); // No cleanup is needed.
+                if (!best)
+                {
+                    rect.pos = ivec2(outer_gaps);
+                    rect.was_packed = false;
+                    rects_not_packed++;
+                    continue;
+                }
 
-        // Try packing.
-        bool ok = stbrp_pack_rects(&context, rects.data(), rects.size());
+                irect2 placed = best->a.rect_size(rect_size);
+                rect.pos = placed.a + outer_gaps;
+                rect.was_packed = true;
 
-        // Counts rectangles that weren't packed.
-        int rects_not_packed = 0;
-        if (!ok)
-            rects_not_packed = std::count_if(rects.begin(), rects.end(), [](const stbrp_rect &rect){return !rect.was_packed;});
+                // Split the free rectangles that intersect the new one.
+                new_free_rects.clear();
+                std::erase_if(free_rects, [&](const irect2 &free_rect)
+                {
+                    if ((free_rect.b <= placed.a).any() || (free_rect.a >= placed.b).any())
+                        return false;
+
+                    if (free_rect.a.x < placed.a.x)
+                        new_free_rects.push_back(free_rect.a.rect_to(ivec2(placed.a.x, free_rect.b.y)));
+                    if (free_rect.b.x > placed.b.x)
+                        new_free_rects.push_back(ivec2(placed.b.x, free_rect.a.y).rect_to(free_rect.b));
+                    if (free_rect.a.y < placed.a.y)
+                        new_free_rects.push_back(free_rect.a.rect_to(ivec2(free_rect.b.x, placed.a.y)));
+                    if (free_rect.b.y > placed.b.y)
+                        new_free_rects.push_back(ivec2(free_rect.a.x, placed.b.y).rect_to(free_rect.b));
+                    return true;
+                });
+
+                // Drop the redundant rectangles. The old ones don't contain each other, so we only need to check the new ones.
+                for (std::size_t i = 0; i < new_free_rects.size(); i++)
+                {
+                    const irect2 &new_rect = new_free_rects[i];
+                    bool redundant = std::any_of(free_rects.begin(), free_rects.end(), [&](const irect2 &r){return r.contains(new_rect);});
+                    for (std::size_t j = 0; j < new_free_rects.size() && !redundant; j++)
+                    {
+                        // For equal rectangles, keep the first one.
+                        if (j != i && new_free_rects[j].contains(new_rect) && (new_free_rects[j] != new_rect || j < i))
+                            redundant = true;
+                    }
+                    if (!redundant)
+                    {
+                        std::erase_if(free_rects, [&](const irect2 &r){return new_rect.contains(r);});
+                        free_rects.push_back(new_rect);
+                    }
+                }
+            }
+
+            return rects_not_packed;
+        }
+    };
+
+    RectPacker::RectPacker() {}
+
+    RectPacker::RectPacker(ivec2 target_size, Heuristic heuristic, int inner_gaps, int outer_gaps)
+        : state(std::make_unique<State>(target_size, heuristic, inner_gaps, outer_gaps))
+    {}
+
+    RectPacker::RectPacker(RectPacker &&) noexcept = default;
+    RectPacker &RectPacker::operator=(RectPacker &&) noexcept = default;
+    RectPacker::~RectPacker() = default;
+
+    int RectPacker::Add(Rect *data, int count)
+    {
+        ASSERT(state, "Packing: Attempt to use a null packer.");
+
+        int rects_not_packed = state->heuristic == Heuristic::max_rects ? state->AddMaxRects(data, count) : state->AddSkyline(data, count);
 
-        // Output data.
         for (int i = 0; i < count; i++)
         {
-            data[i].pos = ivec2(rects[i].x, rects[i].y) + outer_gaps;
-            data[i].was_packed = rects[i].was_packed;
+            if (!data[i].was_packed)
+                continue;
+            state->stats.num_packed++;
+            state->stats.used_area += (long long)data[i].size.x * data[i].size.y;
+            if ((data[i].size > 0).all())
+                state->stats.bounding_size = max(state->stats.bounding_size, data[i].pos - state->outer_gaps + data[i].size);
         }
 
         return rects_not_packed;
     }
+
+    Heuristic RectPacker::GetHeuristic() const
+    {
+        return state->heuristic;
+    }
+
+    const Stats &RectPacker::GetStats() const
+    {
+        return state->stats;
+    }
+
+    RectPacker PackRectsBest(ivec2 target_size, Rect *data, int count, int inner_gaps, int outer_gaps, std::span<const Heuristic> heuristics)
+    {
+        if (heuristics.empty())
+            heuristics = all_heuristics;
+
+        std::vector<RectPacker> packers(heuristics.size());
+        std::vector<std::vector<Rect>> results(heuristics.size());
+        Parallel::For(heuristics.size(), [&](std::size_t i)
+        {
+            packers[i] = RectPacker(target_size, heuristics[i], inner_gaps, outer_gaps);
+            results[i].assign(data, data + count);
+            (void)packers[i].Add(results[i].data(), count);
+        });
+
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < packers.size(); i++)
+        {
+            const Stats &stats = packers[i].GetStats();
+            const Stats &best_stats = packers[best].GetStats();
+            if (stats.num_packed > best_stats.num_packed || (stats.num_packed == best_stats.num_packed && stats.Density() > best_stats.Density()))
+                best = i;
+        }
+
+        std::copy(results[best].begin(), results[best].end(), data);
+        return std::move(packers[best]);
+    }
+
+    std::optional<ivec2> ShelfPacker::Allocate(ivec2 rect_size)
+    {
+        if (rect_size.x <= 0 || rect_size.y <= 0)
+            return ivec2(0);
+
+        ivec2 padded_size = rect_size + gap;
+
+        // Find the best fitting shelf.
+        Shelf *best_shelf = nullptr;
+        Span *best_span = nullptr;
+        for (Shelf &shelf : shelves)
+        {
+            if (shelf.height < padded_size.y || padded_size.y < shelf.height * min_shelf_fill)
+                continue;
+            if (best_shelf && best_shelf->height <= shelf.height)
+                continue;
+
+            // Prefer the existing holes to the free space at the end.
+            Span *span = nullptr;
+            for (Span &free_span : shelf.free_spans)
+            {
+                if (free_span.width >= padded_size.x && (!span || free_span.width < span->width))
+                    span = &free_span;
+            }
+            if (!span && shelf.x_end + padded_size.x > size.x + gap)
+                continue;
+
+            best_shelf = &shelf;
+            best_span = span;
+        }
+
+        if (!best_shelf)
+        {
+            // Make a new shelf.
+            if (shelves_end + padded_size.y > size.y + gap || padded_size.x > size.x + gap)
+                return {};
+            best_shelf = &shelves.emplace_back();
+            best_shelf->y = shelves_end;
+            best_shelf->height = padded_size.y;
+            shelves_end += padded_size.y;
+        }
+
+        ivec2 pos;
+        pos.y = best_shelf->y;
+        if (best_span)
+        {
+            pos.x = best_span->x;
+            best_span->x += padded_size.x;
+            best_span->width -= padded_size.x;
+            if (best_span->width == 0)
+                best_shelf->free_spans.erase(best_shelf->free_spans.begin() + (best_span - best_shelf->free_spans.data()));
+        }
+        else
+        {
+            pos.x = best_shelf->x_end;
+            best_shelf->x_end += padded_size.x;
+        }
+
+        return pos;
+    }
+
+    void ShelfPacker::Free(ivec2 pos, ivec2 rect_size)
+    {
+        if (rect_size.x <= 0 || rect_size.y <= 0)
+            return;
+
+        int padded_width = rect_size.x + gap;
+
+        auto shelf_iter = std::find_if(shelves.begin(), shelves.end(), [&](const Shelf &shelf){return shelf.y == pos.y;});
+        ASSERT(shelf_iter != shelves.end(), "Packing: Attempt to free a rectangle that wasn't allocated.");
+        if (shelf_iter == shelves.end())
+            return;
+        Shelf &shelf = *shelf_iter;
+
+        // Insert the span, merging it with the neighbors.
+        auto next = std::lower_bound(shelf.free_spans.begin(), shelf.free_spans.end(), pos.x, [](const Span &span, int x){return span.x < x;});
+        Span span{.x = pos.x, .width = padded_width};
+        if (next != shelf.free_spans.begin() && std::prev(next)->x + std::prev(next)->width == span.x)
+        {
+            --next;
+            span.x = next->x;
+            span.width += next->width;
+            next = shelf.free_spans.erase(next);
+        }
+        if (next != shelf.free_spans.end() && span.x + span.width == next->x)
+        {
+            span.width += next->width;
+            next = shelf.free_spans.erase(next);
+        }
+
+        if (span.x + span.width == shelf.x_end)
+            shelf.x_end = span.x;
+        else
+            shelf.free_spans.insert(next, span);
+
+        // Remove empty shelves from the bottom.
+        while (!shelves.empty() && shelves.back().x_end == 0)
+        {
+            shelves_end = shelves.back().y;
+            shelves.pop_back();
+        }
+    }
+
+    void ShelfPacker::Clear()
+    {
+        shelves.clear();
+        shelves_end = 0;
+    }
 }
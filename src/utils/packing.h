@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
 #include "utils/mat.h"
 
 namespace Packing
@@ -20,4 +26,100 @@ namespace Packing
     // Returns 0 on success. On failure returns the amount of rectangles that didn't fit into the box.
     // Note that coordinates outside of [0;65535] range are not supported by default. This can be changed in `stb_rect_pack.h`.
     int PackRects(ivec2 target_size, Rect *data, int count, int inner_gaps = 0, int outer_gaps = 0);
+
+    enum class Heuristic
+    {
+        skyline_bottom_left, // `stb_rect_pack` default. Fast.
+        skyline_best_fit, // `stb_rect_pack`. Slightly slower, often denser.
+        max_rects, // MaxRects with the best short side fit. The slowest one, usually the densest.
+    };
+    inline constexpr Heuristic all_heuristics[] = {Heuristic::skyline_bottom_left, Heuristic::skyline_best_fit, Heuristic::max_rects};
+
+    struct Stats
+    {
+        ivec2 size; // The target size, minus the outer gaps.
+        int num_packed = 0;
+        long long used_area = 0; // The total area of the packed rectangles, without the gaps.
+        ivec2 bounding_size; // The bounding box of the packed rectangles, starting from the corner, without the outer gaps.
+
+        // Which fraction of the target is used.
+        [[nodiscard]] float Occupancy() const {return size.prod() > 0 ? used_area / float(size.prod()) : 0;}
+        // Which fraction of the bounding box is used. Higher is better.
+        [[nodiscard]] float Density() const {return bounding_size.prod() > 0 ? used_area / float(bounding_size.prod()) : 0;}
+    };
+
+    // Same as `PackRects()`, but remembers the state, so more rectangles can be added later without moving the existing ones.
+    // This is useful for hot-reloading, but the result is less dense than packing everything at once.
+    // The rectangles can't be freed, use `ShelfPacker` below if you need that.
+    class RectPacker
+    {
+        struct State;
+        std::unique_ptr<State> state;
+
+      public:
+        RectPacker();
+        RectPacker(ivec2 target_size, Heuristic heuristic = Heuristic::skyline_bottom_left, int inner_gaps = 0, int outer_gaps = 0);
+        RectPacker(RectPacker &&) noexcept;
+        RectPacker &operator=(RectPacker &&) noexcept;
+        ~RectPacker();
+
+        [[nodiscard]] explicit operator bool() const {return bool(state);}
+
+        // Packs more rectangles. Returns 0 on success.
+        // On failure returns the amount of rectangles that didn't fit. Then the ones that did fit still take space.
+        int Add(Rect *data, int count);
+
+        [[nodiscard]] Heuristic GetHeuristic() const;
+        [[nodiscard]] const Stats &GetStats() const;
+    };
+
+    // Tries packing the rectangles with several heuristics in parallel, and keeps the best result.
+    // Prefers packing more rectangles, then a higher `Stats::Density()`. Ties are broken by the order of `heuristics`, so the result is deterministic.
+    // Returns the packer used for the best result, which can be used to add more rectangles later.
+    // Check `GetStats().num_packed` or `Rect::was_packed` to see if everything fit.
+    [[nodiscard]] RectPacker PackRectsBest(ivec2 target_size, Rect *data, int count, int inner_gaps = 0, int outer_gaps = 0, std::span<const Heuristic> heuristics = all_heuristics);
+
+    // Packs rectangles one at a time, and allows freeing them later. Good for caches, e.g. for glyphs.
+    // The rectangles are placed on horizontal shelves. Each shelf has a fixed height, and is only used for rectangles that are not much shorter than it.
+    class ShelfPacker
+    {
+        struct Span
+        {
+            int x = 0;
+            int width = 0;
+        };
+
+        struct Shelf
+        {
+            int y = 0;
+            int height = 0;
+            int x_end = 0; // Everything to the right of this is free.
+            std::vector<Span> free_spans; // Free space to the left of `x_end`, sorted by `x`, never adjacent to each other or `x_end`.
+        };
+
+        ivec2 size;
+        int gap = 0;
+        std::vector<Shelf> shelves; // Sorted by `y`.
+        int shelves_end = 0; // Everything below this is free.
+
+      public:
+        // Rectangles that are shorter than this fraction of the shelf height are not placed on that shelf.
+        static constexpr float min_shelf_fill = 0.7f;
+
+        ShelfPacker() {}
+        // `gap` is the amount of free space kept between the rectangles, to avoid texture bleeding.
+        ShelfPacker(ivec2 size, int gap = 0) : size(size), gap(gap) {}
+
+        [[nodiscard]] ivec2 Size() const {return size;}
+
+        // Returns the position for the rectangle, or null if there's not enough space.
+        [[nodiscard]] std::optional<ivec2> Allocate(ivec2 rect_size);
+
+        // Frees a rectangle previously returned by `Allocate()`.
+        // `rect_size` must be the same as the one passed to `Allocate()`.
+        void Free(ivec2 pos, ivec2 rect_size);
+
+        // Frees everything.
+        void Clear();
+    };
 }
@@ -0,0 +1,138 @@
+#include "parallel.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Parallel
+{
+    struct ThreadPool::State
+    {
+        // Held while a job runs, so only one job runs at a time.
+        std::mutex job_mutex;
+
+        // Protects everything below.
+        std::mutex mutex;
+        std::condition_variable job_started;
+        std::condition_variable job_finished;
+
+        std::uint64_t job_generation = 0; // Incremented for every job, so the workers don't miss them.
+        job_func_t job_func = nullptr;
+        void *job_data = nullptr;
+        std::size_t job_num_threads = 0; // Including the calling thread.
+        std::size_t num_busy_workers = 0;
+        bool stopping = false;
+
+        std::vector<std::jthread> workers; // Must be the last field, to be joined before the rest is destroyed.
+
+        void WorkerLoop(std::size_t thread_index)
+        {
+            std::uint64_t seen_generation = 0;
+            while (true)
+            {
+                job_func_t func = nullptr;
+                void *data = nullptr;
+
+                {
+                    std::unique_lock lock(mutex);
+                    job_started.wait(lock, [&]{return stopping || job_generation != seen_generation;});
+                    if (stopping)
+                        return;
+                    seen_generation = job_generation;
+                    if (thread_index >= job_num_threads)
+                        continue; // This job doesn't need this thread.
+                    func = job_func;
+                    data = job_data;
+                }
+
+                func(data, thread_index);
+
+                std::unique_lock lock(mutex);
+                if (--num_busy_workers == 0)
+                    job_finished.notify_one();
+            }
+        }
+    };
+
+    ThreadPool::ThreadPool() {}
+
+    ThreadPool::ThreadPool(std::size_t num_workers)
+        : state(std::make_unique<State>())
+    {
+        state->workers.reserve(num_workers);
+        for (std::size_t i = 0; i < num_workers; i++)
+            state->workers.emplace_back([this_state = state.get(), i]{this_state->WorkerLoop(i + 1);});
+    }
+
+    ThreadPool::ThreadPool(ThreadPool &&other) noexcept = default;
+    ThreadPool &ThreadPool::operator=(ThreadPool &&other) noexcept
+    {
+        // Stop our old workers in the destructor of `temp`.
+        ThreadPool temp = std::move(other);
+        std::swap(state, temp.state);
+        return *this;
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        if (!state)
+            return;
+
+        {
+            std::unique_lock lock(state->mutex);
+            state->stopping = true;
+        }
+        state->job_started.notify_all();
+        state->workers.clear(); // Join.
+    }
+
+    std::size_t ThreadPool::NumWorkers() const
+    {
+        return state ? state->workers.size() : 0;
+    }
+
+    bool ThreadPool::TryRun(std::size_t num_threads, job_func_t func, void *data)
+    {
+        if (!state)
+            return false;
+
+        std::unique_lock job_lock(state->job_mutex, std::try_to_lock);
+        if (!job_lock)
+            return false;
+
+        num_threads = std::min(num_threads, state->workers.size() + 1);
+        if (num_threads == 0)
+            return true;
+
+        if (num_threads > 1)
+        {
+            {
+                std::unique_lock lock(state->mutex);
+                state->job_func = func;
+                state->job_data = data;
+                state->job_num_threads = num_threads;
+                state->num_busy_workers = num_threads - 1;
+                state->job_generation++;
+            }
+            state->job_started.notify_all();
+        }
+
+        func(data, 0);
+
+        if (num_threads > 1)
+        {
+            std::unique_lock lock(state->mutex);
+            state->job_finished.wait(lock, [&]{return state->num_busy_workers == 0;});
+        }
+
+        return true;
+    }
+
+    ThreadPool &DefaultPool()
+    {
+        static ThreadPool ret(DefaultNumThreads() - 1);
+        return ret;
+    }
+}
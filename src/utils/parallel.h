@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace Parallel
+{
+    // Returns the default number of threads for `For()`.
+    [[nodiscard]] inline std::size_t DefaultNumThreads()
+    {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // A fixed set of worker threads that sleep between jobs, so running a job doesn't create any threads.
+    // Runs one job at a time, see `TryRun()`.
+    class ThreadPool
+    {
+        struct State;
+        std::unique_ptr<State> state;
+
+      public:
+        using job_func_t = void (*)(void *data, std::size_t thread_index);
+
+        ThreadPool();
+        // Starts `num_workers` threads. Zero is allowed, then every job runs on the calling thread.
+        explicit ThreadPool(std::size_t num_workers);
+        ThreadPool(ThreadPool &&other) noexcept;
+        ThreadPool &operator=(ThreadPool &&other) noexcept;
+        ~ThreadPool();
+
+        [[nodiscard]] explicit operator bool() const {return bool(state);}
+
+        [[nodiscard]] std::size_t NumWorkers() const;
+
+        // Calls `func(data, i)` for each `i` in `[0, num_threads)`, each on a different thread, and waits for all of them to return.
+        // `i == 0` runs on the calling thread. `num_threads` is clamped to `NumWorkers() + 1`. `func` must not throw.
+        // If another job is already running (e.g. if this is called from inside of a job), does nothing and returns false.
+        [[nodiscard]] bool TryRun(std::size_t num_threads, job_func_t func, void *data);
+    };
+
+    // The pool used by `For()`, with `DefaultNumThreads() - 1` workers. Started on the first call.
+    [[nodiscard]] ThreadPool &DefaultPool();
+
+    // Calls `func(i)` for each `i` in `[0, count)`, on up to `max_threads` threads (including the current one), using `DefaultPool()`.
+    // The indices are handed out dynamically, so the order of calls is unspecified. `func` must be safe to call concurrently for different indices.
+    // If the pool is busy (e.g. for nested calls, or calls from several threads at once), runs everything on the current thread instead.
+    // If `func` throws, the indices that weren't handed out yet are skipped, and the first exception that was caught is rethrown.
+    // If several calls throw concurrently, which one of them is rethrown is unspecified.
+    template <typename F>
+    void For(std::size_t count, F &&func, std::size_t max_threads = DefaultNumThreads())
+    {
+        auto Serial = [&]
+        {
+            for (std::size_t i = 0; i < count; i++)
+                func(i);
+        };
+
+        std::size_t num_threads = std::min(count, max_threads);
+        if (num_threads <= 1)
+        {
+            Serial();
+            return;
+        }
+
+        struct Job
+        {
+            F &func;
+            std::size_t count = 0;
+            std::atomic<std::size_t> next_index = 0;
+            std::atomic<bool> failed = false;
+            std::exception_ptr exception; // Written only by the thread that set `failed`.
+        };
+        Job job{.func = func, .count = count};
+
+        bool ok = DefaultPool().TryRun(num_threads, [](void *data, std::size_t thread_index)
+        {
+            (void)thread_index;
+            Job &job = *static_cast<Job *>(data);
+            try
+            {
+                std::size_t i = 0;
+                while (!job.failed.load(std::memory_order_relaxed) && (i = job.next_index.fetch_add(1, std::memory_order_relaxed)) < job.count)
+                    job.func(i);
+            }
+            catch (...)
+            {
+                if (!job.failed.exchange(true))
+                    job.exception = std::current_exception();
+            }
+        }, &job);
+
+        if (!ok)
+        {
+            Serial();
+            return;
+        }
+
+        if (job.exception)
+            std::rethrow_exception(job.exception);
+    }
+}
@@ -0,0 +1,163 @@
+#include "archive.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "program/exe_path.h"
+#include "stream/input.h"
+#include "stream/output.h"
+
+namespace
+{
+    constexpr Archive::Codec all_codecs[] = {Archive::Codec::zlib, Archive::Codec::lz4, Archive::Codec::zstd};
+
+    [[nodiscard]] std::vector<std::uint8_t> MakeData(std::size_t size)
+    {
+        std::vector<std::uint8_t> ret(size);
+        std::uint32_t state = 1;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            state = state * 1664525 + 1013904223;
+            ret[i] = i % 7 < 4 ? std::uint8_t(i / 64) : std::uint8_t(state >> 24 & 15); // Somewhat compressible.
+        }
+        return ret;
+    }
+}
+
+TEST_CASE("archive.chunked_streams")
+{
+    std::vector<std::uint8_t> data = MakeData(10000);
+
+    for (Archive::Codec codec : all_codecs)
+    {
+        CAPTURE(Archive::CodecName(codec));
+
+        if (!Archive::CodecAvailable(codec))
+        {
+            std::vector<std::uint8_t> compressed;
+            REQUIRE_THROWS(Archive::MaxCompressedSize(codec, data.size()));
+            REQUIRE_THROWS(Archive::CompressingOutput(Stream::Output::Container(compressed), codec));
+            continue;
+        }
+
+        // Single blocks.
+        std::vector<std::uint8_t> block(Archive::MaxCompressedSize(codec, data.size()));
+        block.resize(Archive::Compress(codec, data.data(), data.data() + data.size(), block.data(), block.data() + block.size()) - block.data());
+        std::vector<std::uint8_t> uncompressed(data.size());
+        Archive::Uncompress(codec, block.data(), block.data() + block.size(), uncompressed.data(), uncompressed.data() + uncompressed.size());
+        REQUIRE(uncompressed == data);
+        REQUIRE_THROWS(Archive::Uncompress(codec, block.data(), block.data() + block.size(), uncompressed.data(), uncompressed.data() + uncompressed.size() - 1));
+
+        // Streams. Write in pieces of different sizes, with a flush in the middle, to get chunks of different sizes.
+        std::vector<std::uint8_t> compressed;
+        Stream::Output output = Archive::CompressingOutput(Stream::Output::Container(compressed), codec, 1024);
+        output.WriteBytes(data.data(), 100);
+        output.Flush();
+        output.WriteBytes(data.data() + 100, 3000); // Bypasses the buffer, and gets split into several chunks.
+        for (std::size_t i = 3100; i < data.size(); i++)
+            output.WriteByte(data[i]);
+        output.Flush();
+        REQUIRE(compressed.size() < data.size());
+
+        Stream::Input input = Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(compressed));
+        REQUIRE(input.Size() == data.size());
+        std::vector<std::uint8_t> result(data.size());
+        input.Read(result.data(), result.size());
+        REQUIRE(result == data);
+
+        // Seeking.
+        for (std::size_t pos : {std::size_t(5000), std::size_t(99), std::size_t(100), std::size_t(9999), std::size_t(0)})
+        {
+            input.Seek(pos, Stream::absolute);
+            REQUIRE(input.ReadByte() == data[pos]);
+        }
+
+        // A wrong uncompressed size of the first chunk. LZ4 has no checksums, so we can't just corrupt the data itself.
+        REQUIRE(compressed[9] == 100);
+        compressed[9] = 99;
+        input = Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(compressed));
+        // The other chunks still work, but are shifted by one byte. This position is far enough to not touch the first chunk, since the stream reads aligned segments.
+        input.Seek(2000, Stream::absolute);
+        REQUIRE(input.ReadByte() == data[2001]);
+        input.Seek(0, Stream::absolute);
+        REQUIRE_THROWS(input.ReadByte());
+
+        // Truncated data.
+        compressed.pop_back();
+        REQUIRE_THROWS(Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(compressed)));
+    }
+
+    // An empty stream.
+    std::vector<std::uint8_t> compressed;
+    Archive::CompressingOutput(Stream::Output::Container(compressed), Archive::fast_codec).Flush();
+    REQUIRE(Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(compressed)).Size() == 0);
+
+    std::string junk = "not compressed at all";
+    REQUIRE_THROWS(Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(junk)));
+}
+
+// Needs the assets next to the executable.
+TEST_CASE("bench.archive.codecs" * doctest::skip())
+{
+    std::string assets_dir = Program::ExeDir() + "assets/";
+
+    for (auto [kind, dirs] : {
+        std::pair<std::string, std::vector<std::string>>{"maps", {"maps", "objects"}},
+        std::pair<std::string, std::vector<std::string>>{"images", {"images"}},
+        std::pair<std::string, std::vector<std::string>>{"sounds", {"sounds"}},
+    })
+    {
+        // Concatenate all the files of this kind.
+        std::vector<std::uint8_t> data;
+        for (const std::string &dir : dirs)
+        {
+            if (!std::filesystem::exists(assets_dir + dir))
+                continue;
+            for (const auto &entry : std::filesystem::directory_iterator(assets_dir + dir))
+            {
+                Stream::ReadOnlyData file = Stream::ReadOnlyData::file(entry.path().string());
+                data.insert(data.end(), file.data(), file.data() + file.size());
+            }
+        }
+        if (data.empty())
+        {
+            std::cout << FMT("No {} found in `{}`.\n", kind, assets_dir);
+            continue;
+        }
+
+        for (Archive::Codec codec : all_codecs)
+        {
+            if (!Archive::CodecAvailable(codec))
+                continue;
+
+            // The best time of several runs.
+            double compress_seconds = 1e9, uncompress_seconds = 1e9;
+            std::size_t compressed_size = 0;
+            for (int i = 0; i < 10; i++)
+            {
+                std::vector<std::uint8_t> compressed;
+                auto start = std::chrono::steady_clock::now();
+                Stream::Output output = Archive::CompressingOutput(Stream::Output::Container(compressed), codec);
+                output.WriteBytes(data.data(), data.size());
+                output.Flush();
+                compress_seconds = std::min(compress_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                compressed_size = compressed.size();
+
+                std::vector<std::uint8_t> result(data.size());
+                start = std::chrono::steady_clock::now();
+                Stream::Input input = Archive::UncompressingInput(Stream::ReadOnlyData::mem_reference(compressed));
+                input.Read(result.data(), result.size());
+                uncompress_seconds = std::min(uncompress_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                REQUIRE(result == data);
+            }
+
+            std::cout << FMT("{:<6} {:<4}: {} -> {} bytes ({:.1f}%), compress {:.0f} MB/s, uncompress {:.0f} MB/s\n", kind, Archive::CodecName(codec),
+                data.size(), compressed_size, compressed_size * 100. / data.size(), data.size() / compress_seconds / 1e6, data.size() / uncompress_seconds / 1e6);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#include "file_watcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+TEST_CASE("file_watcher.poll")
+{
+    std::string dir = (std::filesystem::temp_directory_path() / "imp_test_file_watcher").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir + "/nested");
+
+    auto WriteFile = [&](const std::string &name, const std::string &contents)
+    {
+        std::ofstream(dir + "/" + name, std::ios::binary) << contents;
+    };
+
+    WriteFile("a.txt", "1");
+
+    for (auto backend : {Filesystem::FileWatcher::Backend::automatic, Filesystem::FileWatcher::Backend::polling})
+    {
+        CAPTURE(int(backend));
+
+        Filesystem::FileWatcher watcher({dir}, backend, std::chrono::milliseconds(0));
+        REQUIRE(watcher);
+        REQUIRE(watcher.IsPolling() == (backend == Filesystem::FileWatcher::Backend::polling || !IMP_PLATFORM_IS(linux)));
+        REQUIRE(watcher.Poll().empty());
+
+        // The size changes, so the polling backend notices this even if the time resolution is coarse.
+        WriteFile("a.txt", backend == Filesystem::FileWatcher::Backend::polling ? "22" : "333");
+        WriteFile("b.txt", "1");
+        WriteFile("nested/c.txt", "1");
+        REQUIRE(watcher.Poll() == std::vector<std::string>{dir + "/a.txt", dir + "/b.txt"});
+        REQUIRE(watcher.Poll().empty());
+
+        std::filesystem::remove(dir + "/b.txt");
+        REQUIRE(watcher.Poll().empty());
+    }
+
+    REQUIRE_THROWS(Filesystem::FileWatcher({dir + "/missing"}));
+    REQUIRE(Filesystem::FileWatcher().Poll().empty());
+
+    std::filesystem::remove_all(dir);
+}
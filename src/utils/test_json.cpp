@@ -0,0 +1,132 @@
+#include "json.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <doctest/doctest.h>
+
+#include "gameutils/tiled_map.h"
+
+TEST_CASE("json.parse")
+{
+    Json json(R"( {"b": [1, -2.5e1, "x\"é\n", true, false, null, {}], "a": {"z": 1, "y": 2, "z": 3}, "big": 12345678901} )", 32);
+    Json::View view = json.GetView();
+
+    REQUIRE(view.IsObject());
+    REQUIRE(view.GetObjectSize() == 3);
+    REQUIRE(view.HasElement("b"));
+    REQUIRE_FALSE(view.HasElement("c"));
+
+    Json::View b = view["b"];
+    REQUIRE(b.GetArraySize() == 7);
+    REQUIRE(b[0].IsInt());
+    REQUIRE(b[0].GetInt() == 1);
+    REQUIRE(b[0].GetReal() == 1);
+    REQUIRE_FALSE(b[1].IsInt());
+    REQUIRE(b[1].GetReal() == -25);
+    REQUIRE(b[2].GetString() == "x\"\xc3\xa9\n");
+    REQUIRE(b[3].GetBool() == true);
+    REQUIRE(b[4].GetBool() == false);
+    REQUIRE(b[5].IsNull());
+    REQUIRE(b[6].GetObjectSize() == 0);
+
+    // Duplicate keys: the first one wins. The keys are sorted.
+    REQUIRE(view["a"].GetObjectSize() == 2);
+    REQUIRE(view["a"]["z"].GetInt() == 1);
+    std::ostringstream ss;
+    view["a"].DebugPrint(ss);
+    REQUIRE(ss.str() == R"({"y":2,"z":1})");
+
+    // The numbers are parsed lazily, so overflow is reported on access.
+    REQUIRE(view["big"].GetReal() == 12345678901.0);
+    REQUIRE_THROWS(view["big"].GetInt());
+
+    // The error messages contain the element paths.
+    bool thrown = false;
+    try
+    {
+        (void)b[2].GetInt();
+    }
+    catch (std::exception &e)
+    {
+        thrown = true;
+        REQUIRE(std::string(e.what()) == "Expected JSON element `b[2]` to be an integer.");
+    }
+    REQUIRE(thrown);
+    REQUIRE_THROWS(b[7]);
+    REQUIRE_THROWS(view["c"]);
+
+    REQUIRE_THROWS(Json("[1, 2", 32));
+    REQUIRE_THROWS(Json("{\"a\" 1}", 32));
+    REQUIRE_THROWS(Json("[-]", 32));
+    REQUIRE_THROWS(Json("[1.]", 32));
+    REQUIRE_THROWS(Json("[[[1]]]", 1));
+    REQUIRE_THROWS(Json("1 2", 32));
+
+    // The arena is sized from the number of elements, and grows if the unescaped strings don't fit.
+    std::string escaped = "[\"";
+    for (int i = 0; i < 1000; i++)
+        escaped += "\\n";
+    escaped += "\"]";
+    REQUIRE(Json(escaped.c_str(), 32).GetView()[0].GetString() == std::string(1000, '\n'));
+
+    // Zero-copy parsing from memory, if the data is null-terminated.
+    std::string source = R"({"name": "mid"})";
+    Json from_memory(Stream::ReadOnlyData::mem_reference(source.c_str(), source.c_str() + source.size() + 1), 32);
+    REQUIRE(from_memory.GetView()["name"].GetStringView().data() == source.data() + 10);
+}
+
+namespace
+{
+    // Makes a map in the same format as the ones saved by Tiled.
+    [[nodiscard]] std::string MakeTiledMap(ivec2 size)
+    {
+        std::string ret = FMT(R"({{ "compressionlevel":-1, "height":{}, "infinite":false, "layers":[)", size.y);
+        for (const char *name : {"mid", "bg"})
+        {
+            ret += R"({ "data":[)";
+            for (int i = 0; i < size.prod(); i++)
+            {
+                if (i > 0)
+                    ret += i % size.x == 0 ? ",\n            " : ", ";
+                ret += std::to_string(i * 7 % 23 < 15 ? 0 : i % 13);
+            }
+            ret += FMT(R"(], "height":{}, "id":1, "name":"{}", "opacity":1, "type":"tilelayer", "visible":true, "width":{}, "x":0, "y":0 }},)", size.y, name, size.x);
+        }
+        ret += R"({ "draworder":"topdown", "id":2, "name":"objects", "objects":[)";
+        for (int i = 0; i < 20; i++)
+            ret += FMT(R"({}{{ "height":0, "id":{}, "name":"=goal_box_{},goal", "point":true, "rotation":0, "type":"", "visible":true, "width":0, "x":{}, "y":{} }})", i ? "," : "", i, i, i * 12, i * 24);
+        ret += FMT(R"(], "opacity":1, "type":"objectgroup", "visible":true, "x":0, "y":0 }}], "orientation":"orthogonal", "tileheight":12, "tilewidth":12, "type":"map", "version":"1.10", "width":{} }})", size.x);
+        return ret;
+    }
+}
+
+// Run this in a release build, otherwise the `ASSERT()`s in `LoadTileLayer()` dominate.
+TEST_CASE("bench.json.level_load" * doctest::skip())
+{
+    for (ivec2 size : {ivec2(29, 22), ivec2(256, 256)})
+    {
+        std::string source = MakeTiledMap(size);
+
+        // This is what `Map` does when loading a level.
+        int checksum = 0;
+        auto Load = [&]
+        {
+            Json json(source.c_str(), 32);
+            checksum += Tiled::LoadPointLayer(Tiled::FindLayer(json.GetView(), "objects")).points.size();
+            checksum += Tiled::LoadTileLayer(Tiled::FindLayer(json.GetView(), "bg")).size().x;
+            checksum += Tiled::LoadTileLayer(Tiled::FindLayer(json.GetView(), "mid")).size().y;
+        };
+
+        int num_reps = std::max(1, 20'000'000 / int(source.size()));
+        Load(); // Warm up.
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_reps; i++)
+            Load();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << FMT("{}x{} map ({} bytes): {:.1f} us per load, {:.1f} MB/s (checksum {})\n", size.x, size.y, source.size(), seconds / num_reps * 1e6, source.size() * double(num_reps) / seconds / 1e6, checksum);
+    }
+}
@@ -0,0 +1,143 @@
+#include "packing.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+TEST_CASE("packing.shelf_packer")
+{
+    constexpr int gap = 1;
+    Packing::ShelfPacker packer(ivec2(64, 48), gap);
+
+    std::vector<irect2> rects;
+    auto CheckNoOverlap = [&]
+    {
+        for (std::size_t i = 0; i < rects.size(); i++)
+        {
+            REQUIRE(ivec2().rect_size(packer.Size()).contains(rects[i]));
+            for (std::size_t j = i + 1; j < rects.size(); j++)
+            {
+                // Account for the gaps.
+                irect2 a = rects[i].offset_b(gap), b = rects[j].offset_b(gap);
+                REQUIRE_FALSE(((a.a < b.b).all() && (b.a < a.b).all()));
+            }
+        }
+    };
+
+    std::mt19937 rng(42);
+    auto RandomSize = [&]{return ivec2(std::uniform_int_distribution(1, 10)(rng), std::uniform_int_distribution(3, 9)(rng));};
+
+    // Fill it up.
+    while (auto pos = packer.Allocate(ivec2(6, 8)))
+        rects.push_back(pos->rect_size(ivec2(6, 8)));
+    REQUIRE(rects.size() == 9 * 5);
+    CheckNoOverlap();
+
+    // Free every other rectangle, then reuse the space.
+    std::size_t num_freed = 0;
+    for (std::size_t i = 0; i < rects.size(); i += 2, num_freed++)
+        packer.Free(rects[i].a, rects[i].size());
+    std::erase_if(rects, [&, i = 0](const irect2 &) mutable {return i++ % 2 == 0;});
+    for (std::size_t i = 0; i < num_freed; i++)
+    {
+        auto pos = packer.Allocate(ivec2(5, 7));
+        REQUIRE(pos);
+        rects.push_back(pos->rect_size(ivec2(5, 7)));
+    }
+    CheckNoOverlap();
+    REQUIRE_FALSE(packer.Allocate(ivec2(6, 8)));
+
+    // Freeing everything allows allocating the whole area.
+    for (const irect2 &rect : rects)
+        packer.Free(rect.a, rect.size());
+    rects.clear();
+    REQUIRE(packer.Allocate(packer.Size()) == ivec2(0));
+    packer.Clear();
+
+    // Random churn.
+    for (int i = 0; i < 2000; i++)
+    {
+        if (!rects.empty() && std::uniform_int_distribution(0, 2)(rng) == 0)
+        {
+            std::size_t index = std::uniform_int_distribution<std::size_t>(0, rects.size() - 1)(rng);
+            packer.Free(rects[index].a, rects[index].size());
+            rects.erase(rects.begin() + index);
+        }
+        else
+        {
+            ivec2 size = RandomSize();
+            if (auto pos = packer.Allocate(size))
+                rects.push_back(pos->rect_size(size));
+        }
+    }
+    CheckNoOverlap();
+}
+
+TEST_CASE("packing.rect_packer")
+{
+    std::mt19937 rng(7);
+    std::vector<Packing::Rect> rects;
+    for (int i = 0; i < 300; i++)
+        rects.push_back(ivec2(std::uniform_int_distribution(1, 20)(rng), std::uniform_int_distribution(1, 20)(rng)));
+
+    constexpr int inner_gaps = 1, outer_gaps = 2;
+    ivec2 target_size(320);
+
+    auto CheckNoOverlap = [&](const std::vector<Packing::Rect> &rects)
+    {
+        for (std::size_t i = 0; i < rects.size(); i++)
+        {
+            if (!rects[i].was_packed)
+                continue;
+            irect2 a = rects[i].pos.rect_size(rects[i].size);
+            REQUIRE(ivec2().rect_size(target_size).shrink(outer_gaps).contains(a));
+            for (std::size_t j = i + 1; j < rects.size(); j++)
+            {
+                if (!rects[j].was_packed)
+                    continue;
+                irect2 b = rects[j].pos.rect_size(rects[j].size);
+                REQUIRE_FALSE(((a.a < b.b + inner_gaps).all() && (b.a < a.b + inner_gaps).all()));
+            }
+        }
+    };
+
+    for (Packing::Heuristic heuristic : Packing::all_heuristics)
+    {
+        CAPTURE(int(heuristic));
+
+        // Adding the rectangles in several batches doesn't move the existing ones.
+        std::vector<Packing::Rect> packed = rects;
+        Packing::RectPacker packer(target_size, heuristic, inner_gaps, outer_gaps);
+        REQUIRE(packer.Add(packed.data(), 200) == 0);
+        std::vector<Packing::Rect> first_batch(packed.begin(), packed.begin() + 200);
+        REQUIRE(packer.Add(packed.data() + 200, 100) == 0);
+        REQUIRE(std::equal(first_batch.begin(), first_batch.end(), packed.begin(), [](const Packing::Rect &a, const Packing::Rect &b){return a.pos == b.pos;}));
+        CheckNoOverlap(packed);
+
+        const Packing::Stats &stats = packer.GetStats();
+        REQUIRE(stats.num_packed == 300);
+        REQUIRE(stats.size == target_size - outer_gaps * 2);
+        REQUIRE(stats.Occupancy() > 0);
+        REQUIRE(stats.Occupancy() <= stats.Density());
+        REQUIRE(stats.Density() <= 1);
+
+        // Running out of space.
+        std::vector<Packing::Rect> big(10, Packing::Rect(ivec2(100)));
+        REQUIRE(packer.Add(big.data(), big.size()) > 0);
+        CheckNoOverlap(packed);
+    }
+
+    // Picking the best heuristic.
+    std::vector<Packing::Rect> best = rects;
+    Packing::RectPacker packer = Packing::PackRectsBest(target_size, best.data(), best.size(), inner_gaps, outer_gaps);
+    CheckNoOverlap(best);
+    for (Packing::Heuristic heuristic : Packing::all_heuristics)
+    {
+        std::vector<Packing::Rect> other = rects;
+        Packing::RectPacker other_packer(target_size, heuristic, inner_gaps, outer_gaps);
+        (void)other_packer.Add(other.data(), other.size());
+        REQUIRE(packer.GetStats().Density() >= other_packer.GetStats().Density());
+    }
+}
@@ -0,0 +1,65 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+TEST_CASE("parallel.for")
+{
+    for (std::size_t num_threads : {std::size_t(1), std::size_t(2), std::size_t(8)})
+    {
+        CAPTURE(num_threads);
+
+        std::vector<std::atomic<int>> counts(1000);
+        Parallel::For(counts.size(), [&](std::size_t i){counts[i]++;}, num_threads);
+        for (const auto &count : counts)
+            REQUIRE(count == 1);
+
+        bool called = false;
+        Parallel::For(0, [&](std::size_t){called = true;}, num_threads);
+        REQUIRE_FALSE(called);
+
+        REQUIRE_THROWS(Parallel::For(counts.size(), [](std::size_t i){if (i % 100 == 50) throw std::runtime_error("Test.");}, num_threads));
+
+        // Nested calls run serially instead of waiting for the pool.
+        std::vector<std::atomic<int>> nested_counts(100);
+        Parallel::For(10, [&](std::size_t i)
+        {
+            Parallel::For(10, [&](std::size_t j){nested_counts[i * 10 + j]++;}, num_threads);
+        }, num_threads);
+        for (const auto &count : nested_counts)
+            REQUIRE(count == 1);
+    }
+}
+
+TEST_CASE("parallel.thread_pool")
+{
+    for (std::size_t num_workers : {std::size_t(0), std::size_t(1), std::size_t(5)})
+    {
+        CAPTURE(num_workers);
+
+        Parallel::ThreadPool pool(num_workers);
+        REQUIRE(pool.NumWorkers() == num_workers);
+
+        // The same workers are reused for every job.
+        for (int i = 0; i < 50; i++)
+        {
+            std::vector<std::atomic<int>> counts(8);
+            REQUIRE(pool.TryRun(counts.size(), [](void *data, std::size_t thread_index)
+            {
+                (*static_cast<std::vector<std::atomic<int>> *>(data))[thread_index]++;
+            }, &counts));
+
+            for (std::size_t j = 0; j < counts.size(); j++)
+                REQUIRE(counts[j] == (j <= num_workers));
+        }
+
+        Parallel::ThreadPool other = std::move(pool);
+        REQUIRE(other.NumWorkers() == num_workers);
+        REQUIRE_FALSE(pool.TryRun(1, [](void *, std::size_t){}, nullptr));
+        other = Parallel::ThreadPool(2);
+        REQUIRE(other.NumWorkers() == 2);
+    }
+}